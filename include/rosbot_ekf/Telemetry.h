@@ -0,0 +1,320 @@
+#ifndef _ROS_rosbot_ekf_Telemetry_h
+#define _ROS_rosbot_ekf_Telemetry_h
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include "ros/msg.h"
+#include "ros/time.h"
+
+namespace rosbot_ekf
+{
+
+  class Telemetry : public ros::Msg
+  {
+    public:
+      typedef ros::Time _stamp_type;
+      _stamp_type stamp;
+      typedef float _x_type;
+      _x_type x;
+      typedef float _y_type;
+      _y_type y;
+      typedef float _yaw_type;
+      _yaw_type yaw;
+      typedef float _linear_velocity_type;
+      _linear_velocity_type linear_velocity;
+      typedef float _angular_velocity_type;
+      _angular_velocity_type angular_velocity;
+      float wheel_position[4];
+      float orientation[4];
+      float gyro[3];
+      float accel[3];
+      uint16_t range_mm[4];
+      typedef uint16_t _battery_mv_type;
+      _battery_mv_type battery_mv;
+      typedef uint8_t _updated_type;
+      _updated_type updated;
+      enum { IMU_UPDATED = 1 };
+      enum { RANGE_UPDATED = 2 };
+
+    Telemetry():
+      stamp(),
+      x(0),
+      y(0),
+      yaw(0),
+      linear_velocity(0),
+      angular_velocity(0),
+      wheel_position(),
+      orientation(),
+      gyro(),
+      accel(),
+      range_mm(),
+      battery_mv(0),
+      updated(0)
+    {
+    }
+
+    virtual int serialize(unsigned char *outbuffer) const
+    {
+      int offset = 0;
+      *(outbuffer + offset + 0) = (this->stamp.sec >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->stamp.sec >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->stamp.sec >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->stamp.sec >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->stamp.sec);
+      *(outbuffer + offset + 0) = (this->stamp.nsec >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->stamp.nsec >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (this->stamp.nsec >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (this->stamp.nsec >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->stamp.nsec);
+      union {
+        float real;
+        uint32_t base;
+      } u_x;
+      u_x.real = this->x;
+      *(outbuffer + offset + 0) = (u_x.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_x.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_x.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_x.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->x);
+      union {
+        float real;
+        uint32_t base;
+      } u_y;
+      u_y.real = this->y;
+      *(outbuffer + offset + 0) = (u_y.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_y.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_y.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_y.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->y);
+      union {
+        float real;
+        uint32_t base;
+      } u_yaw;
+      u_yaw.real = this->yaw;
+      *(outbuffer + offset + 0) = (u_yaw.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_yaw.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_yaw.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_yaw.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->yaw);
+      union {
+        float real;
+        uint32_t base;
+      } u_linear_velocity;
+      u_linear_velocity.real = this->linear_velocity;
+      *(outbuffer + offset + 0) = (u_linear_velocity.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_linear_velocity.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_linear_velocity.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_linear_velocity.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->linear_velocity);
+      union {
+        float real;
+        uint32_t base;
+      } u_angular_velocity;
+      u_angular_velocity.real = this->angular_velocity;
+      *(outbuffer + offset + 0) = (u_angular_velocity.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_angular_velocity.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_angular_velocity.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_angular_velocity.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->angular_velocity);
+      for( uint32_t i = 0; i < 4; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_wheel_positioni;
+      u_wheel_positioni.real = this->wheel_position[i];
+      *(outbuffer + offset + 0) = (u_wheel_positioni.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_wheel_positioni.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_wheel_positioni.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_wheel_positioni.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->wheel_position[i]);
+      }
+      for( uint32_t i = 0; i < 4; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_orientationi;
+      u_orientationi.real = this->orientation[i];
+      *(outbuffer + offset + 0) = (u_orientationi.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_orientationi.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_orientationi.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_orientationi.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->orientation[i]);
+      }
+      for( uint32_t i = 0; i < 3; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_gyroi;
+      u_gyroi.real = this->gyro[i];
+      *(outbuffer + offset + 0) = (u_gyroi.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_gyroi.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_gyroi.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_gyroi.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->gyro[i]);
+      }
+      for( uint32_t i = 0; i < 3; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_acceli;
+      u_acceli.real = this->accel[i];
+      *(outbuffer + offset + 0) = (u_acceli.base >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (u_acceli.base >> (8 * 1)) & 0xFF;
+      *(outbuffer + offset + 2) = (u_acceli.base >> (8 * 2)) & 0xFF;
+      *(outbuffer + offset + 3) = (u_acceli.base >> (8 * 3)) & 0xFF;
+      offset += sizeof(this->accel[i]);
+      }
+      for( uint32_t i = 0; i < 4; i++){
+      *(outbuffer + offset + 0) = (this->range_mm[i] >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->range_mm[i] >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->range_mm[i]);
+      }
+      *(outbuffer + offset + 0) = (this->battery_mv >> (8 * 0)) & 0xFF;
+      *(outbuffer + offset + 1) = (this->battery_mv >> (8 * 1)) & 0xFF;
+      offset += sizeof(this->battery_mv);
+      *(outbuffer + offset + 0) = (this->updated >> (8 * 0)) & 0xFF;
+      offset += sizeof(this->updated);
+     return offset;
+    }
+
+    virtual int deserialize(unsigned char *inbuffer)
+    {
+      int offset = 0;
+      this->stamp.sec =  ((uint32_t) (*(inbuffer + offset)));
+      this->stamp.sec |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->stamp.sec |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->stamp.sec |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->stamp.sec);
+      this->stamp.nsec =  ((uint32_t) (*(inbuffer + offset)));
+      this->stamp.nsec |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      this->stamp.nsec |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      this->stamp.nsec |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      offset += sizeof(this->stamp.nsec);
+      union {
+        float real;
+        uint32_t base;
+      } u_x;
+      u_x.base = 0;
+      u_x.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_x.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_x.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_x.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->x = u_x.real;
+      offset += sizeof(this->x);
+      union {
+        float real;
+        uint32_t base;
+      } u_y;
+      u_y.base = 0;
+      u_y.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_y.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_y.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_y.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->y = u_y.real;
+      offset += sizeof(this->y);
+      union {
+        float real;
+        uint32_t base;
+      } u_yaw;
+      u_yaw.base = 0;
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_yaw.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->yaw = u_yaw.real;
+      offset += sizeof(this->yaw);
+      union {
+        float real;
+        uint32_t base;
+      } u_linear_velocity;
+      u_linear_velocity.base = 0;
+      u_linear_velocity.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_linear_velocity.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_linear_velocity.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_linear_velocity.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->linear_velocity = u_linear_velocity.real;
+      offset += sizeof(this->linear_velocity);
+      union {
+        float real;
+        uint32_t base;
+      } u_angular_velocity;
+      u_angular_velocity.base = 0;
+      u_angular_velocity.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_angular_velocity.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_angular_velocity.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_angular_velocity.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->angular_velocity = u_angular_velocity.real;
+      offset += sizeof(this->angular_velocity);
+      for( uint32_t i = 0; i < 4; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_wheel_positioni;
+      u_wheel_positioni.base = 0;
+      u_wheel_positioni.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_wheel_positioni.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_wheel_positioni.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_wheel_positioni.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->wheel_position[i] = u_wheel_positioni.real;
+      offset += sizeof(this->wheel_position[i]);
+      }
+      for( uint32_t i = 0; i < 4; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_orientationi;
+      u_orientationi.base = 0;
+      u_orientationi.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_orientationi.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_orientationi.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_orientationi.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->orientation[i] = u_orientationi.real;
+      offset += sizeof(this->orientation[i]);
+      }
+      for( uint32_t i = 0; i < 3; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_gyroi;
+      u_gyroi.base = 0;
+      u_gyroi.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_gyroi.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_gyroi.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_gyroi.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->gyro[i] = u_gyroi.real;
+      offset += sizeof(this->gyro[i]);
+      }
+      for( uint32_t i = 0; i < 3; i++){
+      union {
+        float real;
+        uint32_t base;
+      } u_acceli;
+      u_acceli.base = 0;
+      u_acceli.base |= ((uint32_t) (*(inbuffer + offset + 0))) << (8 * 0);
+      u_acceli.base |= ((uint32_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      u_acceli.base |= ((uint32_t) (*(inbuffer + offset + 2))) << (8 * 2);
+      u_acceli.base |= ((uint32_t) (*(inbuffer + offset + 3))) << (8 * 3);
+      this->accel[i] = u_acceli.real;
+      offset += sizeof(this->accel[i]);
+      }
+      for( uint32_t i = 0; i < 4; i++){
+      this->range_mm[i] =  ((uint16_t) (*(inbuffer + offset)));
+      this->range_mm[i] |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->range_mm[i]);
+      }
+      this->battery_mv =  ((uint16_t) (*(inbuffer + offset)));
+      this->battery_mv |= ((uint16_t) (*(inbuffer + offset + 1))) << (8 * 1);
+      offset += sizeof(this->battery_mv);
+      this->updated =  ((uint8_t) (*(inbuffer + offset)));
+      offset += sizeof(this->updated);
+     return offset;
+    }
+
+    const char * getType(){ return "rosbot_ekf/Telemetry"; };
+    const char * getMD5(){ return "f26f422d859f859227ea5d5ab306d00d"; };
+
+  };
+
+}
+#endif
@@ -0,0 +1,64 @@
+#include "I2CTransactionQueue.h"
+
+#define TRANSFER_DONE_FLAG 0x01
+
+I2CTransactionQueue::I2CTransactionQueue(I2C & i2c)
+#if DEVICE_I2C_ASYNCH
+: _event(0)
+, _i2c(i2c)
+#else
+: _i2c(i2c)
+#endif
+{}
+
+#if DEVICE_I2C_ASYNCH
+
+void I2CTransactionQueue::onEvent(int event)
+{
+    _event = event;
+    _flags.set(TRANSFER_DONE_FLAG);
+}
+
+int I2CTransactionQueue::transfer(I2CTransaction & t)
+{
+    _event = 0;
+    _flags.clear(TRANSFER_DONE_FLAG);
+    // a transfer with both buffers writes the register index and reads with repeated start
+    if (_i2c.transfer(t.address << 1, (const char *)t.tx, t.tx_len, (char *)t.rx, t.rx != NULL ? t.rx_len : 0,
+                      callback(this, &I2CTransactionQueue::onEvent), I2C_EVENT_ALL) != 0)
+        return -1;
+
+    uint32_t flags = _flags.wait_any(TRANSFER_DONE_FLAG, I2C_TRANSACTION_TIMEOUT_MS);
+    if (flags & osFlagsError)
+    {
+        _i2c.abort_transfer();
+        return -1;
+    }
+    return (_event & I2C_EVENT_TRANSFER_COMPLETE) && !(_event & (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)) ? 0 : -1;
+}
+
+#else
+
+int I2CTransactionQueue::transfer(I2CTransaction & t)
+{
+    bool read = t.rx != NULL && t.rx_len > 0;
+    if (_i2c.write(t.address << 1, (const char *)t.tx, t.tx_len, read) != 0)
+        return -1;
+    if (read && _i2c.read(t.address << 1, (char *)t.rx, t.rx_len) != 0)
+        return -1;
+    return 0;
+}
+
+#endif /* DEVICE_I2C_ASYNCH */
+
+int I2CTransactionQueue::run(I2CTransaction * transactions, int n)
+{
+    int failures = 0;
+    for (int i = 0; i < n; i++)
+    {
+        transactions[i].result = transfer(transactions[i]);
+        if (transactions[i].result != 0)
+            failures++;
+    }
+    return failures;
+}
@@ -0,0 +1,53 @@
+/** @file I2CTransactionQueue.h
+ * Chained register transactions on a shared I2C bus.
+ *
+ * A sequence of short register reads and writes (index byte, optional data byte, optional
+ * read with repeated start) is executed with the asynchronous I2C API: every transfer is
+ * started by the calling thread and completed in the I2C interrupt, and the thread sleeps
+ * on an event flag in between instead of busy-waiting on the bus. Without DEVICE_I2C_ASYNCH
+ * the same sequence is executed with blocking transfers.
+ */
+#ifndef __I2C_TRANSACTION_QUEUE_H__
+#define __I2C_TRANSACTION_QUEUE_H__
+
+#include <mbed.h>
+
+#define I2C_TRANSACTION_TIMEOUT_MS 10 /**< Time limit of one transaction.*/
+
+/**
+ * @brief Register transaction with a 7-bit addressed device.
+ */
+struct I2CTransaction
+{
+    uint8_t address; ///< 7-bit device address.
+    uint8_t tx[2];   ///< Register index and optional data byte.
+    uint8_t tx_len;  ///< Number of bytes in tx.
+    uint8_t * rx;    ///< Receive buffer, NULL for writes.
+    uint8_t rx_len;  ///< Number of bytes to read.
+    int result;      ///< 0 on success, set by I2CTransactionQueue::run().
+};
+
+class I2CTransactionQueue : NonCopyable<I2CTransactionQueue>
+{
+public:
+    I2CTransactionQueue(I2C & i2c);
+
+    /**
+     * @brief Execute transactions one after another.
+     *
+     * A failed transaction does not stop the sequence, its result is set to -1.
+     * @return number of failed transactions
+     */
+    int run(I2CTransaction * transactions, int n);
+
+private:
+    int transfer(I2CTransaction & t);
+#if DEVICE_I2C_ASYNCH
+    void onEvent(int event);
+    EventFlags _flags;
+    volatile int _event;
+#endif
+    I2C & _i2c;
+};
+
+#endif /* __I2C_TRANSACTION_QUEUE_H__ */
@@ -1,4 +1,5 @@
 #include "MultiDistanceSensor.h"
+#include <Profiler.h>
 
 static const uint8_t DEFAULT_HW_ADDRESS = 0x29;
 
@@ -28,6 +29,13 @@ DigitalInOut(SENSOR_RL_XSHOUT_PIN, PIN_OUTPUT, OpenDrainNoPull, 0)};
     #error "Your target is not supported!"
 #endif /* TARGET_CORE2 */
 
+#if MBED_CONF_MULTI_DISTANCE_SENSOR_STAGGERED_SCHEDULE
+#define FRONT_TIMING {MBED_CONF_MULTI_DISTANCE_SENSOR_FRONT_TIMING_BUDGET_MS, MBED_CONF_MULTI_DISTANCE_SENSOR_FRONT_PERIOD_MS}
+#else
+#define FRONT_TIMING {MBED_CONF_MULTI_DISTANCE_SENSOR_TIMING_BUDGET_MS, MBED_CONF_MULTI_DISTANCE_SENSOR_PERIOD_MS}
+#endif
+#define REAR_TIMING {MBED_CONF_MULTI_DISTANCE_SENSOR_TIMING_BUDGET_MS, MBED_CONF_MULTI_DISTANCE_SENSOR_PERIOD_MS}
+
 MultiDistanceSensor * MultiDistanceSensor::_instance = nullptr;
 
 Mail<SensorsMeasurement, 5> distance_sensor_mail_box;
@@ -35,12 +43,25 @@ Mail<uint8_t, 5> distance_sensor_commands;
 
 MultiDistanceSensor::MultiDistanceSensor()
 :_i2c(nullptr)
+,_bus(nullptr)
+,_filter_changed(0)
+,_timing{FRONT_TIMING, FRONT_TIMING, REAR_TIMING, REAR_TIMING}
+,_timing_changed(0)
+,_next_poll_ms{0, 0, 0, 0}
+,_retry_at_ms{0, 0, 0, 0}
+,_bus_recoveries(0)
 ,_xshout{nullptr, nullptr, nullptr, nullptr}
 ,_is_active{false,false,false,false}
 ,_initialized(false)
 ,_sensors_enabled(true)
-,_last_sensor_index(-1)
-{}
+{
+    for(int i=0;i<NUM_DISTANCE_SENSORS;i++)
+    {
+        memset(&_health[i], 0, sizeof(_health[i]));
+        _health[i].retry_ms = DISTANCE_SENSORS_RETRY_MIN_MS;
+        _filter_params[i] = RangeFilter::DEFAULT_PARAMS;
+    }
+}
 
 MultiDistanceSensor & MultiDistanceSensor::getInstance()
 {
@@ -73,6 +94,12 @@ int MultiDistanceSensor::restart()
     
     _i2c->frequency(DISTANCE_SENSORS_DEFAULT_I2C_FREQ);
 
+    {
+        // every sensor is started with its current timing below
+        CriticalSectionLock lock;
+        _timing_changed = 0;
+    }
+    uint64_t now = Kernel::get_ms_count();
     for(int i=0;i<4;i++)
     {
         _sensor[i]->setTimeout(500);
@@ -81,20 +108,135 @@ int MultiDistanceSensor::restart()
         if(_sensor[i]->init())
         {
             _sensor[i]->setAddress(SENSOR_HW_ADDRESS[i]);
-            _sensor[i]->setMeasurementTimingBudget(80);
+            DistanceSensorTiming timing;
+            getTiming(i, timing);
+            _sensor[i]->setMeasurementTimingBudget(timing.timing_budget_ms);
             _is_active[i]=true;
-            _last_sensor_index = i;
             result++;
         }
         else
         {
             _xshout[i]->write(0);
         }
+        _health[i].active = _is_active[i];
+        _health[i].retry_ms = DISTANCE_SENSORS_RETRY_MIN_MS;
+        _retry_at_ms[i] = now + DISTANCE_SENSORS_RETRY_MIN_MS;
     }
 
     return result;
 }
 
+bool MultiDistanceSensor::startSensor(int sensor)
+{
+    DistanceSensorTiming timing;
+    getTiming(sensor, timing);
+    _sensor[sensor]->setDefaultAddress();
+    _xshout[sensor]->write(1);
+    ThisThread::sleep_for(2);
+
+    // init() of a missing sensor would hold the bus until its timeout, probe the model id first
+    uint8_t model_id = 0;
+    I2CTransaction probe = {DEFAULT_HW_ADDRESS, {VL53L0X::IDENTIFICATION_MODEL_ID, 0}, 1, &model_id, 1, 0};
+    if(_bus->run(&probe, 1) != 0 || model_id != 0xEE || !_sensor[sensor]->init())
+    {
+        _xshout[sensor]->write(0);
+        return false;
+    }
+    _sensor[sensor]->setAddress(SENSOR_HW_ADDRESS[sensor]);
+    _sensor[sensor]->setMeasurementTimingBudget(timing.timing_budget_ms);
+    if(_sensors_enabled)
+        _sensor[sensor]->startContinuous(timing.period_ms);
+    _next_poll_ms[sensor] = Kernel::get_ms_count();
+    _is_active[sensor] = true;
+    return true;
+}
+
+void MultiDistanceSensor::sensorFailure(int sensor, uint64_t now)
+{
+    _xshout[sensor]->write(0);
+    _is_active[sensor] = false;
+    CriticalSectionLock lock;
+    _health[sensor].active = false;
+    _health[sensor].errors++;
+    _retry_at_ms[sensor] = now + _health[sensor].retry_ms;
+}
+
+void MultiDistanceSensor::applyTiming(uint64_t now)
+{
+    // only the sensor with the new timing is reset, the others keep ranging
+    for(int i=0; _timing_changed && i<NUM_DISTANCE_SENSORS; i++)
+    {
+        if(!(_timing_changed & (1 << i)))
+            continue;
+        {
+            CriticalSectionLock lock;
+            _timing_changed &= ~(1 << i);
+        }
+        // an inactive sensor gets the timing when it is restarted
+        if(!_is_active[i])
+            continue;
+        _xshout[i]->write(0);
+        _is_active[i] = false;
+        ThisThread::sleep_for(2);
+        if(!startSensor(i))
+            sensorFailure(i, now);
+    }
+}
+
+void MultiDistanceSensor::restartFailedSensors(uint64_t now)
+{
+    // only the failed sensor is reset, the others keep ranging
+    for(int i=0;i<NUM_DISTANCE_SENSORS;i++)
+    {
+        if(_is_active[i] || now < _retry_at_ms[i])
+            continue;
+        bool ok = startSensor(i);
+        CriticalSectionLock lock;
+        if(ok)
+        {
+            _health[i].active = true;
+            _health[i].restarts++;
+            _health[i].retry_ms = DISTANCE_SENSORS_RETRY_MIN_MS;
+        }
+        else
+        {
+            _health[i].failed_restarts++;
+            _health[i].retry_ms = min<uint32_t>(2 * _health[i].retry_ms, DISTANCE_SENSORS_RETRY_MAX_MS);
+            _retry_at_ms[i] = Kernel::get_ms_count() + _health[i].retry_ms;
+        }
+    }
+}
+
+bool MultiDistanceSensor::getHealth(int sensor, DistanceSensorHealth & health)
+{
+    if(sensor < 0 || sensor >= NUM_DISTANCE_SENSORS)
+        return false;
+    CriticalSectionLock lock;
+    health = _health[sensor];
+    return true;
+}
+
+bool MultiDistanceSensor::setFilter(int sensor, const RangeFilterParams & params)
+{
+    if(sensor < 0 || sensor >= NUM_DISTANCE_SENSORS)
+        return false;
+    CriticalSectionLock lock;
+    _filter_params[sensor] = params;
+    _filter_changed |= 1 << sensor;
+    return true;
+}
+
+void MultiDistanceSensor::getFilter(int sensor, RangeFilterParams & params)
+{
+    CriticalSectionLock lock;
+    params = _filter_params[sensor];
+}
+
+uint32_t MultiDistanceSensor::getBusRecoveries()
+{
+    return _bus_recoveries;
+}
+
 void MultiDistanceSensor::stop()
 {
     for(int i=0;i<NUM_DISTANCE_SENSORS;i++)
@@ -109,23 +251,44 @@ void MultiDistanceSensor::stop()
 
 void MultiDistanceSensor::start()
 {
+    uint64_t now = Kernel::get_ms_count();
     for(int i=0;i<NUM_DISTANCE_SENSORS;i++)
     {
         if(_is_active[i])
         {
             // _sensor[i]->setTimeout(100);
-            _sensor[i]->startContinuous(100);
+            DistanceSensorTiming timing;
+            getTiming(i, timing);
+            _sensor[i]->startContinuous(timing.period_ms);
+            _next_poll_ms[i] = now;
         }
     }
     _sensors_enabled = true;
 }
 
+bool MultiDistanceSensor::setTiming(int sensor, const DistanceSensorTiming & timing)
+{
+    if(sensor < 0 || sensor >= NUM_DISTANCE_SENSORS)
+        return false;
+    CriticalSectionLock lock;
+    _timing[sensor] = timing;
+    _timing_changed |= 1 << sensor;
+    return true;
+}
+
+void MultiDistanceSensor::getTiming(int sensor, DistanceSensorTiming & timing)
+{
+    CriticalSectionLock lock;
+    timing = _timing[sensor];
+}
+
 int MultiDistanceSensor::init()
 {
     if(_initialized)
         return 0;
     
-    _i2c = new I2C(SENSORS_SDA_PIN,SENSORS_SCL_PIN);        
+    _i2c = new RecoverableI2C(SENSORS_SDA_PIN,SENSORS_SCL_PIN);        
+    _bus = new I2CTransactionQueue(*_i2c);
 
     for(int i=0;i<NUM_DISTANCE_SENSORS;i++){
         _sensor[i] = new VL53L0X(*_i2c);
@@ -169,7 +332,7 @@ void MultiDistanceSensor::sensors_loop()
 
         if (_sensors_enabled) runMeasurement();
         
-        ThisThread::sleep_for(10);
+        ThisThread::sleep_for(DISTANCE_SENSORS_POLL_INTERVAL_MS);
     }
 }
 
@@ -187,7 +350,10 @@ void MultiDistanceSensor::processOut()
             return;
         
         memcpy(&msg->range,&_m.range,sizeof(_m.range));
-        msg->timestamp = _m.timestamp;
+        memcpy(&msg->confidence,&_m.confidence,sizeof(_m.confidence));
+        memcpy(&msg->timestamp,&_m.timestamp,sizeof(_m.timestamp));
+        msg->updated = _m.updated;
+        msg->rejected = _m.rejected;
         msg->status = _m.status;
         distance_sensor_mail_box.put(msg);
     }
@@ -195,53 +361,126 @@ void MultiDistanceSensor::processOut()
 
 void MultiDistanceSensor::runMeasurement()
 {
-    if(_last_sensor_index == -1)
+    PROFILE_SCOPE("range");
+    uint64_t now = Kernel::get_ms_count();
+    applyTiming(now);
+    restartFailedSensors(now);
+
+    for(int i=0; _filter_changed && i<NUM_DISTANCE_SENSORS; i++)
     {
-        _m.status = ERR_NOT_INIT;
-        return processOut();
+        if(!(_filter_changed & (1 << i)))
+            continue;
+        RangeFilterParams params;
+        getFilter(i, params);
+        _filter[i].setParams(params);
+        CriticalSectionLock lock;
+        _filter_changed &= ~(1 << i);
     }
 
-    bool is_measurement_ready = (_sensor[_last_sensor_index]->readReg(VL53L0X::RESULT_INTERRUPT_STATUS) & 0x07); 
-    
-    if (_sensor[_last_sensor_index]->last_status != 0)
+    // status of every active sensor whose next measurement may be ready, in one chained sequence
+    now = Kernel::get_ms_count();
+    int n = 0;
+    int sensor_index[NUM_DISTANCE_SENSORS];
+    for(int i=0; i<NUM_DISTANCE_SENSORS; i++)
     {
-        _xshout[_last_sensor_index]->write(0);
-        _is_active[_last_sensor_index] = false;
-
-        _m.status = ERR_I2C_FAILURE;
-        _m.timestamp = Kernel::get_ms_count();
-        for(int i=0; i<NUM_DISTANCE_SENSORS; i++) _m.range[i] = -1.0f;         
-        
-        return processOut();
+        if(!_is_active[i] || now < _next_poll_ms[i])
+            continue;
+        I2CTransaction & poll = _transactions[n];
+        poll.address = SENSOR_HW_ADDRESS[i];
+        poll.tx[0] = VL53L0X::RESULT_INTERRUPT_STATUS;
+        poll.tx_len = 1;
+        poll.rx = &_interrupt_status[i];
+        poll.rx_len = 1;
+        sensor_index[n++] = i;
     }
-    else if(!is_measurement_ready)
-    {
+
+    _m.updated = 0;
+    _m.rejected = 0;
+    _m.status = ERR_NONE;
+    if(n == 0)
         return;
+    _bus->run(_transactions, n);
+
+    // result block (range status, signal and ambient rates, range) and interrupt clear of the ready sensors, in one chained sequence
+    int ready[NUM_DISTANCE_SENSORS];
+    int m = 0;
+    for(int k=0; k<n; k++)
+    {
+        int i = sensor_index[k];
+        if(_transactions[k].result != 0)
+        {
+            sensorFailure(i, now);
+            _m.range[i] = -1.0f;
+            _m.confidence[i] = 0.0f;
+            _m.timestamp[i] = now;
+            _m.updated |= 1 << i;
+            _m.status = ERR_I2C_FAILURE;
+        }
+        else if(_interrupt_status[i] & 0x07)
+        {
+            ready[m++] = i;
+        }
     }
-    else
+    for(int k=0; k<m; k++)
     {
-        _m.timestamp = Kernel::get_ms_count();
-        _m.status = ERR_NONE;
+        int i = ready[k];
+        I2CTransaction & read = _transactions[2 * k];
+        read.address = SENSOR_HW_ADDRESS[i];
+        read.tx[0] = VL53L0X::RESULT_RANGE_STATUS;
+        read.tx_len = 1;
+        read.rx = _range_data[i];
+        read.rx_len = sizeof(_range_data[i]);
+        I2CTransaction & clear = _transactions[2 * k + 1];
+        clear.address = SENSOR_HW_ADDRESS[i];
+        clear.tx[0] = VL53L0X::SYSTEM_INTERRUPT_CLEAR;
+        clear.tx[1] = 0x01;
+        clear.tx_len = 2;
+        clear.rx = NULL;
+        clear.rx_len = 0;
+    }
+    if(m > 0)
+        _bus->run(_transactions, 2 * m);
 
-        for(int i=0; i<NUM_DISTANCE_SENSORS; i++)
+    for(int k=0; k<m; k++)
+    {
+        int i = ready[k];
+        _m.timestamp[i] = now;
+        _m.updated |= 1 << i;
+        if(_transactions[2 * k].result == 0 && _transactions[2 * k + 1].result == 0)
         {
-            if(_is_active[i])
+            const uint8_t * data = _range_data[i];
+            uint16_t range = ((uint16_t)data[10] << 8) | data[11];
+            float signal = (((uint16_t)data[6] << 8) | data[7]) / 128.0f;  // 9.7 fixed point [MCPS]
+            float ambient = (((uint16_t)data[8] << 8) | data[9]) / 128.0f; // 9.7 fixed point [MCPS]
+            _m.confidence[i] = RangeFilter::confidence((data[0] & 0x78) >> 3, signal, ambient);
+            _m.range[i] = _filter[i].update((float) range / 1000.0f, _m.confidence[i], (uint32_t)now);
+            if(_m.range[i] < 0.0f)
             {
-                uint16_t range = _sensor[i]->readRangeContinuousMillimeters(false);
-                if(_sensor[i]->last_status == 0)
-                {
-                    _m.range[i] = (float) range / 1000.0;
-                }
-                else
-                {
-                    _m.range[i] = -1.0;
-                    _is_active[i] = false;
-                    _xshout[i]->write(0);     
-                    _m.status = ERR_I2C_FAILURE;
-                }
+                _m.rejected |= 1 << i;
+                CriticalSectionLock lock;
+                _health[i].rejected++;
             }
+            // the next result will not be ready before the end of the inter-measurement period
+            DistanceSensorTiming timing;
+            getTiming(i, timing);
+            _next_poll_ms[i] = now + timing.period_ms - min<uint32_t>(timing.period_ms, DISTANCE_SENSORS_POLL_MARGIN_MS);
         }
-        
-        return processOut();
+        else
+        {
+            sensorFailure(i, now);
+            _m.range[i] = -1.0;
+            _m.confidence[i] = 0.0f;
+            _m.status = ERR_I2C_FAILURE;
+        }
+    }
+
+    // a slave may hold the bus after a failed transfer
+    if(_m.status == ERR_I2C_FAILURE)
+    {
+        _i2c->recover();
+        _bus_recoveries++;
     }
-}
\ No newline at end of file
+
+    if(_m.updated)
+        return processOut();
+}
@@ -2,9 +2,16 @@
 #define __MULTI_DISTANCE_SENSOR_H__
 
 #include "internal/vl53l0x-mbed/VL53L0X.h"
+#include "I2CTransactionQueue.h"
+#include "RecoverableI2C.h"
+#include "RangeFilter.h"
 
 #define NUM_DISTANCE_SENSORS 4
-#define DISTANCE_SENSORS_DEFAULT_I2C_FREQ 100000U
+#define DISTANCE_SENSORS_DEFAULT_I2C_FREQ MBED_CONF_MULTI_DISTANCE_SENSOR_I2C_FREQUENCY
+#define DISTANCE_SENSORS_POLL_INTERVAL_MS 5 /**< Status polling interval of the sensors thread.*/
+#define DISTANCE_SENSORS_POLL_MARGIN_MS 10   /**< Polling of a sensor starts this long before its next expected measurement.*/
+#define DISTANCE_SENSORS_RETRY_MIN_MS 100    /**< First restart attempt after a sensor failure.*/
+#define DISTANCE_SENSORS_RETRY_MAX_MS 5000   /**< Limit of the exponential restart backoff.*/
 
 enum SensorSelector : uint8_t
 {
@@ -14,13 +21,41 @@ enum SensorSelector : uint8_t
     SENSOR_RL = 3
 };
 
+/**
+ * @brief Ranging timing of one sensor.
+ */
+struct DistanceSensorTiming
+{
+    uint32_t timing_budget_ms; ///< Time budget of one ranging.
+    uint32_t period_ms;        ///< Inter-measurement period of the continuous ranging.
+};
+
+/**
+ * @brief New ranges of the sensors that became ready at the same poll.
+ */
 struct SensorsMeasurement
 {
-    float range[4];
-    uint32_t timestamp;
+    float range[4];        ///< Filtered range [m], -1 on failure or rejection.
+    float confidence[4];   ///< Confidence of the last sample from 0 to 1.
+    uint32_t timestamp[4]; ///< Time of each range [ms].
+    uint8_t updated;       ///< Bit i is set if range[i] and timestamp[i] are new.
+    uint8_t rejected;      ///< Bit i is set if the new sample was rejected by the filter.
     uint8_t status;
 };
 
+/**
+ * @brief Health counters of one sensor.
+ */
+struct DistanceSensorHealth
+{
+    bool active;              ///< The sensor is ranging.
+    uint32_t errors;          ///< I2C errors while ranging.
+    uint32_t restarts;        ///< Successful restarts after a failure.
+    uint32_t failed_restarts; ///< Failed restart attempts.
+    uint32_t retry_ms;        ///< Current restart backoff.
+    uint32_t rejected;        ///< Samples rejected by the range filter.
+};
+
 extern Mail<SensorsMeasurement, 5> distance_sensor_mail_box;
 extern Mail<uint8_t, 5> distance_sensor_commands;
 
@@ -38,6 +73,35 @@ public:
     };
     static MultiDistanceSensor & getInstance();    
     int init();
+
+    /**
+     * @brief Set the ranging timing of a sensor.
+     *
+     * The sensors thread restarts the sensor with the new timing, the others keep ranging.
+     * @return false if the sensor index is invalid
+     */
+    bool setTiming(int sensor, const DistanceSensorTiming & timing);
+
+    void getTiming(int sensor, DistanceSensorTiming & timing);
+
+    /**
+     * @brief Copy health counters of a sensor.
+     * @return false if the sensor index is invalid
+     */
+    bool getHealth(int sensor, DistanceSensorHealth & health);
+
+    /**
+     * @brief Set the range filter of a sensor.
+     *
+     * The filter is reset when the sensors thread applies the parameters.
+     * @return false if the sensor index is invalid
+     */
+    bool setFilter(int sensor, const RangeFilterParams & params);
+
+    void getFilter(int sensor, RangeFilterParams & params);
+
+    /** Number of I2C bus recoveries. */
+    uint32_t getBusRecoveries();
     
 private:
     static MultiDistanceSensor * _instance;
@@ -49,14 +113,30 @@ private:
     int restart();
     void sensors_loop();
     void processOut();
+    bool startSensor(int sensor);
+    void restartFailedSensors(uint64_t now);
+    void sensorFailure(int sensor, uint64_t now);
+    void applyTiming(uint64_t now);
 
-    I2C * _i2c;
+    RecoverableI2C * _i2c;
+    I2CTransactionQueue * _bus;
+    I2CTransaction _transactions[2 * NUM_DISTANCE_SENSORS];
+    uint8_t _interrupt_status[NUM_DISTANCE_SENSORS];
+    uint8_t _range_data[NUM_DISTANCE_SENSORS][12];
+    RangeFilter _filter[NUM_DISTANCE_SENSORS];
+    RangeFilterParams _filter_params[NUM_DISTANCE_SENSORS];
+    uint8_t _filter_changed;
+    DistanceSensorTiming _timing[NUM_DISTANCE_SENSORS];
+    uint8_t _timing_changed;
+    uint64_t _next_poll_ms[NUM_DISTANCE_SENSORS];
+    DistanceSensorHealth _health[NUM_DISTANCE_SENSORS];
+    uint64_t _retry_at_ms[NUM_DISTANCE_SENSORS];
+    uint32_t _bus_recoveries;
     DigitalInOut * _xshout[NUM_DISTANCE_SENSORS];
     VL53L0X * _sensor[NUM_DISTANCE_SENSORS];
     bool _is_active[NUM_DISTANCE_SENSORS];
     bool _initialized;
     bool _sensors_enabled;
-    int _last_sensor_index;
     SensorsMeasurement _m;
     Thread _distance_sensor_thread;
 };
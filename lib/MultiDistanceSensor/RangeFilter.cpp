@@ -0,0 +1,81 @@
+#include "RangeFilter.h"
+
+#define DEVICE_RANGE_STATUS_VALID 11
+
+const RangeFilterParams RangeFilter::DEFAULT_PARAMS = {1, 0.0f, 0.0f};
+
+RangeFilter::RangeFilter()
+: _params(DEFAULT_PARAMS)
+{
+    reset();
+}
+
+void RangeFilter::setParams(const RangeFilterParams & params)
+{
+    _params = params;
+    if (_params.window < 1)
+        _params.window = 1;
+    if (_params.window > RANGE_FILTER_MAX_WINDOW)
+        _params.window = RANGE_FILTER_MAX_WINDOW;
+    reset();
+}
+
+void RangeFilter::getParams(RangeFilterParams & params) const
+{
+    params = _params;
+}
+
+void RangeFilter::reset()
+{
+    _count = 0;
+    _next = 0;
+    _last_output = 0.0f;
+    _last_timestamp_ms = 0;
+    _has_output = false;
+}
+
+float RangeFilter::update(float range, float confidence, uint32_t timestamp_ms)
+{
+    if (confidence < _params.min_confidence)
+        return -1.0f;
+
+    _window[_next] = range;
+    _next = (_next + 1) % _params.window;
+    if (_count < _params.window)
+        _count++;
+
+    // median of the filled part of the window, insertion sort of at most 7 values
+    float sorted[RANGE_FILTER_MAX_WINDOW];
+    for (int i = 0; i < _count; i++)
+    {
+        float v = _window[i];
+        int j = i - 1;
+        for (; j >= 0 && sorted[j] > v; j--)
+            sorted[j + 1] = sorted[j];
+        sorted[j + 1] = v;
+    }
+    float out = sorted[_count / 2];
+
+    if (_params.max_rate > 0.0f && _has_output)
+    {
+        float max_step = _params.max_rate * (timestamp_ms - _last_timestamp_ms) * 1e-3f;
+        if (out > _last_output + max_step)
+            out = _last_output + max_step;
+        else if (out < _last_output - max_step)
+            out = _last_output - max_step;
+    }
+
+    _last_output = out;
+    _last_timestamp_ms = timestamp_ms;
+    _has_output = true;
+    return out;
+}
+
+float RangeFilter::confidence(uint8_t device_range_status, float signal_mcps, float ambient_mcps)
+{
+    if (device_range_status != DEVICE_RANGE_STATUS_VALID || signal_mcps <= 0.0f)
+        return 0.0f;
+    float snr = signal_mcps / (signal_mcps + ambient_mcps);
+    float strength = signal_mcps < RANGE_FILTER_GOOD_SIGNAL_MCPS ? signal_mcps / RANGE_FILTER_GOOD_SIGNAL_MCPS : 1.0f;
+    return snr * strength;
+}
@@ -0,0 +1,71 @@
+/** @file RangeFilter.h
+ * Streaming filter of the range of one distance sensor.
+ *
+ * Samples with low confidence are rejected, the accepted ones pass a fixed-window median
+ * and a rate-of-change limiter. The filter keeps its window in a static array, so it never
+ * allocates memory. With the default parameters it passes the samples unchanged.
+ */
+#ifndef __RANGE_FILTER_H__
+#define __RANGE_FILTER_H__
+
+#include <stdint.h>
+
+#define RANGE_FILTER_MAX_WINDOW 7          /**< Longest median window.*/
+#define RANGE_FILTER_GOOD_SIGNAL_MCPS 1.0f /**< Return signal rate with full confidence [MCPS].*/
+
+/**
+ * @brief Parameters of the range filter.
+ */
+struct RangeFilterParams
+{
+    uint8_t window;       ///< Median window length, 1 - no median, at most RANGE_FILTER_MAX_WINDOW.
+    float max_rate;       ///< Limit of the range rate of change [m/s], 0 - no limit.
+    float min_confidence; ///< Samples with lower confidence are rejected, 0 - accept all.
+};
+
+class RangeFilter
+{
+public:
+    static const RangeFilterParams DEFAULT_PARAMS;
+
+    RangeFilter();
+
+    void setParams(const RangeFilterParams & params);
+
+    void getParams(RangeFilterParams & params) const;
+
+    /** Forget the past samples. */
+    void reset();
+
+    /**
+     * @brief Filter a new sample.
+     * @param range measured range [m]
+     * @param confidence sample confidence from confidence()
+     * @param timestamp_ms time of the sample
+     * @return filtered range or -1 if the sample is rejected
+     */
+    float update(float range, float confidence, uint32_t timestamp_ms);
+
+    /**
+     * @brief Confidence of a VL53L0X sample.
+     *
+     * Zero for samples without valid range status, otherwise the ratio of the return signal
+     * to the ambient light scaled by the signal strength.
+     * @param device_range_status bits [6:3] of RESULT_RANGE_STATUS register
+     * @param signal_mcps return signal rate [MCPS]
+     * @param ambient_mcps ambient rate [MCPS]
+     * @return confidence from 0 to 1
+     */
+    static float confidence(uint8_t device_range_status, float signal_mcps, float ambient_mcps);
+
+private:
+    RangeFilterParams _params;
+    float _window[RANGE_FILTER_MAX_WINDOW];
+    int _count;
+    int _next;
+    float _last_output;
+    uint32_t _last_timestamp_ms;
+    bool _has_output;
+};
+
+#endif /* __RANGE_FILTER_H__ */
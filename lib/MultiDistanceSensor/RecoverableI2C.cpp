@@ -0,0 +1,35 @@
+#include "RecoverableI2C.h"
+
+#define RECOVERY_HALF_PERIOD_US 5 // 100 kHz
+#define RECOVERY_MAX_CLOCKS 9
+
+void RecoverableI2C::recover()
+{
+    lock();
+    {
+        DigitalInOut scl(_scl_pin, PIN_OUTPUT, OpenDrainPullUp, 1);
+        DigitalInOut sda(_sda_pin, PIN_OUTPUT, OpenDrainPullUp, 1);
+        wait_us(RECOVERY_HALF_PERIOD_US);
+        for(int i = 0; i < RECOVERY_MAX_CLOCKS && sda.read() == 0; i++)
+        {
+            scl = 0;
+            wait_us(RECOVERY_HALF_PERIOD_US);
+            scl = 1;
+            wait_us(RECOVERY_HALF_PERIOD_US);
+        }
+        // STOP - SDA rises while SCL is high
+        scl = 0;
+        wait_us(RECOVERY_HALF_PERIOD_US);
+        sda = 0;
+        wait_us(RECOVERY_HALF_PERIOD_US);
+        scl = 1;
+        wait_us(RECOVERY_HALF_PERIOD_US);
+        sda = 1;
+        wait_us(RECOVERY_HALF_PERIOD_US);
+    }
+    // give the pins back to the peripheral
+    i2c_init(&_i2c, _sda_pin, _scl_pin);
+    _owner = NULL;
+    unlock();
+    frequency(_hz);
+}
@@ -0,0 +1,32 @@
+/** @file RecoverableI2C.h
+ * I2C master with bus recovery.
+ */
+#ifndef __RECOVERABLE_I2C_H__
+#define __RECOVERABLE_I2C_H__
+
+#include <mbed.h>
+
+class RecoverableI2C : public I2C
+{
+public:
+    RecoverableI2C(PinName sda, PinName scl)
+    : I2C(sda, scl)
+    , _sda_pin(sda)
+    , _scl_pin(scl)
+    {}
+
+    /**
+     * @brief Release the bus after an aborted transfer.
+     *
+     * A slave interrupted in the middle of a byte may hold SDA low forever. SCL is clocked
+     * manually until the slave releases SDA, a STOP condition is generated and the I2C
+     * peripheral is initialised again.
+     */
+    void recover();
+
+private:
+    PinName _sda_pin;
+    PinName _scl_pin;
+};
+
+#endif /* __RECOVERABLE_I2C_H__ */
@@ -0,0 +1,126 @@
+#include "Profiler.h"
+
+#if !defined(DWT)
+#include <chrono>
+#endif
+
+ProfilerProbe Profiler::_probes[PROFILER_MAX_PROBES];
+int Profiler::_num_probes = 0;
+
+static void clearStats(ProfilerProbe & probe)
+{
+    probe.count = 0;
+    probe.min = UINT32_MAX;
+    probe.max = 0;
+    probe.sum = 0;
+    memset(probe.histogram, 0, sizeof(probe.histogram));
+}
+
+void Profiler::init()
+{
+#if defined(DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+ProfilerProbe * Profiler::getProbe(const char * name)
+{
+    CriticalSectionLock lock;
+    for (int i = 0; i < _num_probes; i++)
+    {
+        if (strcmp(_probes[i].name, name) == 0)
+            return &_probes[i];
+    }
+    if (_num_probes == PROFILER_MAX_PROBES)
+        return NULL;
+    if (_num_probes == 0)
+        init();
+    ProfilerProbe & probe = _probes[_num_probes++];
+    probe.name = name;
+    clearStats(probe);
+    return &probe;
+}
+
+uint32_t Profiler::now()
+{
+#if defined(DWT)
+    return DWT->CYCCNT;
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t Profiler::ticksPerUs()
+{
+#if defined(DWT)
+    return SystemCoreClock / 1000000;
+#else
+    return 1000;
+#endif
+}
+
+void Profiler::record(ProfilerProbe * probe, uint32_t ticks)
+{
+    int bin = 0;
+    for (uint32_t v = ticks >> (PROFILER_HISTOGRAM_SHIFT + 1); v && bin < PROFILER_HISTOGRAM_BINS - 1; v >>= 1)
+        bin++;
+    CriticalSectionLock lock;
+    probe->count++;
+    probe->sum += ticks;
+    if (ticks < probe->min)
+        probe->min = ticks;
+    if (ticks > probe->max)
+        probe->max = ticks;
+    probe->histogram[bin]++;
+}
+
+void Profiler::reset()
+{
+    CriticalSectionLock lock;
+    for (int i = 0; i < _num_probes; i++)
+        clearStats(_probes[i]);
+}
+
+bool Profiler::getStats(int index, ProfilerProbe & stats)
+{
+    CriticalSectionLock lock;
+    if (index < 0 || index >= _num_probes)
+        return false;
+    stats = _probes[index];
+    return true;
+}
+
+int Profiler::print(char * buffer, size_t size, const char * name)
+{
+    ProfilerProbe p;
+    float us = (float)ticksPerUs();
+    int len = 0;
+    buffer[0] = 0;
+    for (int i = 0; getStats(i, p); i++)
+    {
+        if (name != NULL && strcmp(name, p.name) != 0)
+            continue;
+        float mean = p.count ? (float)p.sum / p.count / us : 0.0f;
+        float min = p.count ? p.min / us : 0.0f;
+        len += snprintf(buffer + len, size - len, "%s %lu %.1f %.1f %.1f\n",
+                        p.name, (unsigned long)p.count, min, mean, p.max / us);
+        if (name != NULL)
+        {
+            // bins are labeled with their upper limits in us, the last one with its lower limit
+            for (int k = 0; k < PROFILER_HISTOGRAM_BINS - 1 && len < (int)size; k++)
+                len += snprintf(buffer + len, size - len, "<%.0f:%lu ",
+                                (float)(1UL << (PROFILER_HISTOGRAM_SHIFT + k + 1)) / us, (unsigned long)p.histogram[k]);
+            if (len < (int)size)
+                len += snprintf(buffer + len, size - len, ">=%.0f:%lu",
+                                (float)(1UL << (PROFILER_HISTOGRAM_SHIFT + PROFILER_HISTOGRAM_BINS - 1)) / us,
+                                (unsigned long)p.histogram[PROFILER_HISTOGRAM_BINS - 1]);
+            return len < (int)size ? len : (int)size - 1;
+        }
+        if (len >= (int)size)
+            return size - 1;
+    }
+    return name == NULL ? len : -1;
+}
@@ -0,0 +1,105 @@
+/** @file Profiler.h
+ * Lightweight execution time probes.
+ *
+ * Each probe has a name and records min/max/mean and a log2 histogram of the time spent
+ * in the profiled section. The time is measured in CPU cycles (DWT CYCCNT) on target and
+ * in nanoseconds (std::chrono) on host. Probes live in a fixed size static table.
+ */
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <mbed.h>
+
+#define PROFILER_MAX_PROBES 8        /**< Size of the static probe table.*/
+#define PROFILER_HISTOGRAM_BINS 12   /**< Number of histogram bins.*/
+#define PROFILER_HISTOGRAM_SHIFT 10  /**< Bin 0 holds samples below 2^(SHIFT+1) ticks, bin k samples in [2^(SHIFT+k), 2^(SHIFT+k+1)).*/
+
+/**
+ * @brief Statistics of one profiled section.
+ */
+struct ProfilerProbe
+{
+    const char * name;                          ///< Probe name.
+    uint32_t count;                             ///< Number of samples.
+    uint32_t min;                               ///< Shortest sample [ticks].
+    uint32_t max;                               ///< Longest sample [ticks].
+    uint64_t sum;                               ///< Sum of samples [ticks].
+    uint32_t histogram[PROFILER_HISTOGRAM_BINS]; ///< Number of samples in each bin.
+};
+
+class Profiler
+{
+public:
+    /**
+     * @brief Find a probe by name or allocate a new one.
+     * @return probe or NULL if the table is full
+     */
+    static ProfilerProbe * getProbe(const char * name);
+
+    /** Current value of the time base [ticks]. */
+    static uint32_t now();
+
+    /** Number of ticks per microsecond. */
+    static uint32_t ticksPerUs();
+
+    static void record(ProfilerProbe * probe, uint32_t ticks);
+
+    /** Clear statistics of all probes (names are kept). */
+    static void reset();
+
+    /**
+     * @brief Copy statistics of a probe.
+     * @return false if there is no probe with the index
+     */
+    static bool getStats(int index, ProfilerProbe & stats);
+
+    /**
+     * @brief Print statistics into a buffer.
+     *
+     * With name == NULL prints one line "name count min mean max" (us) per probe, otherwise
+     * prints the statistics and the histogram of the selected probe.
+     * @return number of printed characters or -1 if there is no such probe
+     */
+    static int print(char * buffer, size_t size, const char * name = NULL);
+
+private:
+    static void init();
+    static ProfilerProbe _probes[PROFILER_MAX_PROBES];
+    static int _num_probes;
+};
+
+/**
+ * @brief Records the time between its construction and destruction.
+ */
+class ProfilerScope : NonCopyable<ProfilerScope>
+{
+public:
+    ProfilerScope(ProfilerProbe * probe)
+    : _probe(probe)
+    , _start(Profiler::now())
+    {}
+
+    ~ProfilerScope()
+    {
+        if (_probe)
+            Profiler::record(_probe, Profiler::now() - _start);
+    }
+
+private:
+    ProfilerProbe * _probe;
+    uint32_t _start;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#if MBED_CONF_PROFILER_ENABLED
+/** Profile the rest of the enclosing scope with the named probe. */
+#define PROFILE_SCOPE(name) \
+    static ProfilerProbe * PROFILER_CONCAT(_profiler_probe_, __LINE__) = Profiler::getProbe(name); \
+    ProfilerScope PROFILER_CONCAT(_profiler_scope_, __LINE__)(PROFILER_CONCAT(_profiler_probe_, __LINE__))
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#endif /* MBED_CONF_PROFILER_ENABLED */
+
+#endif /* __PROFILER_H__ */
@@ -0,0 +1,105 @@
+#include "HeadingFilter.h"
+#include <math.h>
+
+const HeadingFilterParams HeadingFilter::DEFAULT_PARAMS = {2.0f, 2.0f, 0.01f};
+
+HeadingFilter::HeadingFilter()
+: _params(DEFAULT_PARAMS)
+, _bias(0.0f)
+{
+    reset(0.0);
+}
+
+void HeadingFilter::setParams(const HeadingFilterParams & params)
+{
+    _params = params;
+    if (_params.time_constant < 0.0f)
+        _params.time_constant = 0.0f;
+    if (_params.bias_time_constant < 0.0f)
+        _params.bias_time_constant = 0.0f;
+    if (_params.slip_rate < 0.0f)
+        _params.slip_rate = 0.0f;
+}
+
+void HeadingFilter::getParams(HeadingFilterParams & params) const
+{
+    params = _params;
+}
+
+void HeadingFilter::reset(double yaw)
+{
+    // the gyro bias is kept, it belongs to the sensor
+    _yaw = yaw;
+    _wheel_ref = yaw;
+    _wheel_yaw = 0.0;
+    _gyro_delta = 0.0;
+    _gyro_sum = 0.0f;
+    _gyro_time = 0.0f;
+    _rate = 0.0f;
+    _gyro_us = 0;
+    _wheel_us = 0;
+    _gyro_latched = false;
+    _wheel_latched = false;
+    _stationary = false;
+    _slipping = false;
+}
+
+void HeadingFilter::updateGyro(float rate, uint32_t timestamp_us)
+{
+    uint32_t dt_us = timestamp_us - _gyro_us;
+    // every FIFO packet carries its own ready time, so a batch drained at once is integrated over
+    // the sample periods; after a gap longer than the timeout the sample only restarts the timing
+    bool fresh = _gyro_latched && dt_us < HEADING_FILTER_GYRO_TIMEOUT_US;
+    _gyro_us = timestamp_us;
+    _gyro_latched = true;
+    if (!fresh)
+        return;
+
+    float dt = dt_us * 1e-6f;
+    _gyro_sum += rate * dt;
+    _gyro_time += dt;
+    _rate = rate - _bias;
+    _gyro_delta += _rate * dt;
+}
+
+void HeadingFilter::updateWheels(double wheel_yaw, bool stationary, uint32_t timestamp_us)
+{
+    if (!_wheel_latched)
+    {
+        _wheel_yaw = wheel_yaw;
+        _wheel_us = timestamp_us;
+        _wheel_latched = true;
+        return;
+    }
+    double wheel_delta = wheel_yaw - _wheel_yaw;
+    float dt = (timestamp_us - _wheel_us) * 1e-6f;
+    _wheel_yaw = wheel_yaw;
+    _wheel_us = timestamp_us;
+
+    // only samples between two standing wheel updates are averaged into the bias
+    if (stationary && _stationary && _gyro_time > 0.0f && _params.bias_time_constant > 0.0f)
+        _bias += (_gyro_sum / _gyro_time - _bias) * _gyro_time / (_params.bias_time_constant + _gyro_time);
+    _gyro_sum = 0.0f;
+    _gyro_time = 0.0f;
+    _stationary = stationary;
+
+    bool gyro = _gyro_latched && timestamp_us - _gyro_us < HEADING_FILTER_GYRO_TIMEOUT_US && _params.time_constant > 0.0f;
+    if (gyro)
+    {
+        _slipping = fabs(wheel_delta - _gyro_delta) > _params.slip_rate * dt;
+        _wheel_ref += _slipping ? _gyro_delta : wheel_delta;
+        _yaw += _gyro_delta;
+    }
+    else
+    {
+        _slipping = false;
+        _wheel_ref += wheel_delta;
+        _yaw += wheel_delta;
+        _rate = dt > 0.0f ? (float)(wheel_delta / dt) : 0.0f;
+    }
+    _gyro_delta = 0.0;
+
+    // the wheel heading pulls the fused one back with the filter time constant
+    if (dt > 0.0f)
+        _yaw += (_wheel_ref - _yaw) * dt / (_params.time_constant + dt);
+}
@@ -0,0 +1,96 @@
+/** @file HeadingFilter.h
+ * Complementary filter of the heading from the gyro yaw rate and the wheel odometry.
+ *
+ * The gyro rate is integrated at the IMU rate and gives the short-term heading, the wheel
+ * heading corrects the slow gyro drift with the time constant of the filter. Skid steering
+ * slips in turns, so while the wheel yaw rate disagrees with the gyro the wheel reference
+ * follows the gyro instead and the slip does not leak into the heading. The gyro bias is
+ * estimated while the wheels stand still. Without gyro samples the filter follows the wheels.
+ */
+#ifndef __HEADING_FILTER_H__
+#define __HEADING_FILTER_H__
+
+#include <stdint.h>
+
+#define HEADING_FILTER_GYRO_TIMEOUT_US 500000UL /**< Older gyro samples are not integrated.*/
+
+/**
+ * @brief Parameters of the heading filter.
+ */
+struct HeadingFilterParams
+{
+    float time_constant;      ///< Time after which the wheel heading takes over [s], 0 - wheel heading only.
+    float bias_time_constant; ///< Averaging time of the gyro bias while standing [s], 0 - no bias estimation.
+    float slip_rate;          ///< Wheel and gyro yaw rate difference treated as slip [rad/s].
+};
+
+class HeadingFilter
+{
+public:
+    static const HeadingFilterParams DEFAULT_PARAMS;
+
+    HeadingFilter();
+
+    void setParams(const HeadingFilterParams & params);
+
+    void getParams(HeadingFilterParams & params) const;
+
+    /** Start from a heading, the next samples only latch the wheel heading and the gyro time. */
+    void reset(double yaw);
+
+    /**
+     * @brief Integrate a gyro sample over the time since the previous one.
+     * @param rate yaw rate [rad/s]
+     * @param timestamp_us sampling time (us_ticker)
+     */
+    void updateGyro(float rate, uint32_t timestamp_us);
+
+    /**
+     * @brief Correct the heading with the wheel odometry.
+     * @param wheel_yaw heading of the wheel odometry [rad], not wrapped
+     * @param stationary true if the wheels stand still
+     * @param timestamp_us encoder sampling time (us_ticker)
+     */
+    void updateWheels(double wheel_yaw, bool stationary, uint32_t timestamp_us);
+
+    double getYaw() const
+    {
+        return _yaw;
+    }
+
+    /** @return bias corrected gyro rate, or the wheel yaw rate without gyro samples [rad/s] */
+    float getRate() const
+    {
+        return _rate;
+    }
+
+    float getBias() const
+    {
+        return _bias;
+    }
+
+    /** @return true if the last wheel update disagreed with the gyro */
+    bool isSlipping() const
+    {
+        return _slipping;
+    }
+
+private:
+    HeadingFilterParams _params;
+    double _yaw;
+    double _wheel_ref;   // wheel heading in the frame of _yaw
+    double _wheel_yaw;   // last wheel heading
+    double _gyro_delta;  // gyro heading change since the last wheel update
+    float _gyro_sum;     // raw gyro heading change since the last wheel update
+    float _gyro_time;
+    float _rate;
+    float _bias;
+    uint32_t _gyro_us;
+    uint32_t _wheel_us;
+    bool _gyro_latched;
+    bool _wheel_latched;
+    bool _stationary;
+    bool _slipping;
+};
+
+#endif /* __HEADING_FILTER_H__ */
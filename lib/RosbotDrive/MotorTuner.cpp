@@ -0,0 +1,162 @@
+#include "MotorTuner.h"
+#include <string.h>
+
+#define CROSSING_LOW 0.283f  // response of a first order system at t = T/3
+#define CROSSING_HIGH 0.632f // response of a first order system at t = T
+
+const MotorTunerParams MotorTuner::DEFAULT_PARAMS = {
+    .duty_low = 0.3f,
+    .duty_high = 0.6f,
+    .level_us = 1000000,
+    .tc = 0.05f};
+
+MotorTuner::MotorTuner()
+: _params(DEFAULT_PARAMS)
+, _state(TUNER_IDLE)
+, _phase(LOW_SETTLE)
+, _duty(0.0f)
+{
+    memset(&_result, 0, sizeof(_result));
+}
+
+void MotorTuner::start(const MotorTunerParams & params)
+{
+    _params = params;
+    memset(&_result, 0, sizeof(_result));
+    memset(_level, 0, sizeof(_level));
+    memset(_sum, 0, sizeof(_sum));
+    memset(_prev_speed, 0, sizeof(_prev_speed));
+    for (int i = 0; i < 4; i++) _t28[i] = _t63[i] = -1.0f;
+    _phase = LOW_SETTLE;
+    _duty = _params.duty_low;
+    _time_us = 0;
+    _samples = 0;
+    _state = TUNER_RUNNING;
+}
+
+void MotorTuner::abort()
+{
+    if (_state == TUNER_RUNNING)
+        _state = TUNER_FAILED;
+}
+
+bool MotorTuner::update(const float * speed, uint32_t dt_us, float * duty)
+{
+    if (_state != TUNER_RUNNING)
+    {
+        for (int i = 0; i < 4; i++) duty[i] = 0.0f;
+        return false;
+    }
+
+    uint32_t prev_us = _time_us;
+    _time_us += dt_us;
+    if (_phase == HIGH_STEP)
+    {
+        // the last step is timed against the levels settled before it
+        for (int i = 0; i < 4; i++)
+        {
+            float low = _level[LOW_STEP][i];
+            float delta = _level[HIGH_SETTLE][i] - low;
+            float thresholds[2] = {low + CROSSING_LOW * delta, low + CROSSING_HIGH * delta};
+            float * crossing[2] = {&_t28[i], &_t63[i]};
+            for (int k = 0; k < 2; k++)
+            {
+                if (*crossing[k] >= 0.0f || (speed[i] - thresholds[k]) * delta < 0.0f)
+                    continue;
+                float frac = speed[i] != _prev_speed[i] ? (thresholds[k] - _prev_speed[i]) / (speed[i] - _prev_speed[i]) : 1.0f;
+                frac = frac < 0.0f ? 0.0f : (frac > 1.0f ? 1.0f : frac);
+                *crossing[k] = (prev_us + frac * dt_us) * 1e-6f;
+            }
+        }
+    }
+    for (int i = 0; i < 4; i++) _prev_speed[i] = speed[i];
+
+    // the second half of a level is settled
+    if (_time_us >= _params.level_us / 2)
+    {
+        for (int i = 0; i < 4; i++) _sum[i] += speed[i];
+        _samples++;
+    }
+
+    if (_time_us >= _params.level_us)
+    {
+        for (int i = 0; i < 4; i++) _level[_phase][i] = _samples ? _sum[i] / _samples : speed[i];
+        memset(_sum, 0, sizeof(_sum));
+        _samples = 0;
+        _time_us = 0;
+        if (_phase == HIGH_STEP)
+        {
+            finish();
+        }
+        else
+        {
+            _phase = (Phase)(_phase + 1);
+            _duty = (_phase == HIGH_SETTLE || _phase == HIGH_STEP) ? _params.duty_high : _params.duty_low;
+        }
+    }
+
+    for (int i = 0; i < 4; i++) duty[i] = getDuty();
+    return _state == TUNER_RUNNING;
+}
+
+void MotorTuner::finish()
+{
+    MotorModel & mean = _result.model;
+    int valid = 0;
+    float du = _params.duty_high - _params.duty_low;
+    memset(&mean, 0, sizeof(mean));
+    for (int i = 0; i < 4; i++)
+    {
+        MotorModel & m = _result.wheel[i];
+        float low = 0.5f * (_level[LOW_SETTLE][i] + _level[LOW_STEP][i]);
+        float high = 0.5f * (_level[HIGH_SETTLE][i] + _level[HIGH_STEP][i]);
+        m.gain = du != 0.0f ? (high - low) / du : 0.0f;
+        m.offset = m.gain > 0.0f ? _params.duty_low - low / m.gain : 0.0f;
+        m.time_constant = _t28[i] >= 0.0f && _t63[i] >= 0.0f ? 1.5f * (_t63[i] - _t28[i]) : 0.0f;
+        m.dead_time = _t63[i] - m.time_constant;
+        if (m.dead_time < 0.0f)
+            m.dead_time = 0.0f;
+        m.valid = m.gain > 0.0f && low > 0.0f && m.time_constant > 0.0f;
+        if (!m.valid)
+            continue;
+        mean.gain += m.gain;
+        mean.offset += m.offset;
+        mean.time_constant += m.time_constant;
+        mean.dead_time += m.dead_time;
+        valid++;
+    }
+    if (valid)
+    {
+        mean.gain /= valid;
+        mean.offset /= valid;
+        mean.time_constant /= valid;
+        mean.dead_time /= valid;
+        mean.valid = true;
+        computeGains(mean, _params.tc, _result);
+    }
+    _state = valid == 4 ? TUNER_DONE : TUNER_FAILED;
+}
+
+void MotorTuner::computeGains(const MotorModel & model, float tc, MotorTunerResult & result)
+{
+    float reference_period = REGULATOR_REFERENCE_PERIOD_US * 1e-6f;
+    float horizon = (tc > 0.0f ? tc : model.dead_time) + model.dead_time;
+    if (horizon < reference_period)
+        horizon = reference_period;
+    float ti = 4.0f * horizon < model.time_constant ? 4.0f * horizon : model.time_constant;
+    result.kp = model.time_constant / (model.gain * horizon);
+    result.ki = result.kp * reference_period / ti;
+    result.kv = 1.0f / model.gain;
+    result.ks = model.offset > 0.0f ? model.offset : 0.0f;
+    result.ka = result.kv * model.time_constant;
+}
+
+void MotorTuner::applyGains(RosbotRegulator_params & params) const
+{
+    params.kp = _result.kp;
+    params.ki = _result.ki;
+    params.kd = 0.0f;
+    params.kv = _result.kv;
+    params.ks = _result.ks;
+    params.ka = _result.ka;
+}
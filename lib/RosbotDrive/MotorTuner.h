@@ -0,0 +1,133 @@
+/** @file MotorTuner.h
+ * Identification of the wheel drive model and tuning of the speed regulator.
+ *
+ * The experiment runs on a lifted robot, the wheels turn freely and are identified together.
+ * The duty cycle steps between two levels above the static friction: low, high, low, high.
+ * The speed settled at the end of each level gives the static gain and the friction offset,
+ * the last step is timed against these levels. The first order plus dead time (FOPDT) model
+ * comes from the times the speed crosses 28.3 % and 63.2 % of the step:
+ * T = 1.5 (t63 - t28), L = t63 - T. The model includes the encoder speed estimate and the
+ * one period delay of the regulator loop, the same as the regulator sees.
+ *
+ * The PI gains follow the SIMC rules for the requested closed loop time constant tc:
+ * Kc = T / (K (tc + L)), Ti = min(T, 4 (tc + L)). The feed-forward terms are the inverse
+ * of the model: kv = 1 / K, ks = friction offset, ka = kv T.
+ */
+#ifndef __MOTOR_TUNER_H__
+#define __MOTOR_TUNER_H__
+
+#include <stdint.h>
+#include "internal/rosbot-regulator/RosbotRegulator.h"
+
+enum MotorTunerState : uint8_t
+{
+    TUNER_IDLE = 0,    ///< No experiment was run.
+    TUNER_RUNNING = 1, ///< Experiment in progress.
+    TUNER_DONE = 2,    ///< All wheels identified.
+    TUNER_FAILED = 3   ///< Experiment aborted or a wheel could not be identified.
+};
+
+/**
+ * @brief Parameters of the tuning experiment.
+ */
+struct MotorTunerParams
+{
+    float duty_low;    ///< First duty cycle level, above the static friction.
+    float duty_high;   ///< Second duty cycle level.
+    uint32_t level_us; ///< Time each level is held, several time constants.
+    float tc;          ///< Requested closed loop time constant [s], 0 - the dead time (tightest SIMC tuning).
+};
+
+/**
+ * @brief First order plus dead time model of a wheel drive, speed in m/s from the duty cycle.
+ */
+struct MotorModel
+{
+    float gain;          ///< Static gain [m/s per duty].
+    float offset;        ///< Duty cycle lost to the friction.
+    float time_constant; ///< [s]
+    float dead_time;     ///< [s]
+    bool valid;          ///< The wheel responded to the steps.
+};
+
+struct MotorTunerResult
+{
+    MotorModel wheel[4];
+    MotorModel model;    ///< Mean of the valid wheels, the regulator gains are shared.
+    float kp;
+    float ki;            ///< Per REGULATOR_REFERENCE_PERIOD_US.
+    float kv;
+    float ks;
+    float ka;
+};
+
+class MotorTuner
+{
+public:
+    static const MotorTunerParams DEFAULT_PARAMS;
+
+    MotorTuner();
+
+    /** Start the experiment, the previous result is cleared. */
+    void start(const MotorTunerParams & params);
+
+    /** Abort the experiment, the wheels should be switched off. */
+    void abort();
+
+    /**
+     * @brief Advance the experiment by one regulator iteration.
+     * @param speed measured wheel speeds [m/s]
+     * @param dt_us time since the previous iteration
+     * @param duty duty cycles to apply, all zero when the experiment ends
+     * @return true while the experiment is running
+     */
+    bool update(const float * speed, uint32_t dt_us, float * duty);
+
+    bool isRunning() const
+    {
+        return _state == TUNER_RUNNING;
+    }
+
+    float getDuty() const
+    {
+        return _state == TUNER_RUNNING ? _duty : 0.0f;
+    }
+
+    MotorTunerState getResult(MotorTunerResult & result) const
+    {
+        result = _result;
+        return _state;
+    }
+
+    /** Fill kp, ki, kd, kv, ks and ka of the regulator parameters from the result. */
+    void applyGains(RosbotRegulator_params & params) const;
+
+    /** Compute the regulator gains of a model for the closed loop time constant tc. */
+    static void computeGains(const MotorModel & model, float tc, MotorTunerResult & result);
+
+private:
+    void finish();
+
+    enum Phase : uint8_t
+    {
+        LOW_SETTLE,
+        HIGH_SETTLE,
+        LOW_STEP,
+        HIGH_STEP
+    };
+
+    MotorTunerParams _params;
+    volatile MotorTunerState _state;
+    MotorTunerResult _result;
+    Phase _phase;
+    float _duty;
+    uint32_t _time_us; // since the start of the level
+    float _level[4][4]; // speed settled at the end of each phase
+    float _sum[4];
+    uint32_t _samples;
+    float _prev_speed[4];
+    float _t28[4];
+    float _t63[4];
+};
+
+#endif /* __MOTOR_TUNER_H__ */
@@ -0,0 +1,78 @@
+#include "OdometryIntegrator.h"
+#include <math.h>
+#include <string.h>
+
+#define STRAIGHT_ARC_RAD 1e-6 /**< Below this heading change the arc is treated as a straight segment.*/
+
+OdometryIntegrator::OdometryIntegrator()
+: _meters_per_tick(0.0)
+, _track(1.0)
+{
+    reset();
+}
+
+void OdometryIntegrator::setGeometry(double meters_per_tick, double track)
+{
+    _meters_per_tick = meters_per_tick;
+    _track = track;
+}
+
+void OdometryIntegrator::reset()
+{
+    memset(&_pose, 0, sizeof(_pose));
+    _left_ticks = 0;
+    _right_ticks = 0;
+    _latched = false;
+}
+
+void OdometryIntegrator::update(int32_t left_ticks, int32_t right_ticks, int wheels_per_side, uint32_t timestamp_us)
+{
+    if (!_latched)
+    {
+        _left_ticks = left_ticks;
+        _right_ticks = right_ticks;
+        _pose.timestamp_us = timestamp_us;
+        _latched = true;
+        return;
+    }
+
+    // integer deltas are exact, wrapping counters included
+    int32_t dl = (int32_t)((uint32_t)left_ticks - (uint32_t)_left_ticks);
+    int32_t dr = (int32_t)((uint32_t)right_ticks - (uint32_t)_right_ticks);
+    uint32_t dt_us = timestamp_us - _pose.timestamp_us;
+    _left_ticks = left_ticks;
+    _right_ticks = right_ticks;
+    _pose.timestamp_us = timestamp_us;
+
+    double scale = _meters_per_tick / wheels_per_side;
+    double ds = (double)(dr + dl) * scale * 0.5;
+    double dyaw = (double)(dr - dl) * scale / _track;
+
+    if (fabs(dyaw) < STRAIGHT_ARC_RAD)
+    {
+        double mid = _pose.yaw + dyaw * 0.5;
+        _pose.x += ds * cos(mid);
+        _pose.y += ds * sin(mid);
+    }
+    else
+    {
+        double radius = ds / dyaw;
+        double yaw = _pose.yaw + dyaw;
+        _pose.x += radius * (sin(yaw) - sin(_pose.yaw));
+        _pose.y -= radius * (cos(yaw) - cos(_pose.yaw));
+    }
+    _pose.yaw += dyaw;
+    _pose.distance += ds;
+
+    if (dt_us > 0)
+    {
+        _pose.linear_vel = (float)(ds * 1e6 / dt_us);
+        _pose.angular_vel = (float)(dyaw * 1e6 / dt_us);
+    }
+}
+
+void OdometryIntegrator::setWheelSpeeds(float left_mps, float right_mps)
+{
+    _pose.linear_vel = 0.5f * (right_mps + left_mps);
+    _pose.angular_vel = (float)((right_mps - left_mps) / _track);
+}
@@ -0,0 +1,78 @@
+/** @file OdometryIntegrator.h
+ * Differential drive odometry integrated from encoder tick deltas.
+ *
+ * Every update takes the encoder counts of the left and right side and advances the pose
+ * along the exact circular arc driven since the previous update (the midpoint heading is
+ * used when the arc is almost straight). Tick deltas are integers, the pose is accumulated
+ * in double precision, so a long route loses neither resolution nor heading. Velocities are
+ * taken over the time between the encoder samples, or from wheel speeds measured over a longer
+ * window when they are given with setWheelSpeeds().
+ */
+#ifndef __ODOMETRY_INTEGRATOR_H__
+#define __ODOMETRY_INTEGRATOR_H__
+
+#include <stdint.h>
+
+/**
+ * @brief Pose and velocity of a differential drive.
+ */
+struct OdometryPose
+{
+    double x;              ///< Position [m].
+    double y;              ///< Position [m].
+    double yaw;            ///< Heading [rad], not wrapped.
+    double distance;       ///< Signed path length [m].
+    float linear_vel;      ///< Forward velocity, mean of the sides [m/s].
+    float angular_vel;     ///< Yaw rate [rad/s].
+    uint32_t timestamp_us; ///< Encoder sampling time of the last update.
+};
+
+class OdometryIntegrator
+{
+public:
+    OdometryIntegrator();
+
+    /**
+     * @brief Set the drive geometry.
+     * @param meters_per_tick distance driven by a wheel per encoder tick
+     * @param track effective distance between the left and right wheels [m]
+     */
+    void setGeometry(double meters_per_tick, double track);
+
+    /** Zero the pose, the next update only latches the encoder counts. */
+    void reset();
+
+    /**
+     * @brief Integrate one encoder sample.
+     * @param left_ticks encoder counts of the left side (sum of the wheels of the side)
+     * @param right_ticks encoder counts of the right side
+     * @param wheels_per_side number of wheels summed in left_ticks and right_ticks
+     * @param timestamp_us encoder sampling time (us_ticker)
+     */
+    void update(int32_t left_ticks, int32_t right_ticks, int wheels_per_side, uint32_t timestamp_us);
+
+    /**
+     * @brief Replace the velocities of the last update with ones of measured wheel speeds.
+     *
+     * One encoder sample period quantizes the velocity to a tick per period, the wheel speed
+     * estimate of the regulator averages over its speed window.
+     * @param left_mps speed of the left side [m/s]
+     * @param right_mps speed of the right side [m/s]
+     */
+    void setWheelSpeeds(float left_mps, float right_mps);
+
+    const OdometryPose & getPose() const
+    {
+        return _pose;
+    }
+
+private:
+    OdometryPose _pose;
+    double _meters_per_tick;
+    double _track;
+    int32_t _left_ticks;
+    int32_t _right_ticks;
+    bool _latched;
+};
+
+#endif /* __ODOMETRY_INTEGRATOR_H__ */
@@ -1,6 +1,12 @@
 #include "RosbotDrive.h"
-#include "RosbotRegulatorCMSIS.h"
+#include "RosbotRegulatorBank4.h"
+#include <Profiler.h>
 #define PWM_DEFAULT_FREQ_HZ 18000UL /**< Default frequency for motors' pwms.*/
+#define REGULATOR_TICK_FLAG 0x01UL /**< Regulator loop release flag.*/
+#define EDGE_PERIOD_MAX_TICKS 4 /**< EDGE_PERIOD estimator measures the time of at least this number of ticks.*/
+#define EDGE_PERIOD_TIMEOUT_US 100000UL /**< Without an edge for this time the wheel is considered stopped.*/
+#define MIN_REGULATOR_PERIOD_US 1000UL /**< 1 kHz */
+#define MAX_REGULATOR_PERIOD_US 20000UL /**< 50 Hz */
 
 #define FOR(x) for(int i=0;i<x;i++)
 
@@ -38,9 +44,9 @@ const RosbotWheel RosbotDrive::DEFAULT_WHEEL_PARAMS = {
 //     .kd = 0.015,
 //     .out_min = -1.0,
 //     .out_max = 1.0,
-//     .a_max = 1.5e-4,
+//     .a_max = 1.5,
 //     .speed_max = 1.5,
-//     .dt_ms = 10};
+//     .dt_us = 10000};
 
 const RosbotRegulator_params RosbotDrive::DEFAULT_REGULATOR_PARAMS = {
     .kp = 0.8,
@@ -48,33 +54,62 @@ const RosbotRegulator_params RosbotDrive::DEFAULT_REGULATOR_PARAMS = {
     .kd = 0.015,
     .out_min = -0.8,
     .out_max = 0.8,
-    .a_max = 1.5e-4,
+    .a_max = 1.5,
     .speed_max = 1.0,
-    .dt_ms = 10};
+    .dt_us = MBED_CONF_ROSBOT_DRIVE_REGULATOR_PERIOD_US,
+    .type = REGULATOR_INCREMENTAL,
+    .kv = 0.66,
+    .ks = 0.04,
+    .ka = 0.05,
+    .kt = 0.5,
+    .tf = 0.02};
 
 RosbotDrive * RosbotDrive::_instance = NULL;
 
 /* static objects begin (memory optimizations) */
 static Thread regulator_thread(osPriorityHigh);
+#if MBED_CONF_ROSBOT_DRIVE_TIMER_TICK
+static Ticker regulator_ticker;
+static EventFlags regulator_flags;
+#endif
 static DRV8848 mot_driver1(&DEFAULT_MDRV1_PARAMS);
 static DRV8848 mot_driver2(&DEFAULT_MDRV2_PARAMS);
 static Encoder encoder1(ENCODER_1);
 static Encoder encoder2(ENCODER_2);
 static Encoder encoder3(ENCODER_3);
 static Encoder encoder4(ENCODER_4);
+static RosbotRegulatorBank4 regulator_bank;
 /* static objects end (memory optimizations)*/
 
 RosbotDrive::RosbotDrive()
 : _state(UNINIT)
 , _regulator_output_enabled(false)
-, _regulator_loop_enabled(true)
 , _tspeed_mps{0,0,0,0}
 , _cspeed_mps{0,0,0,0}
-, _cdistance{0,0,0,0}
+, _snapshot{{0,0,0,0},0}
+, _state_buffer{}
+, _state_sequence(0)
+, _speed_estimator(MBED_CONF_ROSBOT_DRIVE_SPEED_ESTIMATOR)
 , _motor_sequence{0,1,2,3}
+, _snapshot_head(0)
+, _speed_window(1)
+, _odometry_enabled(false)
+, _profile_request{{MOTOR1,MOTOR1},{MOTOR1,MOTOR1},0.0f,VelocityProfiler::DEFAULT_LIMITS}
+, _profile_changed(false)
+, _profile_restart(false)
+, _profile_enabled(false)
+, _target_velocity{0,0}
+, _target_sequence(0)
+, _profile_sequence(0)
 , _mot_driver{NULL,NULL}
 , _mot{NULL,NULL,NULL,NULL}
 , _encoder{NULL,NULL,NULL,NULL}
+, _regulator(NULL)
+, _regulator_interval_us(0)
+, _regulator_releases(0)
+, _regulator_release_us(0)
+, _timing_stats{0,0,0,0.0f,0}
+, _jitter_sum_us(0)
 {}
 
 RosbotDrive & RosbotDrive::getInstance()
@@ -106,10 +141,12 @@ void RosbotDrive::init(const RosbotWheel & wheel_params, const RosbotRegulator_p
         _mot[i+2]=_mot_driver[1]->getDCMotor((MotNum)i);
     }
 
-    // Use CMSIS PID regulator
-    FOR(4) _regulator[i] = new RosbotRegulatorCMSIS(reg_params); //TODO change to static
+    RosbotRegulator_params params = reg_params;
+    params.dt_us = setRegulatorInterval(reg_params.dt_us);
 
-    _regulator_interval_ms = reg_params.dt_ms;
+    // All four wheels are regulated by one statically allocated bank
+    _regulator = &regulator_bank;
+    _regulator->updateParams(params);
 
     _wheel_coefficient1 =  2 * M_PI * wheel_params.radius / (wheel_params.gear_ratio * wheel_params.encoder_cpr * wheel_params.tyre_deflation);
     _wheel_coefficient2 =  2 * M_PI / (wheel_params.gear_ratio * wheel_params.encoder_cpr);
@@ -122,6 +159,10 @@ void RosbotDrive::init(const RosbotWheel & wheel_params, const RosbotRegulator_p
         _encoder[i]->setPolarity(wheel_params.polarity>>(i+4) & 1);
         _encoder[i]->init();
     }
+
+    sampleEncoders(_snapshot);
+    resetHistory();
+    publishState(_snapshot);
     
     _state=HALT;
 
@@ -163,8 +204,8 @@ void RosbotDrive::enable(bool en)
                 {
                     _mot[i]->setPower(0);
                     _tspeed_mps[i]=0;
-                    _regulator[i]->reset();
                 }
+                _regulator->reset();
                 FOR(2) _mot_driver[i]->enable(en);
             } 
             break;
@@ -173,42 +214,480 @@ void RosbotDrive::enable(bool en)
     }
 }
 
+#if MBED_CONF_ROSBOT_DRIVE_TIMER_TICK
+void RosbotDrive::regulatorTick()
+{
+    _regulator_release_us = us_ticker_read();
+    _regulator_releases++;
+    regulator_flags.set(REGULATOR_TICK_FLAG);
+}
+
 void RosbotDrive::regulatorLoop()
 {
-    uint64_t sleepTime;
-    int32_t distance;
-    float factor1;
-    int mot_num;
+    uint32_t handled = 0;
+    uint32_t releases;
+    regulator_ticker.attach_us(callback(this,&RosbotDrive::regulatorTick), _regulator_interval_us);
     while (1)
     {
-        sleepTime = Kernel::get_ms_count() + _regulator_interval_ms;
-        if (_regulator_loop_enabled) //TODO: change to mutex with fixed held time
+        regulator_flags.wait_any(REGULATOR_TICK_FLAG);
+        uint32_t start = us_ticker_read();
+        releases = _regulator_releases;
+        regulatorUpdate();
+        updateTimingStats(start, _regulator_release_us, releases - handled - 1);
+        handled = releases;
+    }
+}
+#else
+void RosbotDrive::regulatorLoop()
+{
+    // absolute deadline schedule - the period does not drift by the loop execution time
+    // sleep_until() has 1 ms resolution - periods that are not a multiple of 1 ms are kept on average
+    uint64_t deadline_us = Kernel::get_ms_count() * 1000;
+    uint64_t now_us;
+    uint32_t missed;
+    while (1)
+    {
+        uint32_t start = us_ticker_read();
+        uint32_t late_us = (uint32_t)(Kernel::get_ms_count() * 1000 - deadline_us / 1000 * 1000);
+        regulatorUpdate();
+        deadline_us += _regulator_interval_us;
+        now_us = Kernel::get_ms_count() * 1000;
+        missed = 0;
+        while (deadline_us / 1000 * 1000 <= now_us)
         {
+            deadline_us += _regulator_interval_us;
+            missed++;
+        }
+        updateTimingStats(start, start - late_us, missed);
+        ThisThread::sleep_until(deadline_us / 1000);
+    }
+}
+#endif /* MBED_CONF_ROSBOT_DRIVE_TIMER_TICK */
 
-            factor1 = 1000.0 * _wheel_coefficient1 / _regulator_interval_ms;
-            FOR(4)
-            {
-                distance = _encoder[i]->getCount();
-                _cspeed_mps[i] = (float)(distance - _cdistance[i]) * factor1;
-                _cdistance[i] = distance;
-                
-            }
-            if ((_state == OPERATIONAL) && _regulator_output_enabled)
+void RosbotDrive::regulatorUpdate()
+{
+    PROFILE_SCOPE("regulator");
+    EncoderSnapshot snapshot;
+    float tspeed[4], cspeed[4], pidout[4];
+    sampleEncoders(snapshot);
+    uint32_t dt_us = snapshot.timestamp_us - _snapshot.timestamp_us;
+    // speed is measured over the speed window, so fast loops do not multiply the encoder quantization
+    const EncoderSnapshot & ref = _snapshot_history[(_snapshot_head + SNAPSHOT_HISTORY_SIZE + 1 - _speed_window) % SNAPSHOT_HISTORY_SIZE];
+    FOR(4) _cspeed_mps[i] = estimateSpeed(i, snapshot, ref);
+    _snapshot_head = (_snapshot_head + 1) % SNAPSHOT_HISTORY_SIZE;
+    _snapshot_history[_snapshot_head] = snapshot;
+    _snapshot = snapshot;
+    if (_odometry_enabled)
+        updateOdometry(snapshot);
+    if (_tuner.isRunning())
+    {
+        if (_profile_enabled)
+            resetProfile();
+        if (_state == OPERATIONAL)
+        {
+            FOR(4) cspeed[i] = _cspeed_mps[i];
+            if (!_tuner.update(cspeed, dt_us, pidout))
             {
-                FOR(4)
-                {
-                    mot_num = _motor_sequence[i];
-                    _mot[mot_num]->setPower(_regulator[mot_num]->updateState(_tspeed_mps[mot_num],_cspeed_mps[mot_num]));
-                }
+                FOR(4) _tspeed_mps[i] = 0;
+                _regulator->reset();
             }
+            FOR(4) _mot[_motor_sequence[i]]->setPower(pidout[_motor_sequence[i]]);
+        }
+        else
+        {
+            _tuner.abort();
+        }
+    }
+    else if ((_state == OPERATIONAL) && _regulator_output_enabled)
+    {
+        if (_profile_enabled)
+            updateProfile(dt_us);
+        FOR(4)
+        {
+            tspeed[i] = _tspeed_mps[i];
+            cspeed[i] = _cspeed_mps[i];
+            pidout[i] = _regulator->getPidout(i);
+        }
+        // the monitor sees the outputs of the previous iteration, the ones the wheels reacted to
+        _traction.update(tspeed, cspeed, pidout, dt_us);
+        _regulator->updateState(tspeed, cspeed, pidout);
+        FOR(4) _mot[_motor_sequence[i]]->setPower(pidout[_motor_sequence[i]]);
+    }
+    else if (_profile_enabled)
+    {
+        // the wheels are not regulated, the profile starts from standstill again
+        resetProfile();
+    }
+    publishState(snapshot);
+}
+
+void RosbotDrive::publishState(const EncoderSnapshot & snapshot)
+{
+    // double-buffered seqlock - the writer never waits, it fills the buffer readers are not pointed at
+    uint32_t sequence = _state_sequence + 1;
+    DriveStateSnapshot & state = _state_buffer[sequence & 1];
+    state.sequence = sequence;
+    state.timestamp_us = snapshot.timestamp_us;
+    FOR(4)
+    {
+        state.ticks[i] = snapshot.ticks[i];
+        state.angular_pos[i] = _wheel_coefficient2 * snapshot.ticks[i];
+        state.cspeed_mps[i] = _cspeed_mps[i];
+        state.tspeed_mps[i] = _tspeed_mps[i];
+        state.pidout[i] = _tuner.isRunning() ? _tuner.getDuty() : _regulator->getPidout(i);
+    }
+    state.odometry = _odometry.getPose();
+    state.traction = _traction.getFlags();
+    __DMB();
+    _state_sequence = sequence;
+}
+
+void RosbotDrive::updateOdometry(const EncoderSnapshot & snapshot)
+{
+    PROFILE_SCOPE("drive_odometry");
+    const DriveOdometryParams & p = _odometry_params;
+    _odometry.update(snapshot.ticks[p.left[0]] + snapshot.ticks[p.left[1]],
+                     snapshot.ticks[p.right[0]] + snapshot.ticks[p.right[1]], 2, snapshot.timestamp_us);
+    // the velocities over the speed window, one period is a few ticks only
+    _odometry.setWheelSpeeds(0.5f * (_cspeed_mps[p.left[0]] + _cspeed_mps[p.left[1]]),
+                             0.5f * (_cspeed_mps[p.right[0]] + _cspeed_mps[p.right[1]]));
+}
+
+void RosbotDrive::enableOdometry(const DriveOdometryParams & params)
+{
+    CriticalSectionLock lock;
+    _odometry_params = params;
+    _odometry.setGeometry(_wheel_coefficient1, params.track);
+    if (!_odometry_enabled)
+    {
+        // the current encoder sample is the origin
+        _odometry.reset();
+        updateOdometry(_snapshot);
+    }
+    _odometry_enabled = true;
+}
+
+void RosbotDrive::disableOdometry()
+{
+    _odometry_enabled = false;
+}
+
+bool RosbotDrive::isOdometryEnabled()
+{
+    return _odometry_enabled;
+}
+
+void RosbotDrive::setTractionParams(const TractionParams & params)
+{
+    CriticalSectionLock lock;
+    _traction.setParams(params);
+}
+
+void RosbotDrive::getTractionParams(TractionParams & params)
+{
+    _traction.getParams(params);
+}
+
+void RosbotDrive::getTractionStats(TractionStats & stats)
+{
+    CriticalSectionLock lock;
+    _traction.getStats(stats);
+}
+
+void RosbotDrive::resetTractionStats()
+{
+    CriticalSectionLock lock;
+    _traction.resetStats();
+}
+
+void RosbotDrive::updateProfile(uint32_t dt_us)
+{
+    if (_profile_changed)
+    {
+        // the parameters are taken over here, the profile is only touched by the regulator loop
+        bool restart;
+        {
+            CriticalSectionLock lock;
+            _profile_params = _profile_request;
+            restart = _profile_restart;
+            _profile_changed = _profile_restart = false;
+        }
+        if (restart)
+        {
+            // continue from the current wheel targets
+            const DriveProfileParams & p = _profile_params;
+            float left = 0.5f * (_tspeed_mps[p.left[0]] + _tspeed_mps[p.left[1]]);
+            float right = 0.5f * (_tspeed_mps[p.right[0]] + _tspeed_mps[p.right[1]]);
+            _profile.reset(0.5f * (left + right), p.half_track > 0.0f ? 0.5f * (right - left) / p.half_track : 0.0f);
+        }
+        _profile.setLimits(_profile_params.limits);
+    }
+    if (_target_sequence != _profile_sequence)
+    {
+        float target[2];
+        {
+            CriticalSectionLock lock;
+            target[0] = _target_velocity[0];
+            target[1] = _target_velocity[1];
+            _profile_sequence = _target_sequence;
+        }
+        _profile.setTarget(target[0], target[1]);
+    }
+    _profile.update(dt_us);
+    setWheelTargets(_profile_params, _profile.getLinear(), _profile.getAngular());
+}
+
+void RosbotDrive::setWheelTargets(const DriveProfileParams & p, float linear, float angular)
+{
+    float turn = angular * p.half_track;
+    _tspeed_mps[p.left[0]] = _tspeed_mps[p.left[1]] = linear - turn;
+    _tspeed_mps[p.right[0]] = _tspeed_mps[p.right[1]] = linear + turn;
+}
+
+void RosbotDrive::resetProfile()
+{
+    {
+        CriticalSectionLock lock;
+        _target_velocity[0] = _target_velocity[1] = 0.0f;
+        _profile_sequence = _target_sequence;
+    }
+    _profile.reset(0.0f, 0.0f);
+}
+
+void RosbotDrive::enableProfile(const DriveProfileParams & params)
+{
+    CriticalSectionLock lock;
+    _profile_request = params;
+    if (!_profile_enabled)
+    {
+        // the target is held until a new one comes, a stale one from the last time is dropped
+        const DriveProfileParams & p = params;
+        float left = 0.5f * (_tspeed_mps[p.left[0]] + _tspeed_mps[p.left[1]]);
+        float right = 0.5f * (_tspeed_mps[p.right[0]] + _tspeed_mps[p.right[1]]);
+        _target_velocity[0] = 0.5f * (left + right);
+        _target_velocity[1] = p.half_track > 0.0f ? 0.5f * (right - left) / p.half_track : 0.0f;
+        _target_sequence++;
+        _profile_restart = true;
+    }
+    _profile_changed = true;
+    _profile_enabled = true;
+}
+
+void RosbotDrive::disableProfile()
+{
+    CriticalSectionLock lock;
+    if (_profile_enabled && !_tuner.isRunning())
+    {
+        // the ramp is cut short, the wheels get the last target
+        setWheelTargets(_profile_request, _target_velocity[0], _target_velocity[1]);
+    }
+    _profile_enabled = false;
+}
+
+bool RosbotDrive::isProfileEnabled()
+{
+    return _profile_enabled;
+}
+
+void RosbotDrive::getProfileParams(DriveProfileParams & params)
+{
+    CriticalSectionLock lock;
+    params = _profile_request;
+}
+
+void RosbotDrive::updateTargetVelocity(float linear, float angular)
+{
+    if (_state != OPERATIONAL || !_regulator_output_enabled || _tuner.isRunning())
+        return;
+    CriticalSectionLock lock;
+    _target_velocity[0] = linear;
+    _target_velocity[1] = angular;
+    _target_sequence++;
+}
+
+bool RosbotDrive::startTuning(const MotorTunerParams & params)
+{
+    if (_state != OPERATIONAL)
+        return false;
+    CriticalSectionLock lock;
+    FOR(4) _tspeed_mps[i] = 0;
+    _regulator->reset();
+    _tuner.start(params);
+    return true;
+}
+
+void RosbotDrive::stopTuning()
+{
+    CriticalSectionLock lock;
+    if (_tuner.isRunning())
+    {
+        _tuner.abort();
+        FOR(4) _mot[i]->setPower(0);
+        _regulator->reset();
+    }
+}
+
+MotorTunerState RosbotDrive::getTuningResult(MotorTunerResult & result)
+{
+    CriticalSectionLock lock;
+    return _tuner.getResult(result);
+}
+
+bool RosbotDrive::applyTuning()
+{
+    MotorTunerResult result;
+    if (getTuningResult(result) != TUNER_DONE)
+        return false;
+    RosbotRegulator_params params;
+    getPidParams(params);
+    _tuner.applyGains(params);
+    updatePidParams(params);
+    return true;
+}
+
+void RosbotDrive::getDriveState(DriveStateSnapshot & state)
+{
+    // the copy is valid unless the writer wrapped around to the same buffer (two publications) meanwhile;
+    // the regulator thread has the higher priority on a single core, so it is never interrupted by a
+    // reader and a buffer is rewritten only by a publication that completes during the copy
+    uint32_t sequence;
+    do
+    {
+        sequence = _state_sequence;
+        __DMB();
+        state = _state_buffer[sequence & 1];
+        __DMB();
+    } while (_state_sequence - sequence > 1);
+}
+
+void RosbotDrive::sampleEncoders(EncoderSnapshot & snapshot)
+{
+    // all four counters are read back-to-back so they describe the same instant
+    CriticalSectionLock lock;
+    snapshot.timestamp_us = us_ticker_read();
+    FOR(4) snapshot.ticks[i] = _encoder[i]->getCount();
+}
+
+float RosbotDrive::estimateSpeed(int mot_num, const EncoderSnapshot & snapshot, const EncoderSnapshot & ref)
+{
+    int32_t window_delta = snapshot.ticks[mot_num] - ref.ticks[mot_num];
+    uint32_t window_us = snapshot.timestamp_us - ref.timestamp_us;
+    if (_speed_estimator == TICK_DELTA || abs(window_delta) >= EDGE_PERIOD_MAX_TICKS)
+        return window_us ? (float)window_delta * _wheel_coefficient1 * 1e6f / window_us : 0.0f;
+
+    // EDGE_PERIOD: the encoder counters give no edge timestamps, so an edge is timestamped with
+    // the sample it was first seen in and the speed is measured over the time of the last few edges
+    EdgeHistory & h = _edge_history[mot_num];
+    int32_t delta = snapshot.ticks[mot_num] - _snapshot.ticks[mot_num];
+    float speed = _cspeed_mps[mot_num];
+    uint32_t since_edge_us = snapshot.timestamp_us - h.time_us[h.head];
+    if (delta != 0)
+    {
+        int ref = -1;
+        for (int k = 0, idx = h.head; k < EDGE_HISTORY_SIZE - 1; k++)
+        {
+            if (snapshot.timestamp_us - h.time_us[idx] >= EDGE_PERIOD_TIMEOUT_US)
+                break;
+            ref = idx;
+            if (abs(snapshot.ticks[mot_num] - h.ticks[idx]) >= EDGE_PERIOD_MAX_TICKS)
+                break;
+            idx = (idx + EDGE_HISTORY_SIZE - 1) % EDGE_HISTORY_SIZE;
         }
-        ThisThread::sleep_until(sleepTime);
+        if (ref == -1) // first edge after a stop
+            speed = (float)delta * _wheel_coefficient1 * 1e6f / EDGE_PERIOD_TIMEOUT_US;
+        else
+            speed = (float)(snapshot.ticks[mot_num] - h.ticks[ref]) * _wheel_coefficient1 * 1e6f / (snapshot.timestamp_us - h.time_us[ref]);
+        h.head = (h.head + 1) % EDGE_HISTORY_SIZE;
+        h.ticks[h.head] = snapshot.ticks[mot_num];
+        h.time_us[h.head] = snapshot.timestamp_us;
+    }
+    else if (since_edge_us >= EDGE_PERIOD_TIMEOUT_US)
+    {
+        speed = 0.0f;
+    }
+    else
+    {
+        // no new edge - the wheel cannot be faster than one tick per time since the last edge
+        float bound = _wheel_coefficient1 * 1e6f / since_edge_us;
+        if (fabs(speed) > bound)
+            speed = copysign(bound, speed);
+    }
+    return speed;
+}
+
+void RosbotDrive::resetHistory()
+{
+    for (int k = 0; k < SNAPSHOT_HISTORY_SIZE; k++) _snapshot_history[k] = _snapshot;
+    FOR(4)
+    {
+        _edge_history[i].head = 0;
+        for (int k = 0; k < EDGE_HISTORY_SIZE; k++)
+        {
+            _edge_history[i].ticks[k] = _snapshot.ticks[i];
+            _edge_history[i].time_us[k] = _snapshot.timestamp_us - EDGE_PERIOD_TIMEOUT_US;
+        }
+    }
+}
+
+uint32_t RosbotDrive::setRegulatorInterval(uint32_t dt_us)
+{
+    dt_us = max<uint32_t>(MIN_REGULATOR_PERIOD_US, min<uint32_t>(dt_us, MAX_REGULATOR_PERIOD_US));
+    _speed_window = max<uint32_t>(1, min<uint32_t>(MBED_CONF_ROSBOT_DRIVE_SPEED_WINDOW_US / dt_us, SNAPSHOT_HISTORY_SIZE - 1));
+    if (dt_us != _regulator_interval_us)
+    {
+        _regulator_interval_us = dt_us;
+#if MBED_CONF_ROSBOT_DRIVE_TIMER_TICK
+        if (_state != UNINIT)
+            regulator_ticker.attach_us(callback(this,&RosbotDrive::regulatorTick), _regulator_interval_us);
+#endif
     }
+    return dt_us;
+}
+
+void RosbotDrive::setSpeedEstimator(SpeedEstimator estimator)
+{
+    _speed_estimator = estimator;
+}
+
+void RosbotDrive::getEncoderSnapshot(EncoderSnapshot & snapshot)
+{
+    DriveStateSnapshot state;
+    getDriveState(state);
+    snapshot.timestamp_us = state.timestamp_us;
+    FOR(4) snapshot.ticks[i] = state.ticks[i];
+}
+
+void RosbotDrive::updateTimingStats(uint32_t start_us, uint32_t release_us, uint32_t missed)
+{
+    uint32_t jitter = start_us - release_us;
+    uint32_t exec = us_ticker_read() - start_us;
+    CriticalSectionLock lock;
+    _timing_stats.iterations++;
+    _timing_stats.overruns += missed;
+    _jitter_sum_us += jitter;
+    _timing_stats.jitter_mean_us = (float)_jitter_sum_us / _timing_stats.iterations;
+    if (jitter > _timing_stats.jitter_max_us)
+        _timing_stats.jitter_max_us = jitter;
+    if (exec > _timing_stats.exec_max_us)
+        _timing_stats.exec_max_us = exec;
+}
+
+void RosbotDrive::getTimingStats(RegulatorTimingStats & stats)
+{
+    CriticalSectionLock lock;
+    stats = _timing_stats;
+}
+
+void RosbotDrive::resetTimingStats()
+{
+    CriticalSectionLock lock;
+    _timing_stats = {0,0,0,0.0f,0};
+    _jitter_sum_us = 0;
 }
 
 void RosbotDrive::updateTargetSpeed(const NewTargetSpeed & new_speed)
 {
-    if(_state != OPERATIONAL)
+    if(_state != OPERATIONAL || _tuner.isRunning())
         return;
     switch(new_speed.mode)
     {
@@ -218,7 +697,11 @@ void RosbotDrive::updateTargetSpeed(const NewTargetSpeed & new_speed)
             break;
         case MPS:
             if(_regulator_output_enabled)
+            {
+                // all four targets reach the same regulator iteration
+                CriticalSectionLock lock;
                 FOR(4) {_tspeed_mps[i]=new_speed.speed[i];}
+            }
             break;
         default:
             return;
@@ -227,17 +710,23 @@ void RosbotDrive::updateTargetSpeed(const NewTargetSpeed & new_speed)
 
 float RosbotDrive::getDistance(RosbotMotNum mot_num)
 {
-    return (float)_wheel_coefficient1 * _encoder[mot_num]->getCount();
+    DriveStateSnapshot state;
+    getDriveState(state);
+    return (float)_wheel_coefficient1 * state.ticks[mot_num];
 }
 
 float RosbotDrive::getAngularPos(RosbotMotNum mot_num)
 {
-    return (float)_wheel_coefficient2 * _encoder[mot_num]->getCount();
+    DriveStateSnapshot state;
+    getDriveState(state);
+    return state.angular_pos[mot_num];
 }
 
 int32_t RosbotDrive::getEncoderTicks(RosbotMotNum mot_num)
 {
-    return _encoder[mot_num]->getCount();
+    DriveStateSnapshot state;
+    getDriveState(state);
+    return state.ticks[mot_num];
 }
 
 float RosbotDrive::getSpeed(RosbotMotNum mot_num)
@@ -247,22 +736,24 @@ float RosbotDrive::getSpeed(RosbotMotNum mot_num)
 
 void RosbotDrive::updateWheelCoefficients(const RosbotWheel & params)
 {
-    _regulator_loop_enabled = false;
+    CriticalSectionLock lock;
     _wheel_coefficient1 =  2 * M_PI * params.radius / (params.gear_ratio * params.encoder_cpr * params.tyre_deflation);
     _wheel_coefficient2 =  2 * M_PI / (params.gear_ratio * params.encoder_cpr);
-    _regulator_loop_enabled = true;
+    if (_odometry_enabled)
+        _odometry.setGeometry(_wheel_coefficient1, _odometry_params.track);
 }
 
 void RosbotDrive::updatePidParams(const RosbotRegulator_params & params)
 {
-    _regulator_loop_enabled = false;
-        FOR(4) _regulator[i]->updateParams(params);
-    _regulator_loop_enabled = true;
+    RosbotRegulator_params tmp = params;
+    CriticalSectionLock lock;
+    tmp.dt_us = setRegulatorInterval(params.dt_us);
+    _regulator->updateParams(tmp);
 }
 
 void RosbotDrive::getPidParams(RosbotRegulator_params & params)
 {
-    _regulator[0]->getParams(params);
+    _regulator->getParams(params);
 }
 
 void RosbotDrive::stop()
@@ -322,18 +813,28 @@ float RosbotDrive::getSpeed(RosbotMotNum mot_num, SpeedMode mode)
 
 void RosbotDrive::resetDistance()
 {
-    bool tmp = _regulator_output_enabled;
-    _regulator_loop_enabled = false;
+    CriticalSectionLock lock;
     FOR(4) _mot[i]->setPower(0);
     FOR(4)
     {
         _encoder[i]->resetCount();
-        _regulator[i]->reset();
         _tspeed_mps[i]=0;
         _cspeed_mps[i]=0;
-        _cdistance[i]=0;
     }
-    _regulator_loop_enabled = tmp;
+    _regulator->reset();
+    if (_profile_enabled)
+    {
+        // the loop starts the profile from standstill
+        _target_velocity[0] = _target_velocity[1] = 0.0f;
+        _target_sequence++;
+        _profile_changed = _profile_restart = true;
+    }
+    sampleEncoders(_snapshot);
+    resetHistory();
+    _odometry.reset();
+    if (_odometry_enabled)
+        updateOdometry(_snapshot);
+    publishState(_snapshot);
 }
 
 void RosbotDrive::setupMotorSequence(RosbotMotNum first, RosbotMotNum second, RosbotMotNum third, RosbotMotNum fourth)
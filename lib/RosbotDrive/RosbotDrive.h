@@ -5,9 +5,18 @@
 #define __ROSBOT_DRIVE_H__
 
 #include <mbed.h>
-#include "internal/drv88xx-driver-mbed/DRV8848_STM.h"
-#include "internal/encoder-mbed/Encoder.h"
+#include <DRV8848_STM.h>
+#include <Encoder.h>
 #include "internal/rosbot-regulator/RosbotRegulator.h"
+#include "OdometryIntegrator.h"
+#include "TractionMonitor.h"
+#include "MotorTuner.h"
+#include "VelocityProfiler.h"
+
+class RosbotRegulatorBank4;
+
+#define EDGE_HISTORY_SIZE 8 /**< Number of remembered samples with encoder edges (EDGE_PERIOD estimator).*/
+#define SNAPSHOT_HISTORY_SIZE 16 /**< Number of remembered encoder snapshots (speed window).*/
 
 /**
  * @brief Rosbot Motor Internal Number.
@@ -30,6 +39,15 @@ enum SpeedMode
     DUTY_CYCLE
 };
 
+/**
+ * @brief Wheel speed estimation method.
+ */
+enum SpeedEstimator
+{
+    TICK_DELTA,  ///< Ticks counted between two samples divided by the sampling interval.
+    EDGE_PERIOD  ///< Time between encoder edges, used at low speed when only a few ticks arrive per sample.
+};
+
 enum RosbotDriveStates
 {
     UNINIT,
@@ -55,6 +73,66 @@ struct NewTargetSpeed
     SpeedMode mode;
 };
 
+/**
+ * @brief Encoder counts of all wheels sampled together.
+ */
+struct EncoderSnapshot
+{
+    int32_t ticks[4];      ///< Encoder counts.
+    uint32_t timestamp_us; ///< Sampling time (us_ticker).
+};
+
+/**
+ * @brief Drive state published by the regulator loop once per iteration.
+ *
+ * All fields come from the same regulator iteration.
+ */
+struct DriveStateSnapshot
+{
+    uint32_t sequence;      ///< Number of the regulator iteration that published the state.
+    uint32_t timestamp_us;  ///< Encoder sampling time (us_ticker).
+    int32_t ticks[4];       ///< Encoder counts.
+    float angular_pos[4];   ///< Wheel angular positions [rad].
+    float cspeed_mps[4];    ///< Measured wheel speeds.
+    float tspeed_mps[4];    ///< Target wheel speeds.
+    float pidout[4];        ///< Regulator outputs (duty cycle).
+    OdometryPose odometry;  ///< Pose integrated on this encoder sample, zero unless the odometry is enabled.
+    uint8_t traction;       ///< Slipping (bits 0-3) and stalled (bits 4-7) wheels, see TractionMonitor.
+};
+
+/**
+ * @brief Skid steering layout for the odometry integrated by the regulator loop.
+ */
+struct DriveOdometryParams
+{
+    RosbotMotNum left[2];  ///< Motors of the left side.
+    RosbotMotNum right[2]; ///< Motors of the right side.
+    float track;           ///< Effective distance between the sides [m].
+};
+
+/**
+ * @brief Skid steering layout and limits of the body velocity profile computed by the regulator loop.
+ */
+struct DriveProfileParams
+{
+    RosbotMotNum left[2];  ///< Motors of the left side.
+    RosbotMotNum right[2]; ///< Motors of the right side.
+    float half_track;      ///< Wheel speed is linear -/+ angular * half_track on the left/right side [m].
+    VelocityLimits limits;
+};
+
+/**
+ * @brief Regulator loop timing statistics.
+ */
+struct RegulatorTimingStats
+{
+    uint32_t iterations;    ///< Number of executed regulator iterations.
+    uint32_t overruns;      ///< Number of releases missed because the previous iteration was still running.
+    uint32_t jitter_max_us; ///< Maximal delay between the release and the start of an iteration.
+    float jitter_mean_us;   ///< Mean delay between the release and the start of an iteration.
+    uint32_t exec_max_us;   ///< Longest iteration execution time.
+};
+
 struct PidDebugData
 {
     float cspeed;
@@ -94,6 +172,7 @@ public:
 
     float getSpeed(RosbotMotNum mot_num, SpeedMode mode); 
 
+    /** Distance, angular position and ticks of the last regulator iteration, see getDriveState(). */
     float getDistance(RosbotMotNum mot_num); 
 
     float getAngularPos(RosbotMotNum mot_num); 
@@ -110,6 +189,89 @@ public:
 
     void getPidParams(RosbotRegulator_params & params);
 
+    void getTimingStats(RegulatorTimingStats & stats);
+
+    void resetTimingStats();
+
+    void setSpeedEstimator(SpeedEstimator estimator);
+
+    void getEncoderSnapshot(EncoderSnapshot & snapshot);
+
+    /**
+     * @brief Copy the state published by the last regulator iteration, all fields from the same iteration.
+     *
+     * The copy is retried when the regulator published twice meanwhile. This relies on the regulator
+     * thread (the only writer) having a higher priority than the callers on a single core.
+     */
+    void getDriveState(DriveStateSnapshot & state);
+
+    /**
+     * @brief Integrate the odometry in the regulator loop.
+     *
+     * The pose is advanced on every encoder sample of the regulator and published in
+     * DriveStateSnapshot::odometry. Starts from zero pose.
+     */
+    void enableOdometry(const DriveOdometryParams & params);
+
+    void disableOdometry();
+
+    bool isOdometryEnabled();
+
+    /**
+     * @brief Configure the traction monitor evaluated by the regulator loop.
+     *
+     * Slip and stall events in progress are cleared, the counters are kept.
+     */
+    void setTractionParams(const TractionParams & params);
+
+    void getTractionParams(TractionParams & params);
+
+    void getTractionStats(TractionStats & stats);
+
+    void resetTractionStats();
+
+    /**
+     * @brief Profile body velocity targets in the regulator loop.
+     *
+     * Targets given by updateTargetVelocity() are reached with limited acceleration and jerk,
+     * the wheel targets are computed from the profile on every regulator iteration. Enabling
+     * starts from the current wheel targets, an enabled profile only gets new limits. The regulator
+     * loop takes the parameters over on its next iteration.
+     */
+    void enableProfile(const DriveProfileParams & params);
+
+    /** The wheels get the last body velocity target, wheel targets given by updateTargetSpeed() are used directly again. */
+    void disableProfile();
+
+    bool isProfileEnabled();
+
+    /** The limits are valid before the profile is enabled, the layout only after. */
+    void getProfileParams(DriveProfileParams & params);
+
+    /**
+     * @brief Set the body velocity target of the profile.
+     * @param linear [m/s]
+     * @param angular [rad/s]
+     */
+    void updateTargetVelocity(float linear, float angular);
+
+    /**
+     * @brief Identify the wheel drives and compute the regulator gains, the robot has to be lifted.
+     *
+     * The regulator loop drives the wheels with the duty cycle steps of the experiment instead
+     * of the regulator, target speeds are ignored until it ends. Runs only while the drive is
+     * operational, disabling the drive aborts it.
+     * @return false if the drive is not operational
+     */
+    bool startTuning(const MotorTunerParams & params);
+
+    void stopTuning();
+
+    MotorTunerState getTuningResult(MotorTunerResult & result);
+
+    /** Apply the gains of the last successful experiment to the regulator. */
+    bool applyTuning();
+
     // void getPidDebugData(PidDebugData * data, RosbotMotNum mot_num);
     
 private:
@@ -119,28 +281,84 @@ private:
 
     void regulatorLoop();
 
+    void regulatorTick();
+
+    void regulatorUpdate();
+
+    void updateTimingStats(uint32_t start_us, uint32_t release_us, uint32_t missed);
+
+    void sampleEncoders(EncoderSnapshot & snapshot);
+
+    float estimateSpeed(int mot_num, const EncoderSnapshot & snapshot, const EncoderSnapshot & ref);
+
+    void resetHistory();
+
+    void publishState(const EncoderSnapshot & snapshot);
+
+    void updateOdometry(const EncoderSnapshot & snapshot);
+
+    void updateProfile(uint32_t dt_us);
+
+    void resetProfile();
+
+    void setWheelTargets(const DriveProfileParams & p, float linear, float angular);
+
+    uint32_t setRegulatorInterval(uint32_t dt_us);
+
     volatile RosbotDriveStates _state;
     volatile bool _regulator_output_enabled;
-    volatile bool _regulator_loop_enabled;
 
     RosbotWheel _wheel_params;
 
     volatile float _tspeed_mps[4];
     volatile float _cspeed_mps[4];
-    volatile int32_t _cdistance[4];
+    EncoderSnapshot _snapshot;
+    DriveStateSnapshot _state_buffer[2];
+    volatile uint32_t _state_sequence;
+    struct EdgeHistory
+    {
+        int32_t ticks[EDGE_HISTORY_SIZE];
+        uint32_t time_us[EDGE_HISTORY_SIZE];
+        uint8_t head;
+    } _edge_history[4];
+    volatile SpeedEstimator _speed_estimator;
     uint8_t _motor_sequence[4];
 
-    int _regulator_interval_ms; 
+    EncoderSnapshot _snapshot_history[SNAPSHOT_HISTORY_SIZE];
+    uint8_t _snapshot_head;
+    uint8_t _speed_window;
 
     float _wheel_coefficient1;
     float _wheel_coefficient2;
+
+    OdometryIntegrator _odometry;
+    DriveOdometryParams _odometry_params;
+    volatile bool _odometry_enabled;
+
+    TractionMonitor _traction;
+    MotorTuner _tuner;
+
+    VelocityProfiler _profile;
+    DriveProfileParams _profile_params;  // used by the regulator loop
+    DriveProfileParams _profile_request; // set by enableProfile(), taken over by the loop
+    volatile bool _profile_changed;
+    volatile bool _profile_restart;      // the loop starts the profile from the wheel targets
+    volatile bool _profile_enabled;
+    float _target_velocity[2];          // linear, angular
+    volatile uint32_t _target_sequence; // incremented by every new target
+    uint32_t _profile_sequence;         // target the profile is planned to
     
     DRV8848 * _mot_driver[2];
     DRV8848::DRVMotor * _mot[4]; 
     Encoder * _encoder[4];
-    RosbotRegulator * _regulator[4];
+    RosbotRegulatorBank4 * _regulator;
+
+    volatile uint32_t _regulator_interval_us;
 
-    Mutex rosbot_drive_mutex;
+    volatile uint32_t _regulator_releases;
+    volatile uint32_t _regulator_release_us;
+    RegulatorTimingStats _timing_stats;
+    uint64_t _jitter_sum_us;
 };
 
 #endif /* __ROSBOT_DRIVE_H__ */
\ No newline at end of file
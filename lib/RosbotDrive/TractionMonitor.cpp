@@ -0,0 +1,142 @@
+#include "TractionMonitor.h"
+#include <math.h>
+#include <string.h>
+
+// motors of one driver are on the same side of ROSbot
+const TractionParams TractionMonitor::DEFAULT_PARAMS = {
+    .slip_ratio = 0.3f,
+    .min_speed = 0.05f,
+    .stall_duty = 0.75f,
+    .stall_speed = 0.02f,
+    .slip_detect_us = 100000,
+    .stall_detect_us = 500000,
+    .actions = TRACTION_MONITOR,
+    .partner = {1, 0, 3, 2}};
+
+TractionMonitor::TractionMonitor()
+: _params(DEFAULT_PARAMS)
+{
+    resetStats();
+}
+
+void TractionMonitor::setParams(const TractionParams & params)
+{
+    _params = params;
+    for (int i = 0; i < 4; i++)
+        if (_params.partner[i] > 3)
+            _params.partner[i] = i;
+    reset();
+}
+
+void TractionMonitor::getParams(TractionParams & params) const
+{
+    params = _params;
+}
+
+void TractionMonitor::reset()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        _stats.wheel[i].slip = 0.0f;
+        _stats.wheel[i].slipping = false;
+        _stats.wheel[i].stalled = false;
+        _slip_us[i] = 0;
+        _stall_us[i] = 0;
+    }
+}
+
+void TractionMonitor::resetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    memset(_slip_time_us, 0, sizeof(_slip_time_us));
+    reset();
+}
+
+void TractionMonitor::update(float * setpoint, const float * speed, const float * pidout, uint32_t dt_us)
+{
+    // directions are taken before any setpoint is limited
+    float dir[4];
+    for (int i = 0; i < 4; i++)
+        dir[i] = setpoint[i] > 0.0f ? 1.0f : (setpoint[i] < 0.0f ? -1.0f : 0.0f);
+
+    for (int i = 0; i < 4; i++)
+    {
+        TractionWheelStats & w = _stats.wheel[i];
+        int p = _params.partner[i];
+
+        // speed excess over the partner in the commanded direction, a saturated or stalled partner is blocked rather than gripping
+        float slip = 0.0f;
+        bool blocked = (_params.stall_duty > 0.0f && fabsf(pidout[p]) >= _params.stall_duty) || _stats.wheel[p].stalled;
+        if (_params.slip_ratio > 0.0f && dir[i] != 0.0f && p != i && !blocked)
+        {
+            float v = speed[i] * dir[i];
+            float vp = speed[p] * dir[i];
+            float ref = fmaxf(fabsf(v), fabsf(vp));
+            if (ref >= _params.min_speed)
+                slip = (v - vp) / ref;
+        }
+        w.slip = slip;
+
+        // the slip ends with hysteresis, at half of the threshold
+        if (slip > (w.slipping ? 0.5f * _params.slip_ratio : _params.slip_ratio))
+        {
+            _slip_us[i] = _slip_us[i] + dt_us < _params.slip_detect_us ? _slip_us[i] + dt_us : _params.slip_detect_us;
+            if (!w.slipping && _slip_us[i] >= _params.slip_detect_us)
+            {
+                w.slipping = true;
+                w.slip_events++;
+            }
+        }
+        else
+        {
+            _slip_us[i] = 0;
+            w.slipping = false;
+        }
+        if (w.slipping)
+        {
+            _slip_time_us[i] += dt_us;
+            w.slip_time_ms += _slip_time_us[i] / 1000;
+            _slip_time_us[i] %= 1000;
+            float limit = fabsf(speed[p]);
+            if ((_params.actions & TRACTION_LIMIT_SLIP) && fabsf(setpoint[i]) > limit)
+                setpoint[i] = dir[i] * limit;
+        }
+
+        bool stall = _params.stall_duty > 0.0f && dir[i] != 0.0f && fabsf(pidout[i]) >= _params.stall_duty &&
+                     fabsf(speed[i]) < _params.stall_speed;
+        if (w.stalled)
+        {
+            // a switched off wheel stays so until the stop command, it does not saturate anymore
+            bool cut = _params.actions & TRACTION_CUT_STALL;
+            if (dir[i] == 0.0f || (!cut && !stall))
+            {
+                w.stalled = false;
+                _stall_us[i] = 0;
+            }
+        }
+        else if (stall)
+        {
+            _stall_us[i] = _stall_us[i] + dt_us < _params.stall_detect_us ? _stall_us[i] + dt_us : _params.stall_detect_us;
+            if (_stall_us[i] >= _params.stall_detect_us)
+            {
+                w.stalled = true;
+                w.stall_events++;
+            }
+        }
+        else
+            _stall_us[i] = 0;
+        if (w.stalled && (_params.actions & TRACTION_CUT_STALL))
+            setpoint[i] = 0.0f;
+    }
+}
+
+uint8_t TractionMonitor::getFlags() const
+{
+    uint8_t flags = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        flags |= _stats.wheel[i].slipping ? 1 << i : 0;
+        flags |= _stats.wheel[i].stalled ? 1 << (i + 4) : 0;
+    }
+    return flags;
+}
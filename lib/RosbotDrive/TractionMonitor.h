@@ -0,0 +1,102 @@
+/** @file TractionMonitor.h
+ * Per-wheel slip and stall detection of a skid steering drive.
+ *
+ * The wheels of one side are coupled through the ground, so a wheel that turns faster than
+ * its partner in the commanded direction has lost traction. The slip ratio of a wheel is its
+ * speed excess over the partner relative to the faster of the two, it is not evaluated against
+ * a blocked partner (saturated output or stalled). A wheel whose regulator output is saturated
+ * while it hardly turns is stalled. Both conditions have to last for their detection time to
+ * raise an event. Optionally the setpoint of a slipping wheel is limited to the speed of its
+ * partner (the regulator ramps it down with its acceleration limit) and a stalled wheel is
+ * switched off until it is commanded to stop.
+ */
+#ifndef __TRACTION_MONITOR_H__
+#define __TRACTION_MONITOR_H__
+
+#include <stdint.h>
+
+/**
+ * @brief Reactions of the traction monitor.
+ */
+enum TractionAction : uint8_t
+{
+    TRACTION_MONITOR = 0,    ///< Only detect and count.
+    TRACTION_LIMIT_SLIP = 1, ///< Limit the setpoint of a slipping wheel to the speed of its partner.
+    TRACTION_CUT_STALL = 2   ///< Zero the setpoint of a stalled wheel until it is commanded to stop.
+};
+
+/**
+ * @brief Parameters of the traction monitor.
+ */
+struct TractionParams
+{
+    float slip_ratio;         ///< Slip ratio above which a wheel slips, 0 - no slip detection.
+    float min_speed;          ///< Wheels slower than this are not compared [m/s].
+    float stall_duty;         ///< Regulator output treated as saturated (duty cycle), 0 - no stall detection.
+    float stall_speed;        ///< A saturated wheel slower than this is stalled [m/s].
+    uint32_t slip_detect_us;  ///< Time the slip has to last to raise an event.
+    uint32_t stall_detect_us; ///< Time the stall has to last to raise an event.
+    uint8_t actions;          ///< TractionAction flags.
+    uint8_t partner[4];       ///< Wheel on the same side of each wheel, itself - no slip detection.
+};
+
+/**
+ * @brief Traction state and counters of a wheel.
+ */
+struct TractionWheelStats
+{
+    float slip;            ///< Last slip ratio.
+    bool slipping;         ///< Slip event in progress.
+    bool stalled;          ///< Stall event in progress.
+    uint32_t slip_events;  ///< Number of slip events.
+    uint32_t stall_events; ///< Number of stall events.
+    uint32_t slip_time_ms; ///< Total time spent slipping.
+};
+
+struct TractionStats
+{
+    TractionWheelStats wheel[4];
+};
+
+class TractionMonitor
+{
+public:
+    static const TractionParams DEFAULT_PARAMS;
+
+    TractionMonitor();
+
+    void setParams(const TractionParams & params);
+
+    void getParams(TractionParams & params) const;
+
+    /** Clear the events in progress, the counters are kept. */
+    void reset();
+
+    void resetStats();
+
+    /**
+     * @brief Evaluate one regulator iteration.
+     * @param setpoint target wheel speeds [m/s], limited in place by the actions
+     * @param speed measured wheel speeds [m/s]
+     * @param pidout regulator outputs of the previous iteration (duty cycle)
+     * @param dt_us time since the previous iteration
+     */
+    void update(float * setpoint, const float * speed, const float * pidout, uint32_t dt_us);
+
+    void getStats(TractionStats & stats) const
+    {
+        stats = _stats;
+    }
+
+    /** @return bit mask of slipping (bits 0-3) and stalled (bits 4-7) wheels */
+    uint8_t getFlags() const;
+
+private:
+    TractionParams _params;
+    TractionStats _stats;
+    uint32_t _slip_us[4];  // time the slip condition lasts
+    uint32_t _stall_us[4]; // time the stall condition lasts
+    uint32_t _slip_time_us[4];
+};
+
+#endif /* __TRACTION_MONITOR_H__ */
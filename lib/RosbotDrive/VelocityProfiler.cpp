@@ -0,0 +1,161 @@
+#include "VelocityProfiler.h"
+#include <math.h>
+
+#define PROFILE_EPS 1e-6f      // velocity difference treated as reached
+#define SYNC_TOLERANCE_S 1e-4f // profiles ending this close end together
+#define SYNC_ITERATIONS 20
+
+// the same acceleration to jerk ratio on both axes, 0.8 m/s^2 and 5 rad/s^2 stay below the wheel a_max
+const VelocityLimits VelocityProfiler::DEFAULT_LIMITS = {
+    .linear_acc = 0.8f,
+    .linear_jerk = 8.0f,
+    .angular_acc = 5.0f,
+    .angular_jerk = 50.0f};
+
+VelocityProfiler::VelocityProfiler()
+: _limits(DEFAULT_LIMITS)
+{
+    reset(0.0f, 0.0f);
+}
+
+void VelocityProfiler::setLimits(const VelocityLimits & limits)
+{
+    _limits = limits;
+    setTarget(_axis[0].vt, _axis[1].vt);
+}
+
+void VelocityProfiler::getLimits(VelocityLimits & limits) const
+{
+    limits = _limits;
+}
+
+void VelocityProfiler::reset(float linear, float angular)
+{
+    _axis[0].v = linear;
+    _axis[1].v = angular;
+    for (int i = 0; i < 2; i++)
+    {
+        _axis[i].a = 0.0f;
+        plan(_axis[i], _axis[i].v, 0.0f, 0.0f);
+    }
+    _time = 0.0f;
+    _duration = 0.0f;
+}
+
+void VelocityProfiler::setTarget(float linear, float angular)
+{
+    const float target[2] = {linear, angular};
+    const float acc[2] = {_limits.linear_acc, _limits.angular_acc};
+    const float jerk[2] = {_limits.linear_jerk, _limits.angular_jerk};
+    float duration[2];
+    for (int i = 0; i < 2; i++) duration[i] = plan(_axis[i], target[i], acc[i], jerk[i]);
+    _duration = duration[0] > duration[1] ? duration[0] : duration[1];
+    _time = 0.0f;
+
+    // the faster axis is slowed down to end with the other one, both limits are scaled together
+    for (int i = 0; i < 2; i++)
+    {
+        Axis & axis = _axis[i];
+        if (duration[i] >= _duration - SYNC_TOLERANCE_S || acc[i] <= 0.0f || jerk[i] <= 0.0f)
+            continue;
+        if (fabsf(axis.vt - axis.v0) < PROFILE_EPS && axis.a0 == 0.0f)
+            continue;
+        float low = 0.0f, high = 1.0f;
+        for (int n = 0; n < SYNC_ITERATIONS; n++)
+        {
+            float k = 0.5f * (low + high);
+            if (plan(axis, target[i], k * acc[i], k * jerk[i]) > _duration)
+                low = k;
+            else
+                high = k;
+        }
+        plan(axis, target[i], high * acc[i], high * jerk[i]);
+    }
+}
+
+void VelocityProfiler::update(uint32_t dt_us)
+{
+    _time += dt_us * 1e-6f;
+    if (_time >= _duration)
+    {
+        // exactly at the targets, the segment times do not add up exactly in float
+        _time = _duration;
+        for (int i = 0; i < 2; i++)
+        {
+            _axis[i].v = _axis[i].vt;
+            _axis[i].a = 0.0f;
+        }
+        return;
+    }
+    for (int i = 0; i < 2; i++) evaluate(_axis[i], _time);
+}
+
+float VelocityProfiler::plan(Axis & axis, float vt, float acc, float jerk)
+{
+    axis.v0 = axis.v;
+    axis.a0 = axis.a;
+    axis.vt = vt;
+    axis.j1 = axis.j3 = axis.ap = 0.0f;
+    axis.t1 = axis.t2 = axis.t3 = 0.0f;
+    if (acc <= 0.0f || jerk <= 0.0f)
+    {
+        axis.v1 = axis.v2 = vt;
+        return 0.0f;
+    }
+
+    float a0 = axis.a0;
+    float diff = vt - (axis.v0 + 0.5f * a0 * fabsf(a0) / jerk); // against the velocity at which the acceleration ramps to zero
+    if (fabsf(diff) < PROFILE_EPS)
+    {
+        axis.t1 = fabsf(a0) / jerk;
+        axis.j1 = a0 > 0.0f ? -jerk : jerk;
+    }
+    else
+    {
+        // in the direction of the change: ramp the acceleration to the peak, hold it, ramp it to zero
+        float d = diff > 0.0f ? 1.0f : -1.0f;
+        float a = d * a0;
+        float delta = d * (vt - axis.v0);
+        float peak = a > acc ? acc : sqrtf(jerk * delta + 0.5f * a * a);
+        if (peak > acc)
+            peak = acc;
+        float dv1 = 0.5f * (a + peak) * fabsf(peak - a) / jerk;
+        axis.t2 = (delta - dv1 - 0.5f * peak * peak / jerk) / peak;
+        if (axis.t2 < 0.0f)
+            axis.t2 = 0.0f;
+        axis.t1 = fabsf(peak - a) / jerk;
+        axis.j1 = peak >= a ? d * jerk : -d * jerk;
+        axis.ap = d * peak;
+        axis.t3 = peak / jerk;
+        axis.j3 = -d * jerk;
+    }
+    axis.v1 = axis.v0 + a0 * axis.t1 + 0.5f * axis.j1 * axis.t1 * axis.t1;
+    axis.v2 = axis.v1 + axis.ap * axis.t2;
+    return axis.t1 + axis.t2 + axis.t3;
+}
+
+void VelocityProfiler::evaluate(Axis & axis, float t)
+{
+    if (t < axis.t1)
+    {
+        axis.a = axis.a0 + axis.j1 * t;
+        axis.v = axis.v0 + axis.a0 * t + 0.5f * axis.j1 * t * t;
+        return;
+    }
+    t -= axis.t1;
+    if (t < axis.t2)
+    {
+        axis.a = axis.ap;
+        axis.v = axis.v1 + axis.ap * t;
+        return;
+    }
+    t -= axis.t2;
+    if (t < axis.t3)
+    {
+        axis.a = axis.ap + axis.j3 * t;
+        axis.v = axis.v2 + axis.ap * t + 0.5f * axis.j3 * t * t;
+        return;
+    }
+    axis.a = 0.0f;
+    axis.v = axis.vt;
+}
@@ -0,0 +1,103 @@
+/** @file VelocityProfiler.h
+ * Jerk-limited (S-curve) profile of the body velocity of a skid steering robot.
+ *
+ * The linear and the angular velocity follow their targets with limited acceleration and jerk.
+ * Every new target plans a time-optimal profile of each axis from its current velocity and
+ * acceleration (jerk, constant acceleration, jerk), so a target changed during a ramp does not
+ * step the acceleration. The axis that would finish first has its limits scaled down to end
+ * together with the other one. Starting at constant velocities with the same acceleration to
+ * jerk ratio on both axes the two profiles have the same shape, the wheel speeds then change
+ * in proportion and the robot keeps the commanded curvature during the whole ramp.
+ */
+#ifndef __VELOCITY_PROFILER_H__
+#define __VELOCITY_PROFILER_H__
+
+#include <stdint.h>
+
+/**
+ * @brief Limits of the velocity profile, an axis with a zero limit steps to its target.
+ */
+struct VelocityLimits
+{
+    float linear_acc;   ///< [m/s^2]
+    float linear_jerk;  ///< [m/s^3]
+    float angular_acc;  ///< [rad/s^2]
+    float angular_jerk; ///< [rad/s^3]
+};
+
+class VelocityProfiler
+{
+public:
+    static const VelocityLimits DEFAULT_LIMITS;
+
+    VelocityProfiler();
+
+    /** Set the limits, the current target is planned again. */
+    void setLimits(const VelocityLimits & limits);
+
+    void getLimits(VelocityLimits & limits) const;
+
+    /** Hold constant velocities, the target is set to them. */
+    void reset(float linear, float angular);
+
+    /** Plan the profile to a new target from the current state. */
+    void setTarget(float linear, float angular);
+
+    /** Advance the profile by one period. */
+    void update(uint32_t dt_us);
+
+    float getLinear() const
+    {
+        return _axis[0].v;
+    }
+
+    float getAngular() const
+    {
+        return _axis[1].v;
+    }
+
+    float getLinearAcc() const
+    {
+        return _axis[0].a;
+    }
+
+    float getAngularAcc() const
+    {
+        return _axis[1].a;
+    }
+
+    /** @return time left to the end of the profile [s] */
+    float getRemainingTime() const
+    {
+        return _duration > _time ? _duration - _time : 0.0f;
+    }
+
+private:
+    struct Axis
+    {
+        float v;  // current state
+        float a;
+        float v0; // state at the start of the profile
+        float a0;
+        float vt; // target
+        float j1; // jerk of the first segment
+        float t1;
+        float ap; // acceleration of the second segment
+        float t2;
+        float j3; // jerk of the last segment
+        float t3;
+        float v1; // velocity at the end of the first and the second segment
+        float v2;
+    };
+
+    static float plan(Axis & axis, float vt, float acc, float jerk);
+
+    static void evaluate(Axis & axis, float t);
+
+    VelocityLimits _limits;
+    Axis _axis[2];
+    float _time;
+    float _duration;
+};
+
+#endif /* __VELOCITY_PROFILER_H__ */
@@ -4,16 +4,36 @@
 #ifndef __ROSBOT_REGULATOR_H__
 #define __ROSBOT_REGULATOR_H__
 
+#include <stdint.h>
+
+#define REGULATOR_REFERENCE_PERIOD_US 10000.0f /**< Regulator gains are expressed for this period and rescaled to dt_us.*/
+#define MAX_ACCELERATION 2.0f /**< m/s^2 */
+
+/**
+ * @brief Control law of the wheel speed regulator.
+ */
+enum RosbotRegulatorType : uint8_t
+{
+    REGULATOR_INCREMENTAL = 0, ///< Incremental PID (arm_pid_f32 form) with output clamping.
+    REGULATOR_FEEDFORWARD = 1  ///< Velocity feed-forward, PI with back-calculation anti-windup, filtered derivative on measurement.
+};
+
 struct RosbotRegulator_params
 {
-    float kp;
-    float ki;
-    float kd;
-    float out_min;
-    float out_max;
-    float a_max;
-    float speed_max;
-    unsigned int dt_ms;
+    float kp;          // proportional gain
+    float ki;          // integral gain (per REGULATOR_REFERENCE_PERIOD_US)
+    float kd;          // derivative gain (per REGULATOR_REFERENCE_PERIOD_US)
+    float out_min;     // duty cycle
+    float out_max;     // duty cycle
+    float a_max;       // m/s^2
+    float speed_max;   // m/s
+    uint32_t dt_us;    // regulator period
+    uint8_t type;      // RosbotRegulatorType
+    float kv;          // velocity feed-forward, duty per m/s (REGULATOR_FEEDFORWARD)
+    float ks;          // static friction feed-forward, duty (REGULATOR_FEEDFORWARD)
+    float ka;          // acceleration feed-forward, duty per m/s^2 (REGULATOR_FEEDFORWARD)
+    float kt;          // anti-windup back-calculation gain (per REGULATOR_REFERENCE_PERIOD_US, REGULATOR_FEEDFORWARD)
+    float tf;          // derivative filter time constant [s] (REGULATOR_FEEDFORWARD)
 };
 
 class RosbotRegulator
@@ -0,0 +1,202 @@
+/** @file RosbotRegulatorBank4.h
+ * Speed regulator of all four wheels evaluated in one pass.
+ *
+ * Implements the control law of RosbotRegulatorCMSIS (REGULATOR_INCREMENTAL - acceleration
+ * ramp, incremental PID, output clamping) and the feed-forward law (REGULATOR_FEEDFORWARD),
+ * selected by RosbotRegulator_params::type, but keeps the state of the wheels in a
+ * structure-of-arrays layout and computes all wheels in straight-line loops without virtual
+ * calls or branches, so the compiler can unroll them on Cortex-M4 FPU and vectorize them on host.
+ */
+#ifndef __ROSBOT_REGULATOR_BANK4_H__
+#define __ROSBOT_REGULATOR_BANK4_H__
+
+#include <math.h>
+#include <string.h>
+#include "RosbotRegulator.h"
+
+class RosbotRegulatorBank4
+{
+public:
+    RosbotRegulatorBank4()
+    : _speed_step(0.0f)
+    , _a0(0.0f)
+    , _a1(0.0f)
+    , _a2(0.0f)
+    , _ki(0.0f)
+    , _kd(0.0f)
+    , _kt(0.0f)
+    , _ka(0.0f)
+    , _alpha(0.0f)
+    {
+        memset(&_params, 0, sizeof(_params));
+        memset(&_s, 0, sizeof(_s));
+    }
+
+    void updateParams(const RosbotRegulator_params &params)
+    {
+        _params = params;
+        // the acceleration limit and the gains do not depend on the regulator period
+        float scale = _params.dt_us / REGULATOR_REFERENCE_PERIOD_US;
+        float dt = _params.dt_us * 1e-6f;
+        float ki = _params.ki * scale;
+        float kd = _params.kd / scale;
+        _speed_step = (_params.a_max > MAX_ACCELERATION ? MAX_ACCELERATION : _params.a_max) * 1e-6f * _params.dt_us;
+        _a0 = _params.kp + ki + kd;
+        _a1 = (-_params.kp) - (2.0f * kd);
+        _a2 = kd;
+        _ki = ki;
+        _kd = kd;
+        _kt = _params.kt * scale > 1.0f ? 1.0f : _params.kt * scale;
+        _ka = _params.ka / dt;
+        _alpha = dt / (_params.tf + dt);
+        memset(&_s, 0, sizeof(_s));
+    }
+
+    void getParams(RosbotRegulator_params &params)
+    {
+        params = _params;
+    }
+
+    /**
+     * @brief Compute regulator outputs of all wheels.
+     * @param setpoint target wheel speeds [m/s]
+     * @param feedback measured wheel speeds [m/s]
+     * @param out regulator outputs (duty cycle)
+     */
+    void updateState(const float * __restrict setpoint, const float * __restrict feedback, float * __restrict out)
+    {
+        if (_params.type == REGULATOR_FEEDFORWARD)
+            updateFeedForward(setpoint, feedback, out);
+        else
+            updateIncremental(setpoint, feedback, out);
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            _s.x0[i] = _s.x1[i] = _s.y[i] = 0.0f;
+            _s.vsetpoint[i] = 0.0f;
+            _s.integral[i] = _s.derivative[i] = 0.0f;
+        }
+    }
+
+    float getPidout(int wheel)
+    {
+        return _s.pidout[wheel];
+    }
+
+    float getError(int wheel)
+    {
+        return _s.error[wheel];
+    }
+
+private:
+    void updateIncremental(const float * __restrict setpoint, const float * __restrict feedback, float * __restrict out)
+    {
+        const float step = _speed_step;
+        const float speed_max = _params.speed_max;
+        const float out_max = _params.out_max;
+        const float out_min = _params.out_min;
+        // bitwise & instead of && and plain selects keep the loop free of branches
+        for (int i = 0; i < 4; i++)
+        {
+            float sp = setpoint[i];
+            float fb = feedback[i];
+            float v = _s.vsetpoint[i];
+            bool stop = sp == 0.0f;
+
+            // target speed limit and acceleration limit
+            float cs = v + copysignf(step, sp - v);
+            float cl = cs > speed_max ? speed_max : cs;
+            cl = cs < -speed_max ? -speed_max : cl;
+            cl = (fabsf(cs) <= step) & stop ? 0.0f : cl;
+
+            float e = cl - fb;
+            float y = (_a0 * e) + (_a1 * _s.x0[i]) + (_a2 * _s.x1[i]) + _s.y[i];
+            float u = y > out_max ? out_max : y;
+            u = y < out_min ? out_min : u;
+
+            // the wheel is stopped and should stay so - reset the regulator
+            bool halt = (fabsf(fb) <= step) & stop;
+            _s.x1[i] = halt ? 0.0f : _s.x0[i];
+            _s.x0[i] = halt ? 0.0f : e;
+            _s.y[i] = halt ? 0.0f : y;
+            _s.vsetpoint[i] = halt ? 0.0f : cl;
+            _s.error[i] = halt ? sp - fb : e;
+            _s.pidout[i] = halt ? 0.0f : u;
+            out[i] = _s.pidout[i];
+        }
+    }
+
+    void updateFeedForward(const float * __restrict setpoint, const float * __restrict feedback, float * __restrict out)
+    {
+        const float step = _speed_step;
+        const float speed_max = _params.speed_max;
+        const float out_max = _params.out_max;
+        const float out_min = _params.out_min;
+        const float kp = _params.kp, kv = _params.kv, ks = _params.ks, ka = _ka;
+        const float ki = _ki, kd = _kd, kt = _kt, alpha = _alpha;
+        for (int i = 0; i < 4; i++)
+        {
+            float sp = setpoint[i];
+            float fb = feedback[i];
+            float v = _s.vsetpoint[i];
+            bool stop = sp == 0.0f;
+
+            // target speed limit and acceleration limit, the ramp stops at the setpoint
+            float dv = sp - v;
+            dv = dv > step ? step : dv;
+            dv = dv < -step ? -step : dv;
+            float cs = v + dv;
+            float cl = cs > speed_max ? speed_max : cs;
+            cl = cs < -speed_max ? -speed_max : cl;
+
+            // motor model, the PID only corrects what the model misses
+            float fs = cl != 0.0f ? copysignf(ks, cl) : 0.0f;
+            float ff = (kv * cl) + fs + (ka * (cl - v));
+            float e = cl - fb;
+            float d = _s.derivative[i] + (alpha * ((-kd * (fb - _s.feedback[i])) - _s.derivative[i]));
+            float y = ff + (kp * e) + _s.integral[i] + d;
+            float u = y > out_max ? out_max : y;
+            u = y < out_min ? out_min : u;
+            // back-calculation - the saturation excess is taken back from the integral
+            float integral = _s.integral[i] + (ki * e) + (kt * (u - y));
+
+            // the wheel is stopped and should stay so - reset the regulator
+            bool halt = (fabsf(fb) <= step) & stop;
+            _s.integral[i] = halt ? 0.0f : integral;
+            _s.derivative[i] = halt ? 0.0f : d;
+            _s.feedback[i] = fb;
+            _s.vsetpoint[i] = halt ? 0.0f : cl;
+            _s.error[i] = halt ? sp - fb : e;
+            _s.pidout[i] = halt ? 0.0f : u;
+            out[i] = _s.pidout[i];
+        }
+    }
+
+    RosbotRegulator_params _params;
+    float _speed_step;
+    float _a0; // A0 = Kp + Ki + Kd
+    float _a1; // A1 = -Kp - 2Kd
+    float _a2; // A2 = Kd
+    float _ki; // integral gain per period
+    float _kd; // derivative gain per period
+    float _kt; // back-calculation gain per period
+    float _ka; // acceleration feed-forward per setpoint step
+    float _alpha; // derivative filter coefficient
+    struct
+    {
+        float x0[4];        // e[n-1]
+        float x1[4];        // e[n-2]
+        float y[4];         // y[n-1]
+        float vsetpoint[4]; // ramped setpoint
+        float integral[4];  // REGULATOR_FEEDFORWARD integral term
+        float derivative[4]; // REGULATOR_FEEDFORWARD filtered derivative term
+        float feedback[4];  // REGULATOR_FEEDFORWARD previous measurement
+        float error[4];
+        float pidout[4];
+    } _s;
+};
+
+#endif /* __ROSBOT_REGULATOR_BANK4_H__ */
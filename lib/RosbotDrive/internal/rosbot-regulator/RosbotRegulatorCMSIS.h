@@ -92,8 +92,6 @@ void arm_pid_reset_f32(
 }
 /***************************CMSIS-DSP-PID***************************/
 
-#define MAX_ACCELERATION 2e-4
-
 class RosbotRegulatorCMSIS : public RosbotRegulator
 {
 public:
@@ -104,16 +102,7 @@ public:
     , _vsetpoint(0.0f)
     , _speed_step(0.0f)
     {
-        _state.Kp = _params.kp;
-        _state.Ki = _params.ki;
-        _state.Kd = _params.kd;
-        MBED_ASSERT(_params.a_max <= MAX_ACCELERATION);
-        if(_params.a_max > MAX_ACCELERATION)
-        {
-            _speed_step = MAX_ACCELERATION * 1000.0f / _params.dt_ms;
-        }
-        else
-            _speed_step = _params.a_max * 1000.0f / _params.dt_ms;
+        updateCoefficients();
         arm_pid_init_f32(&_state,1);
     }
 
@@ -122,17 +111,7 @@ public:
     void updateParams(const RosbotRegulator_params &params)
     {
         _params = params;
-        _state.Kp = _params.kp;
-        _state.Ki = _params.ki;
-        _state.Kd = _params.kd;
-        MBED_ASSERT(_params.a_max <= MAX_ACCELERATION);
-        if(_params.a_max > MAX_ACCELERATION)
-        {
-            _speed_step = MAX_ACCELERATION * 1000.0f / _params.dt_ms;
-        }
-        else
-            _speed_step = _params.a_max * 1000.0f / _params.dt_ms;
-        _speed_step = _params.a_max * 1000.0f / _params.dt_ms;
+        updateCoefficients();
         _vsetpoint = 0;
         arm_pid_init_f32(&_state,1);
     }
@@ -190,6 +169,16 @@ public:
     }
 
 private:
+    void updateCoefficients()
+    {
+        // the acceleration limit and the gains do not depend on the regulator period
+        float scale = _params.dt_us / REGULATOR_REFERENCE_PERIOD_US;
+        _speed_step = (_params.a_max > MAX_ACCELERATION ? MAX_ACCELERATION : _params.a_max) * 1e-6f * _params.dt_us;
+        _state.Kp = _params.kp;
+        _state.Ki = _params.ki * scale;
+        _state.Kd = _params.kd / scale;
+    }
+
     arm_pid_instance_f32 _state;
     float _error;
     float _pidout;
@@ -0,0 +1,69 @@
+#include "RosserialFrameParser.h"
+
+#define SYNC_BYTE 0xff
+#define PROTOCOL_VERSION 0xfe
+
+RosserialFrameParser::RosserialFrameParser()
+{
+    reset();
+}
+
+void RosserialFrameParser::reset()
+{
+    _state = SYNC;
+    _length = 0;
+    _received = 0;
+    _checksum = 0;
+}
+
+RosserialFrameParser::Event RosserialFrameParser::feed(uint8_t byte)
+{
+    switch (_state)
+    {
+        case SYNC:
+            if (byte == SYNC_BYTE)
+                _state = PROTOCOL;
+            return NONE;
+        case PROTOCOL:
+            // a repeated sync byte may start the frame
+            _state = byte == PROTOCOL_VERSION ? LENGTH_L : (byte == SYNC_BYTE ? PROTOCOL : SYNC);
+            return NONE;
+        case LENGTH_L:
+            _length = byte;
+            _checksum = byte;
+            _state = LENGTH_H;
+            return NONE;
+        case LENGTH_H:
+            _length |= byte << 8;
+            _checksum += byte;
+            _state = LENGTH_CHECKSUM;
+            return NONE;
+        case LENGTH_CHECKSUM:
+            if (((_checksum + byte) & 0xff) != 0xff)
+            {
+                _state = SYNC;
+                return CHECKSUM_ERROR;
+            }
+            _checksum = 0;
+            _state = TOPIC_L;
+            return NONE;
+        case TOPIC_L:
+            _checksum += byte;
+            _state = TOPIC_H;
+            return NONE;
+        case TOPIC_H:
+            _checksum += byte;
+            _received = 0;
+            _state = _length ? MESSAGE : CHECKSUM;
+            return NONE;
+        case MESSAGE:
+            _checksum += byte;
+            if (++_received == _length)
+                _state = CHECKSUM;
+            return NONE;
+        case CHECKSUM:
+        default:
+            _state = SYNC;
+            return ((_checksum + byte) & 0xff) == 0xff ? FRAME : CHECKSUM_ERROR;
+    }
+}
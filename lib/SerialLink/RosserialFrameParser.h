@@ -0,0 +1,50 @@
+/** @file RosserialFrameParser.h
+ * Passive parser of the rosserial serial protocol.
+ *
+ * The parser follows the byte stream read by the rosserial node handle and reports complete
+ * frames and frames with a wrong length or message checksum, which the node handle drops
+ * silently. Frame layout: 0xff, protocol version 0xfe, length (2 bytes), length checksum,
+ * topic id (2 bytes), message, checksum over the topic id and the message.
+ */
+#ifndef __ROSSERIAL_FRAME_PARSER_H__
+#define __ROSSERIAL_FRAME_PARSER_H__
+
+#include <mbed.h>
+
+class RosserialFrameParser
+{
+public:
+    enum Event
+    {
+        NONE = 0,      ///< Frame in progress or bytes between frames.
+        FRAME,         ///< Frame with correct checksums.
+        CHECKSUM_ERROR ///< Frame dropped because of a wrong checksum.
+    };
+
+    RosserialFrameParser();
+
+    Event feed(uint8_t byte);
+
+    void reset();
+
+private:
+    enum State
+    {
+        SYNC = 0,
+        PROTOCOL,
+        LENGTH_L,
+        LENGTH_H,
+        LENGTH_CHECKSUM,
+        TOPIC_L,
+        TOPIC_H,
+        MESSAGE,
+        CHECKSUM
+    };
+
+    State _state;
+    uint16_t _length;
+    uint16_t _received;
+    uint32_t _checksum;
+};
+
+#endif /* __ROSSERIAL_FRAME_PARSER_H__ */
@@ -0,0 +1,110 @@
+/** @file RosserialMessageSize.h
+ * Serialized length of the messages published by the firmware, without the rosserial framing.
+ *
+ * The lengths follow the rosserial serialization: strings and variable arrays are prefixed with
+ * a 4 byte length, float64 takes 8 bytes, time 8 bytes. Nothing is serialized, so the size of a
+ * message does not depend on a scratch buffer being large enough for it. The functions are
+ * templates over the generated message types, they only use the field names.
+ */
+#ifndef __ROSSERIAL_MESSAGE_SIZE_H__
+#define __ROSSERIAL_MESSAGE_SIZE_H__
+
+#include <stdint.h>
+#include <string.h>
+
+namespace rosserial_size
+{
+
+inline uint32_t string(const char * str)
+{
+    return 4 + (str ? (uint32_t)strlen(str) : 0);
+}
+
+/** std_msgs/Header: seq, stamp, frame_id */
+template <class Header>
+uint32_t header(const Header & header)
+{
+    return 4 + 8 + string(header.frame_id);
+}
+
+/** geometry_msgs/PoseStamped */
+template <class Msg>
+uint32_t poseStamped(const Msg & msg)
+{
+    return header(msg.header) + 3 * 8 + 4 * 8;
+}
+
+/** geometry_msgs/Twist */
+template <class Msg>
+uint32_t twist(const Msg & msg)
+{
+    return 6 * 8;
+}
+
+/** tf/tfMessage of geometry_msgs/TransformStamped */
+template <class Msg>
+uint32_t tfMessage(const Msg & msg)
+{
+    uint32_t size = 4;
+    for (uint32_t i = 0; i < msg.transforms_length; i++)
+        size += header(msg.transforms[i].header) + string(msg.transforms[i].child_frame_id) + 3 * 8 + 4 * 8;
+    return size;
+}
+
+/** sensor_msgs/JointState */
+template <class Msg>
+uint32_t jointState(const Msg & msg)
+{
+    uint32_t size = header(msg.header) + 4;
+    for (uint32_t i = 0; i < msg.name_length; i++)
+        size += string(msg.name[i]);
+    return size + 4 + 8 * msg.position_length + 4 + 8 * msg.velocity_length + 4 + 8 * msg.effort_length;
+}
+
+/** rosbot_ekf/Imu: quaternion in float64, gyro and accelerometer in float32 */
+template <class Msg>
+uint32_t imu(const Msg & msg)
+{
+    return header(msg.header) + 4 * 8 + sizeof(msg.angular_velocity) + sizeof(msg.linear_acceleration);
+}
+
+/** sensor_msgs/Range */
+template <class Msg>
+uint32_t range(const Msg & msg)
+{
+    return header(msg.header) + 1 + 4 * 4;
+}
+
+/** sensor_msgs/BatteryState */
+template <class Msg>
+uint32_t batteryState(const Msg & msg)
+{
+    return header(msg.header) + 6 * 4 + 3 + 1 + 4 + 4 * msg.cell_voltage_length + string(msg.location) + string(msg.serial_number);
+}
+
+/** rosbot_ekf/Telemetry: stamp, five float32 values, the fixed arrays, battery_mv and updated */
+template <class Msg>
+uint32_t telemetry(const Msg & msg)
+{
+    return 8 + 5 * 4 + sizeof(msg.wheel_position) + sizeof(msg.orientation) + sizeof(msg.gyro) + sizeof(msg.accel) +
+           sizeof(msg.range_mm) + 2 + 1;
+}
+
+/** diagnostic_msgs/DiagnosticArray */
+template <class Msg>
+uint32_t diagnosticArray(const Msg & msg)
+{
+    uint32_t size = header(msg.header) + 4;
+    for (uint32_t i = 0; i < msg.status_length; i++)
+    {
+        const auto & status = msg.status[i];
+        size += 1 + string(status.name) + string(status.message) + string(status.hardware_id) + 4;
+        for (uint32_t j = 0; j < status.values_length; j++)
+            size += string(status.values[j].key) + string(status.values[j].value);
+    }
+    return size;
+}
+
+} // namespace rosserial_size
+
+#endif /* __ROSSERIAL_MESSAGE_SIZE_H__ */
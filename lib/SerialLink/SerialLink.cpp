@@ -0,0 +1,159 @@
+#include "SerialLink.h"
+
+SerialLink::SerialLink()
+: _serial(MBED_CONF_ROSSERIAL_MBED_TX_PIN, MBED_CONF_ROSSERIAL_MBED_RX_PIN, MBED_CONF_ROSSERIAL_MBED_BAUDRATE)
+, _rx_overflows_base(0)
+, _baud(MBED_CONF_ROSSERIAL_MBED_BAUDRATE)
+#if SERIAL_LINK_ASYNC_TX
+, _tx_chunk(0)
+#else
+, _tx_irq_enabled(false)
+#endif
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+SerialLink::SerialLink(PinName tx, PinName rx, long baud)
+: _serial(tx, rx, baud)
+, _rx_overflows_base(0)
+, _baud(baud)
+#if SERIAL_LINK_ASYNC_TX
+, _tx_chunk(0)
+#else
+, _tx_irq_enabled(false)
+#endif
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void SerialLink::init()
+{
+    _serial.baud(_baud);
+    _serial.attach(callback(this, &SerialLink::onRx), SerialBase::RxIrq);
+#if SERIAL_LINK_ASYNC_TX
+    _serial.set_dma_usage_tx(DMA_USAGE_ALWAYS);
+#endif
+}
+
+void SerialLink::onRx()
+{
+    while (_serial.readable())
+    {
+        uint8_t byte = _serial.getc();
+        uint8_t * slot = _rx.beginWrite(); // a full ring counts the lost byte
+        if (slot == NULL)
+            continue;
+        *slot = byte;
+        _rx.commitWrite();
+    }
+}
+
+#if SERIAL_LINK_ASYNC_TX
+
+void SerialLink::startTransfer()
+{
+    uint8_t * chunk;
+    uint32_t n = _tx.peekContiguous(chunk);
+    if (n == 0)
+        return;
+    // a busy transmitter leaves the chunk for the next write()
+    if (_serial.write(chunk, n, callback(this, &SerialLink::onTransferDone), SERIAL_EVENT_TX_COMPLETE) == 0)
+        _tx_chunk = n;
+}
+
+void SerialLink::onTransferDone(int event)
+{
+    _stats.tx_chunks++;
+    _tx.release(_tx_chunk);
+    _tx_chunk = 0;
+    startTransfer();
+}
+
+#else
+
+void SerialLink::onTxIrq()
+{
+    _stats.tx_chunks++;
+    onTx();
+}
+
+void SerialLink::onTx()
+{
+    uint8_t * byte;
+    while (_serial.writeable() && (byte = _tx.peek()) != NULL)
+    {
+        _serial.putc(*byte);
+        _tx.release();
+    }
+    if (_tx.size() == 0 && _tx_irq_enabled)
+    {
+        _serial.attach(NULL, SerialBase::TxIrq);
+        _tx_irq_enabled = false;
+    }
+}
+
+#endif /* SERIAL_LINK_ASYNC_TX */
+
+int SerialLink::read()
+{
+    uint8_t * byte = _rx.peek();
+    if (byte == NULL)
+        return -1;
+    uint8_t data = *byte;
+    _rx.release();
+    _stats.rx_bytes++;
+    RosserialFrameParser::Event event = _parser.feed(data);
+    if (event == RosserialFrameParser::FRAME)
+        _stats.rx_frames++;
+    else if (event == RosserialFrameParser::CHECKSUM_ERROR)
+        _stats.checksum_errors++;
+    return data;
+}
+
+void SerialLink::write(uint8_t * data, int length)
+{
+    if (length <= 0)
+        return;
+    if (!_tx.write(data, length))
+    {
+        _stats.tx_dropped++;
+        return;
+    }
+    _stats.tx_bytes += length;
+    _stats.tx_frames++;
+    _stats.tx_peak = max<uint32_t>(_stats.tx_peak, _tx.size());
+
+    // the transmitter is started here, later chunks or bytes are sent from the interrupt
+    CriticalSectionLock lock;
+#if SERIAL_LINK_ASYNC_TX
+    if (_tx_chunk == 0)
+        startTransfer();
+#else
+    if (!_tx_irq_enabled)
+    {
+        onTx();
+        if (_tx.size())
+        {
+            _tx_irq_enabled = true;
+            _serial.attach(callback(this, &SerialLink::onTxIrq), SerialBase::TxIrq);
+        }
+    }
+#endif
+}
+
+unsigned long SerialLink::time()
+{
+    return (unsigned long)Kernel::get_ms_count();
+}
+
+void SerialLink::getStats(SerialLinkStats & stats)
+{
+    _stats.rx_overflows = _rx.overflows() - _rx_overflows_base;
+    stats = _stats;
+}
+
+void SerialLink::resetStats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _rx_overflows_base = _rx.overflows();
+}
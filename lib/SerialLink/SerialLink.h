@@ -0,0 +1,92 @@
+/** @file SerialLink.h
+ * Instrumented serial hardware layer of rosserial.
+ *
+ * Implements the hardware interface of ros::NodeHandle_ (init, read, write, time) on top of a
+ * UART with software transmit and receive rings. Every write() is one rosserial frame copied
+ * into the transmit ring, so publishing never waits for the line; a frame that does not fit
+ * is dropped as a whole, so the byte stream stays in sync. The ring is sent from the transmit
+ * interrupt byte by byte or, with serial-link.async-tx, in contiguous chunks with asynchronous
+ * serial transfers. On CORE2 (STM32F4, Mbed OS 5.14) an asynchronous transfer is still served
+ * from the UART interrupt byte by byte, without DMA, so the interrupt rate is not reduced, and
+ * the transfer installs its own UART interrupt handler in place of the one of the receive
+ * interrupt. The chunked mode is therefore off by default.
+ * Received bytes are followed by RosserialFrameParser to count frames with wrong checksums.
+ */
+#ifndef __SERIAL_LINK_H__
+#define __SERIAL_LINK_H__
+
+#include <mbed.h>
+#include <SpscRing.h>
+#include "RosserialFrameParser.h"
+
+#define SERIAL_LINK_ASYNC_TX (DEVICE_SERIAL_ASYNCH && MBED_CONF_SERIAL_LINK_ASYNC_TX) /**< Chunked transmission.*/
+
+/**
+ * @brief Transfer counters of the serial link.
+ */
+struct SerialLinkStats
+{
+    uint32_t tx_bytes;        ///< Bytes queued for transmission.
+    uint32_t tx_frames;       ///< Frames queued for transmission.
+    uint32_t tx_dropped;      ///< Frames dropped because the transmit ring was full.
+    uint32_t tx_peak;         ///< Highest fill of the transmit ring [bytes].
+    uint32_t tx_chunks;       ///< Chunks handed to the transmitter: transmit interrupts (a byte each) or asynchronous transfers.
+    uint32_t rx_bytes;        ///< Bytes read by the node handle.
+    uint32_t rx_frames;       ///< Received frames with correct checksums.
+    uint32_t rx_overflows;    ///< Bytes lost because the receive ring was full.
+    uint32_t checksum_errors; ///< Received frames with a wrong length or message checksum.
+};
+
+class SerialLink : NonCopyable<SerialLink>
+{
+public:
+    /** Link on the rosserial-mbed pins and baudrate. */
+    SerialLink();
+
+    SerialLink(PinName tx, PinName rx, long baud);
+
+    void init();
+
+    /** @return next received byte or -1 */
+    int read();
+
+    /** Queue one frame or drop it if there is no room for all of it. */
+    void write(uint8_t * data, int length);
+
+    /** @return time in milliseconds */
+    unsigned long time();
+
+    long getBaud() const
+    {
+        return _baud;
+    }
+
+    void getStats(SerialLinkStats & stats);
+
+    void resetStats();
+
+private:
+    void onRx();
+#if SERIAL_LINK_ASYNC_TX
+    void startTransfer();
+    void onTransferDone(int event);
+#else
+    void onTxIrq();
+    void onTx();
+#endif
+
+    RawSerial _serial;
+    SpscRing<uint8_t, MBED_CONF_SERIAL_LINK_TX_BUFFER_SIZE> _tx;
+    SpscRing<uint8_t, MBED_CONF_SERIAL_LINK_RX_BUFFER_SIZE> _rx;
+    RosserialFrameParser _parser;
+    SerialLinkStats _stats;
+    uint32_t _rx_overflows_base;
+    long _baud;
+#if SERIAL_LINK_ASYNC_TX
+    volatile uint32_t _tx_chunk; // bytes of the transfer in progress
+#else
+    volatile bool _tx_irq_enabled;
+#endif
+};
+
+#endif /* __SERIAL_LINK_H__ */
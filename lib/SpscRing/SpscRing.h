@@ -0,0 +1,127 @@
+/** @file SpscRing.h
+ * Lock-free single-producer/single-consumer ring of fixed-size records.
+ *
+ * Records are written and read in place: the producer fills the slot returned by
+ * beginWrite() and publishes it with commitWrite(), the consumer reads the slot returned
+ * by peek() and gives it back with release(). Each index is written by one side only, so
+ * no locks or critical sections are needed. When the ring is full new records are dropped
+ * and counted. Blocks of records can be written at once and read in place in contiguous
+ * runs, e.g. as buffers of DMA transfers.
+ */
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <mbed.h>
+
+template <typename T, uint32_t N>
+class SpscRing : NonCopyable<SpscRing<T, N> >
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing()
+    : _head(0)
+    , _tail(0)
+    , _overflows(0)
+    {}
+
+    /**
+     * @brief Get the slot for the next record (producer).
+     * @return slot or NULL if the ring is full, the dropped record is counted
+     */
+    T * beginWrite()
+    {
+        if (_head - _tail == N)
+        {
+            _overflows++;
+            return NULL;
+        }
+        return &_buffer[_head & (N - 1)];
+    }
+
+    /** Publish the record filled after beginWrite() (producer). */
+    void commitWrite()
+    {
+        __DMB(); // the record is visible before the index
+        _head++;
+    }
+
+    /**
+     * @brief Copy a block of records (producer).
+     * @return false if there is no room for all of them, the block is dropped and counted
+     */
+    bool write(const T * records, uint32_t n)
+    {
+        if (N - (_head - _tail) < n)
+        {
+            _overflows++;
+            return false;
+        }
+        uint32_t start = _head & (N - 1);
+        uint32_t first = n < N - start ? n : N - start;
+        memcpy(&_buffer[start], records, first * sizeof(T));
+        memcpy(&_buffer[0], records + first, (n - first) * sizeof(T));
+        __DMB(); // the records are visible before the index
+        _head += n;
+        return true;
+    }
+
+    /**
+     * @brief Get the oldest record (consumer).
+     * @return record or NULL if the ring is empty
+     */
+    T * peek()
+    {
+        if (_head == _tail)
+            return NULL;
+        __DMB(); // the record is read after the index
+        return &_buffer[_tail & (N - 1)];
+    }
+
+    /**
+     * @brief Get the oldest records that lie contiguously in the buffer (consumer).
+     * @param first set to the oldest record
+     * @return number of records, 0 if the ring is empty
+     */
+    uint32_t peekContiguous(T *& first)
+    {
+        uint32_t size = _head - _tail;
+        if (size == 0)
+            return 0;
+        __DMB(); // the records are read after the index
+        uint32_t start = _tail & (N - 1);
+        first = &_buffer[start];
+        return size < N - start ? size : N - start;
+    }
+
+    /** Give back the oldest n records returned by peek() or peekContiguous() (consumer). */
+    void release(uint32_t n = 1)
+    {
+        __DMB(); // the records are read before the slots are reused
+        _tail += n;
+    }
+
+    uint32_t size() const
+    {
+        return _head - _tail;
+    }
+
+    static uint32_t capacity()
+    {
+        return N;
+    }
+
+    /** Number of records and blocks dropped because the ring was full. */
+    uint32_t overflows() const
+    {
+        return _overflows;
+    }
+
+private:
+    T _buffer[N];
+    volatile uint32_t _head;      // written by the producer only
+    volatile uint32_t _tail;      // written by the consumer only
+    volatile uint32_t _overflows; // written by the producer only
+};
+
+#endif /* __SPSC_RING_H__ */
@@ -0,0 +1,141 @@
+#include "TaskScheduler.h"
+
+TaskScheduler::TaskScheduler()
+: _num_tasks(0)
+{
+    memset(_order, 0, sizeof(_order));
+}
+
+static void clearStats(TaskStats & stats)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TaskScheduler::sortTasks()
+{
+    // insertion sort by period keeps the order of tasks with equal periods
+    for (int i = 0; i < _num_tasks; i++)
+        _order[i] = i;
+    for (int i = 1; i < _num_tasks; i++)
+    {
+        uint8_t k = _order[i];
+        int j = i - 1;
+        for (; j >= 0 && _tasks[_order[j]].period_ms > _tasks[k].period_ms; j--)
+            _order[j + 1] = _order[j];
+        _order[j + 1] = k;
+    }
+}
+
+int TaskScheduler::addTask(const char * name, Callback<void()> task, uint32_t period_ms, uint32_t phase_ms, uint32_t deadline_ms)
+{
+    if (_num_tasks == TASK_SCHEDULER_MAX_TASKS || period_ms == 0)
+        return -1;
+    Task & t = _tasks[_num_tasks];
+    t.name = name;
+    t.fn = task;
+    t.period_ms = period_ms;
+    t.phase_ms = phase_ms;
+    t.deadline_ms = deadline_ms ? deadline_ms : period_ms;
+    t.release_ms = Kernel::get_ms_count() + phase_ms;
+    clearStats(t.stats);
+    _num_tasks++;
+    sortTasks();
+    return _num_tasks - 1;
+}
+
+bool TaskScheduler::setPeriod(int index, uint32_t period_ms)
+{
+    if (index < 0 || index >= _num_tasks || period_ms == 0)
+        return false;
+    Task & t = _tasks[index];
+    if (t.deadline_ms == t.period_ms)
+        t.deadline_ms = period_ms;
+    t.period_ms = period_ms;
+    sortTasks();
+    return true;
+}
+
+uint32_t TaskScheduler::getPeriod(int index)
+{
+    return (index < 0 || index >= _num_tasks) ? 0 : _tasks[index].period_ms;
+}
+
+void TaskScheduler::start()
+{
+    uint64_t now = Kernel::get_ms_count();
+    for (int i = 0; i < _num_tasks; i++)
+        _tasks[i].release_ms = now + _tasks[i].phase_ms;
+}
+
+void TaskScheduler::dispatch()
+{
+    uint64_t now = Kernel::get_ms_count();
+    for (int i = 0; i < _num_tasks; i++)
+    {
+        Task & t = _tasks[_order[i]];
+        if (now < t.release_ms)
+            continue;
+
+        uint32_t latency = (uint32_t)(now - t.release_ms);
+        uint32_t start = us_ticker_read();
+        t.fn();
+        uint32_t exec = us_ticker_read() - start;
+        now = Kernel::get_ms_count();
+
+        t.stats.runs++;
+        if (latency > t.stats.max_latency_ms)
+            t.stats.max_latency_ms = latency;
+        if (exec > t.stats.max_exec_us)
+            t.stats.max_exec_us = exec;
+        if (now > t.release_ms + t.deadline_ms)
+            t.stats.overruns++;
+
+        // the releases stay on the absolute grid, a late task runs once and the releases
+        // it missed entirely are dropped instead of being executed in a burst
+        t.release_ms += t.period_ms;
+        while (t.release_ms + t.period_ms <= now)
+        {
+            t.release_ms += t.period_ms;
+            t.stats.skipped++;
+        }
+    }
+
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < _num_tasks; i++)
+    {
+        if (_tasks[i].release_ms < next)
+            next = _tasks[i].release_ms;
+    }
+    if (next > now && next != UINT64_MAX)
+        ThisThread::sleep_until(next);
+}
+
+bool TaskScheduler::getStats(int index, const char *& name, TaskStats & stats)
+{
+    if (index < 0 || index >= _num_tasks)
+        return false;
+    name = _tasks[index].name;
+    stats = _tasks[index].stats;
+    return true;
+}
+
+void TaskScheduler::resetStats()
+{
+    for (int i = 0; i < _num_tasks; i++)
+        clearStats(_tasks[i].stats);
+}
+
+int TaskScheduler::print(char * buffer, size_t size)
+{
+    int len = 0;
+    buffer[0] = 0;
+    for (int i = 0; i < _num_tasks && len < (int)size; i++)
+    {
+        const Task & t = _tasks[_order[i]];
+        len += snprintf(buffer + len, size - len, "%s %lu %lu %lu %lu %lu %lu\n", t.name,
+                        (unsigned long)t.period_ms, (unsigned long)t.stats.runs, (unsigned long)t.stats.skipped,
+                        (unsigned long)t.stats.overruns, (unsigned long)t.stats.max_latency_ms,
+                        (unsigned long)t.stats.max_exec_us);
+    }
+    return len < (int)size ? len : (int)size - 1;
+}
@@ -0,0 +1,87 @@
+/** @file TaskScheduler.h
+ * Cooperative rate-monotonic scheduler of periodic tasks.
+ *
+ * Tasks are released on an absolute schedule (phase + k * period), so the periods do not
+ * stretch with the execution time. Released tasks run in rate-monotonic order (shorter
+ * period first); between releases the calling thread sleeps.
+ */
+#ifndef __TASK_SCHEDULER_H__
+#define __TASK_SCHEDULER_H__
+
+#include <mbed.h>
+
+#define TASK_SCHEDULER_MAX_TASKS 16 /**< Size of the static task table, the firmware uses 12.*/
+
+/**
+ * @brief Execution statistics of a periodic task.
+ */
+struct TaskStats
+{
+    uint32_t runs;           ///< Number of executions.
+    uint32_t skipped;        ///< Releases dropped because the task was late by more than its period.
+    uint32_t overruns;       ///< Executions finished after the deadline.
+    uint32_t max_latency_ms; ///< Longest delay between the release and the start of the task.
+    uint32_t max_exec_us;    ///< Longest execution time.
+};
+
+class TaskScheduler : NonCopyable<TaskScheduler>
+{
+public:
+    TaskScheduler();
+
+    /**
+     * @brief Add periodic task.
+     * @param name task name
+     * @param task task function
+     * @param period_ms release period
+     * @param phase_ms offset of the first release from start()
+     * @param deadline_ms relative deadline, 0 - equal to the period
+     * @return task index or -1 if the table is full
+     */
+    int addTask(const char * name, Callback<void()> task, uint32_t period_ms, uint32_t phase_ms = 0, uint32_t deadline_ms = 0);
+
+    /** Change the period of a task. The next release is kept. */
+    bool setPeriod(int index, uint32_t period_ms);
+
+    uint32_t getPeriod(int index);
+
+    /** Set the first releases of all tasks relative to the current time. */
+    void start();
+
+    /** Run all released tasks and sleep until the next release. */
+    void dispatch();
+
+    /**
+     * @brief Copy statistics of a task.
+     * @return false if there is no task with the index
+     */
+    bool getStats(int index, const char *& name, TaskStats & stats);
+
+    void resetStats();
+
+    /**
+     * @brief Print "name period runs skipped overruns max_latency_ms max_exec_us" line per task.
+     * @return number of printed characters
+     */
+    int print(char * buffer, size_t size);
+
+private:
+    struct Task
+    {
+        const char * name;
+        Callback<void()> fn;
+        uint32_t period_ms;
+        uint32_t phase_ms;
+        uint32_t deadline_ms;
+        uint64_t release_ms;
+        TaskStats stats;
+    };
+
+    void sortTasks();
+
+    Task _tasks[TASK_SCHEDULER_MAX_TASKS];
+    uint8_t _order[TASK_SCHEDULER_MAX_TASKS]; // task indices in rate-monotonic order
+    int _num_tasks;
+};
+
+#endif /* __TASK_SCHEDULER_H__ */
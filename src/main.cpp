@@ -17,9 +17,15 @@
 #include <sensor_msgs/BatteryState.h>
 #include <sensor_msgs/Range.h>
 #include "tf/tf.h"
-#include "tf/transform_broadcaster.h"
+#include "tf/tfMessage.h"
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <std_msgs/UInt8.h>
 #include <rosbot_ekf/Configuration.h>
+#include <rosbot_ekf/Telemetry.h>
+#include <Profiler.h>
+#include <TaskScheduler.h>
+#include <SerialLink.h>
+#include <RosserialMessageSize.h>
 #include <map>
 #include <string>
 
@@ -53,7 +59,21 @@ ROSBOT_FW_VERSION
     }
 #endif
 
-#define MAIN_LOOP_INTERVAL_MS 10
+// main loop task periods [ms]
+#define SPIN_PERIOD_MS 10
+#define WATCHDOG_PERIOD_MS 10
+#define RANGE_PERIOD_MS 10
+#define IMU_PERIOD_MS 10
+#define STATUS_PERIOD_MS 10
+#define ODOMETRY_PERIOD_MS 20
+#define POSE_PERIOD_MS 50
+#define BATTERY_PERIOD_MS 400
+#define LINK_PERIOD_MS 1000
+
+#define LINK_BUDGET_PERCENT 80      // share of the serial link available to the published topics
+#define ROSSERIAL_FRAME_OVERHEAD 8  // sync, protocol, length, length checksum, topic id, checksum
+#define TOPIC_RATE_MAX_HZ (1000.0f / SPIN_PERIOD_MS)
+#define DUTY_CYCLE_MAX 0.80f        // highest duty cycle the wheels are driven with (regulator out_max, ATUN levels)
 
 geometry_msgs::Twist current_vel;
 sensor_msgs::JointState joint_states;
@@ -62,7 +82,10 @@ sensor_msgs::Range range_msg[4];
 geometry_msgs::PoseStamped pose;
 std_msgs::UInt8 button_msg;
 rosbot_ekf::Imu imu_msg;
-ros::NodeHandle nh;
+rosbot_ekf::Telemetry telemetry_msg;
+/// node handle on the instrumented serial link, buffer sizes as in ros::NodeHandle
+typedef ros::NodeHandle_<SerialLink, 25, 25, 512, 512> RosbotNodeHandle;
+RosbotNodeHandle nh;
 ros::Publisher *vel_pub;
 ros::Publisher *joint_state_pub;
 ros::Publisher *battery_pub;
@@ -70,14 +93,20 @@ ros::Publisher *range_pub[4];
 ros::Publisher *pose_pub;
 ros::Publisher *button_pub;
 ros::Publisher *imu_pub;
+ros::Publisher *telemetry_pub = NULL;
 geometry_msgs::TransformStamped robot_tf;
-tf::TransformBroadcaster broadcaster;
+tf::tfMessage tf_msg;
+ros::Publisher *tf_pub = NULL;
+diagnostic_msgs::DiagnosticArray diagnostics_msg;
+diagnostic_msgs::DiagnosticStatus link_status;
+ros::Publisher *diagnostics_pub;
 
 rosbot_kinematics::RosbotOdometry odometry;
 
 volatile bool distance_sensors_enabled = false;
 volatile bool joint_states_enabled = false;
 volatile bool tf_msgs_enabled = false;
+volatile bool telemetry_enabled = false;
 
 DigitalOut sens_power(SENS_POWER_ON,0);
 
@@ -97,6 +126,29 @@ volatile uint32_t last_speed_command_time=0;
 
 rosbot_sensors::ServoManger servo_manager;
 
+static TaskScheduler main_scheduler;
+
+/// time from the IMU data ready interrupt to the publication of the sample
+static struct
+{
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} imu_latency = {0, UINT32_MAX, 0, 0};
+
+/// node handle events and byte rates of the serial link, the transfer counters are kept by SerialLink
+static struct
+{
+    uint32_t spin_timeouts;
+    uint32_t resyncs;     ///< topic negotiations requested by the host
+    uint32_t disconnects;
+    uint32_t tx_bytes_per_s;
+    uint32_t rx_bytes_per_s;
+} link_stats = {0, 0, 0, 0, 0};
+static bool distance_sensors_init_flag = false;
+static bool imu_init_flag = false;
+
 static void button1Callback()
 {
     button1_publish_flag = true;
@@ -129,6 +181,31 @@ static void initButtonPublisher()
     nh.advertise(*button_pub);
 }
 
+#define LINK_STATUS_VALUES 12
+#define LINK_STATUS_VALUE_SIZE 12 // longest value is 11 digits, the message then fits in the node handle output buffer
+
+static void initDiagnosticsPublisher()
+{
+    static diagnostic_msgs::KeyValue values[LINK_STATUS_VALUES];
+    static const char * keys[LINK_STATUS_VALUES] = {"tx_bytes_per_s", "rx_bytes_per_s", "tx_frames", "tx_dropped", "tx_peak",
+        "tx_chunks", "rx_frames", "rx_overflows", "checksum_errors", "spin_timeouts", "resyncs", "disconnects"};
+    static char strings[LINK_STATUS_VALUES][LINK_STATUS_VALUE_SIZE];
+    for(int i=0; i<LINK_STATUS_VALUES; i++)
+    {
+        values[i].key = keys[i];
+        values[i].value = strings[i];
+    }
+    link_status.name = "rosbot: serial link";
+    link_status.hardware_id = "CORE2";
+    link_status.message = "OK";
+    link_status.values_length = LINK_STATUS_VALUES;
+    link_status.values = values;
+    diagnostics_msg.status_length = 1;
+    diagnostics_msg.status = &link_status;
+    diagnostics_pub = new ros::Publisher("diagnostics", &diagnostics_msg);
+    nh.advertise(*diagnostics_pub);
+}
+
 static void initRangePublisher()
 {
     for(int i=0;i<4;i++)
@@ -176,7 +253,21 @@ static void initTfPublisher()
 	robot_tf.transform.rotation.y = 0.0;
 	robot_tf.transform.rotation.z = 0.0;
 	robot_tf.transform.rotation.w = 1.0;
-	broadcaster.init(nh);
+	tf_msg.transforms_length = 1;
+	tf_msg.transforms = &robot_tf;
+	if(tf_pub == NULL)
+	{
+		tf_pub = new ros::Publisher("/tf", &tf_msg);
+		nh.advertise(*tf_pub);
+	}
+}
+
+static void initTelemetryPublisher()
+{
+    if(telemetry_pub != NULL)
+        return;
+    telemetry_pub = new ros::Publisher("telemetry", &telemetry_msg);
+    nh.advertise(*telemetry_pub);
 }
 
 static void initVelocityPublisher()
@@ -211,6 +302,147 @@ static void initJointStatePublisher()
     // joint_states.effort_length = 4;
 }
 
+enum Topic
+{
+    TOPIC_POSE = 0,
+    TOPIC_TF,
+    TOPIC_JOINTS,
+    TOPIC_IMU,
+    TOPIC_RANGE,
+    TOPIC_BATTERY,
+    TOPIC_TELEMETRY,
+    TOPIC_DIAGNOSTICS,
+    NUM_TOPICS
+};
+
+/// publication rate of a topic, 0 disables the publication
+struct TopicRate
+{
+    const char * name;
+    float rate_hz;
+    float min_hz;
+    float max_hz;
+    int task; ///< main loop task publishing the topic at its rate, -1 - the publication is throttled
+};
+
+static TopicRate topic_rates[NUM_TOPICS] = {
+    {"pose", 1000.0f / POSE_PERIOD_MS, 1000.0f / 10000, TOPIC_RATE_MAX_HZ, -1},
+    {"tf", 1000.0f / POSE_PERIOD_MS, 1000.0f / 10000, TOPIC_RATE_MAX_HZ, -1},
+    {"joints", 1000.0f / POSE_PERIOD_MS, 1000.0f / 10000, TOPIC_RATE_MAX_HZ, -1},
+    {"imu", FIFO_SAMPLE_RATE_OPERATION, FIFO_SAMPLE_RATE_MIN, FIFO_SAMPLE_RATE_MAX, -1},
+    {"range", TOPIC_RATE_MAX_HZ, 0.1f, TOPIC_RATE_MAX_HZ, -1},
+    {"battery", 1000.0f / BATTERY_PERIOD_MS, 1000.0f / BATTERY_PERIOD_MS / 100, 1000.0f / BATTERY_PERIOD_MS, -1},
+    {"telemetry", 1000.0f / POSE_PERIOD_MS, 1000.0f / 10000, TOPIC_RATE_MAX_HZ, -1},
+    {"diagnostics", 1000.0f / LINK_PERIOD_MS, 1000.0f / 10000, 10.0f, -1},
+};
+static int odometry_task = -1;
+static uint64_t range_publish_ms[NUM_DISTANCE_SENSORS] = {0};
+
+/// bytes of one publication of the topic, with rosserial framing
+static uint32_t topicBytes(int topic)
+{
+    switch(topic)
+    {
+        case TOPIC_POSE: return rosserial_size::poseStamped(pose) + rosserial_size::twist(current_vel) + 2 * ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_TF: return rosserial_size::tfMessage(tf_msg) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_JOINTS: return rosserial_size::jointState(joint_states) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_IMU: return rosserial_size::imu(imu_msg) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_RANGE: return rosserial_size::range(range_msg[0]) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_BATTERY: return rosserial_size::batteryState(battery_state) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_TELEMETRY: return rosserial_size::telemetry(telemetry_msg) + ROSSERIAL_FRAME_OVERHEAD;
+        case TOPIC_DIAGNOSTICS: return rosserial_size::diagnosticArray(diagnostics_msg) + ROSSERIAL_FRAME_OVERHEAD;
+        default: return 0;
+    }
+}
+
+/// publications per second of the topic with the given rates and the current enable flags
+static float topicPublications(int topic, const float * rates)
+{
+    if(rates[topic] == 0.0f)
+        return 0.0f;
+    // telemetry replaces the state topics
+    if(topic == TOPIC_TELEMETRY)
+        return telemetry_enabled ? rates[topic] : 0.0f;
+    if(telemetry_enabled && topic != TOPIC_DIAGNOSTICS)
+        return 0.0f;
+    switch(topic)
+    {
+        case TOPIC_TF: return tf_msgs_enabled ? rates[topic] : 0.0f;
+        case TOPIC_JOINTS: return joint_states_enabled ? rates[topic] : 0.0f;
+        case TOPIC_RANGE:
+        {
+            if(!distance_sensors_enabled)
+                return 0.0f;
+            float sum = 0.0f;
+            for(int i=0; i<NUM_DISTANCE_SENSORS; i++)
+            {
+                DistanceSensorTiming timing;
+                MultiDistanceSensor::getInstance().getTiming(i, timing);
+                sum += min(rates[topic], 1000.0f / timing.period_ms);
+            }
+            return sum;
+        }
+        default: return rates[topic];
+    }
+}
+
+/// estimated byte rate of all published topics
+static uint32_t linkLoad(const float * rates)
+{
+    float load = 0.0f;
+    for(int i=0; i<NUM_TOPICS; i++)
+        load += topicPublications(i, rates) * topicBytes(i);
+    return (uint32_t)load;
+}
+
+/// closest rate the topic can be published at, -1 if out of range
+static float quantizeRate(int topic, float rate_hz)
+{
+    if(rate_hz == 0.0f)
+        return 0.0f;
+    if(rate_hz < topic_rates[topic].min_hz || rate_hz > topic_rates[topic].max_hz)
+        return -1.0f;
+    switch(topic)
+    {
+        case TOPIC_IMU: return (float)(int)rate_hz;
+        case TOPIC_RANGE: return rate_hz;
+        case TOPIC_BATTERY: return topic_rates[topic].max_hz / (int)(topic_rates[topic].max_hz / rate_hz + 0.5f);
+        default: return 1000.0f / (int)(1000.0f / rate_hz + 0.5f);
+    }
+}
+
+static uint32_t linkBudget()
+{
+    return MBED_CONF_ROSSERIAL_MBED_BAUDRATE / 10 * LINK_BUDGET_PERCENT / 100; // 8N1
+}
+
+/**
+ * @brief Apply new publication rates.
+ *
+ * Task driven topics get the period closest to the rate, the odometry is updated at least as
+ * often as the fastest of them. The IMU rate is the DMP FIFO rate.
+ * @return false if the IMU rejected the rate, nothing is changed then
+ */
+static bool setTopicRates(const float * rates)
+{
+    if(rates[TOPIC_IMU] != 0.0f && rates[TOPIC_IMU] != topic_rates[TOPIC_IMU].rate_hz &&
+       !rosbot_sensors::setImuRate((int)rates[TOPIC_IMU]))
+        return false;
+    uint32_t odometry_period = ODOMETRY_PERIOD_MS;
+    for(int i=0; i<NUM_TOPICS; i++)
+    {
+        topic_rates[i].rate_hz = rates[i];
+        if(topic_rates[i].task < 0 || rates[i] == 0.0f)
+            continue;
+        uint32_t period = (uint32_t)(1000.0f / rates[i] + 0.5f);
+        main_scheduler.setPeriod(topic_rates[i].task, period);
+        if(i != TOPIC_DIAGNOSTICS)
+            odometry_period = min(odometry_period, period);
+    }
+    main_scheduler.setPeriod(odometry_task, odometry_period);
+    return true;
+}
+
 static void velocityCallback(const geometry_msgs::Twist &twist_msg)
 {
     RosbotDrive & drive = RosbotDrive::getInstance();
@@ -322,11 +554,11 @@ static bool servoCommandParser(const char * command)
 
 static bool pidCommandParser(const char * command)
 {
-    char buffer[64], key[10];
+    char buffer[128], key[10];
     float value = 8.0f;
-    if(command == nullptr || strlen(command) == 0)
+    if(command == nullptr || strlen(command) == 0 || strlen(command) >= sizeof(buffer))
         return false;
-    strncpy(buffer,command, 64);
+    strncpy(buffer,command, sizeof(buffer));
     char * token = strtok(buffer, " ");
 
     // servo configuration data
@@ -337,6 +569,13 @@ static bool pidCommandParser(const char * command)
     float out_min = -2.0f;
     float speed_max = -1.0f;
     float a_max = -1.0f;
+    float dt_us = -1.0f;
+    int type = -1;
+    float kv = -1.0f;
+    float ks = -1.0f;
+    float ka = -1.0f;
+    float kt = -1.0f;
+    float tf = -1.0f;
 
     // parsing commands
     while(token != NULL)
@@ -368,7 +607,7 @@ static bool pidCommandParser(const char * command)
         else if(strcmp("out_max", key) == 0)
         {
             if(sscanf(token,"out_max:%f", &value) == 1)
-                out_max = min<float>(value,0.80f);
+                out_max = min<float>(value,DUTY_CYCLE_MAX);
             else
                 return false;
         }
@@ -393,6 +632,53 @@ static bool pidCommandParser(const char * command)
             else
                 return false;
         }
+        else if(strcmp("dt_us", key) == 0)
+        {
+            if(sscanf(token,"dt_us:%f", &value) == 1 && value > 0.0f)
+                dt_us = value;
+            else
+                return false;
+        }
+        else if(strcmp("type", key) == 0)
+        {
+            if(sscanf(token,"type:%d", &type) != 1 || (type != REGULATOR_INCREMENTAL && type != REGULATOR_FEEDFORWARD))
+                return false;
+        }
+        else if(strcmp("kv", key) == 0)
+        {
+            if(sscanf(token,"kv:%f", &value) == 1 && value >= 0.0f)
+                kv = value;
+            else
+                return false;
+        }
+        else if(strcmp("ks", key) == 0)
+        {
+            if(sscanf(token,"ks:%f", &value) == 1 && value >= 0.0f)
+                ks = min<float>(value,0.80f);
+            else
+                return false;
+        }
+        else if(strcmp("ka", key) == 0)
+        {
+            if(sscanf(token,"ka:%f", &value) == 1 && value >= 0.0f)
+                ka = value;
+            else
+                return false;
+        }
+        else if(strcmp("kt", key) == 0)
+        {
+            if(sscanf(token,"kt:%f", &value) == 1 && value >= 0.0f)
+                kt = value;
+            else
+                return false;
+        }
+        else if(strcmp("tf", key) == 0)
+        {
+            if(sscanf(token,"tf:%f", &value) == 1 && value >= 0.0f)
+                tf = value;
+            else
+                return false;
+        }
         else
         {
             return false;
@@ -439,6 +725,41 @@ static bool pidCommandParser(const char * command)
         params.speed_max = speed_max;
     }
 
+    if(dt_us != -1.0f)
+    {
+        params.dt_us = (uint32_t)dt_us;
+    }
+
+    if(type != -1)
+    {
+        params.type = (uint8_t)type;
+    }
+
+    if(kv != -1.0f)
+    {
+        params.kv = kv;
+    }
+
+    if(ks != -1.0f)
+    {
+        params.ks = ks;
+    }
+
+    if(ka != -1.0f)
+    {
+        params.ka = ka;
+    }
+
+    if(kt != -1.0f)
+    {
+        params.kt = kt;
+    }
+
+    if(tf != -1.0f)
+    {
+        params.tf = tf;
+    }
+
     RosbotDrive::getInstance().updatePidParams(params);
     return true;
 }
@@ -465,6 +786,22 @@ public:
     uint8_t configureServo(const char *datain, const char **dataout);
     uint8_t getPid(const char *datain, const char **dataout);
     uint8_t configurePid(const char *datain, const char **dataout);
+    uint8_t getProfile(const char *datain, const char **dataout);
+    uint8_t getSchedule(const char *datain, const char **dataout);
+    uint8_t configureImu(const char *datain, const char **dataout);
+    uint8_t getImu(const char *datain, const char **dataout);
+    uint8_t configureDistanceSensor(const char *datain, const char **dataout);
+    uint8_t getDistanceSensors(const char *datain, const char **dataout);
+    uint8_t configureDistanceSensorFilter(const char *datain, const char **dataout);
+    uint8_t enableTelemetry(const char *datain, const char **dataout);
+    uint8_t configureRates(const char *datain, const char **dataout);
+    uint8_t getRates(const char *datain, const char **dataout);
+    uint8_t getLink(const char *datain, const char **dataout);
+    uint8_t enableHeadingFusion(const char *datain, const char **dataout);
+    uint8_t configureTraction(const char *datain, const char **dataout);
+    uint8_t getTraction(const char *datain, const char **dataout);
+    uint8_t autotunePid(const char *datain, const char **dataout);
+    uint8_t enableVelocityProfile(const char *datain, const char **dataout);
     
 
 private:
@@ -487,6 +824,22 @@ private:
     static const char GSER_COMMAND[];
     static const char GPID_COMMAND[];
     static const char CPID_COMMAND[];
+    static const char PROF_COMMAND[];
+    static const char SCHD_COMMAND[];
+    static const char CIMU_COMMAND[];
+    static const char GIMU_COMMAND[];
+    static const char CDSE_COMMAND[];
+    static const char GDSE_COMMAND[];
+    static const char CDSF_COMMAND[];
+    static const char ETLM_COMMAND[];
+    static const char CRAT_COMMAND[];
+    static const char GRAT_COMMAND[];
+    static const char GLNK_COMMAND[];
+    static const char EHDG_COMMAND[];
+    static const char CTRC_COMMAND[];
+    static const char GTRC_COMMAND[];
+    static const char ATUN_COMMAND[];
+    static const char EPRF_COMMAND[];
     map<std::string, configuration_srv_fun_t> _commands;
 };
 
@@ -508,6 +861,22 @@ const char ConfigFunctionality::CSER_COMMAND[]="CSER";
 const char ConfigFunctionality::GSER_COMMAND[]="GSER";
 const char ConfigFunctionality::GPID_COMMAND[]="GPID";
 const char ConfigFunctionality::CPID_COMMAND[]="CPID";
+const char ConfigFunctionality::PROF_COMMAND[]="PROF";
+const char ConfigFunctionality::SCHD_COMMAND[]="SCHD";
+const char ConfigFunctionality::CIMU_COMMAND[]="CIMU";
+const char ConfigFunctionality::GIMU_COMMAND[]="GIMU";
+const char ConfigFunctionality::CDSE_COMMAND[]="CDSE";
+const char ConfigFunctionality::GDSE_COMMAND[]="GDSE";
+const char ConfigFunctionality::CDSF_COMMAND[]="CDSF";
+const char ConfigFunctionality::ETLM_COMMAND[]="ETLM";
+const char ConfigFunctionality::CRAT_COMMAND[]="CRAT";
+const char ConfigFunctionality::GRAT_COMMAND[]="GRAT";
+const char ConfigFunctionality::GLNK_COMMAND[]="GLNK";
+const char ConfigFunctionality::EHDG_COMMAND[]="EHDG";
+const char ConfigFunctionality::CTRC_COMMAND[]="CTRC";
+const char ConfigFunctionality::GTRC_COMMAND[]="GTRC";
+const char ConfigFunctionality::ATUN_COMMAND[]="ATUN";
+const char ConfigFunctionality::EPRF_COMMAND[]="EPRF";
 
 
 ConfigFunctionality::ConfigFunctionality()
@@ -526,6 +895,22 @@ ConfigFunctionality::ConfigFunctionality()
     _commands[CSER_COMMAND] = &ConfigFunctionality::configureServo;
     _commands[GPID_COMMAND] = &ConfigFunctionality::getPid;
     _commands[CPID_COMMAND] = &ConfigFunctionality::configurePid;
+    _commands[PROF_COMMAND] = &ConfigFunctionality::getProfile;
+    _commands[SCHD_COMMAND] = &ConfigFunctionality::getSchedule;
+    _commands[CIMU_COMMAND] = &ConfigFunctionality::configureImu;
+    _commands[GIMU_COMMAND] = &ConfigFunctionality::getImu;
+    _commands[CDSE_COMMAND] = &ConfigFunctionality::configureDistanceSensor;
+    _commands[GDSE_COMMAND] = &ConfigFunctionality::getDistanceSensors;
+    _commands[CDSF_COMMAND] = &ConfigFunctionality::configureDistanceSensorFilter;
+    _commands[ETLM_COMMAND] = &ConfigFunctionality::enableTelemetry;
+    _commands[CRAT_COMMAND] = &ConfigFunctionality::configureRates;
+    _commands[GRAT_COMMAND] = &ConfigFunctionality::getRates;
+    _commands[GLNK_COMMAND] = &ConfigFunctionality::getLink;
+    _commands[EHDG_COMMAND] = &ConfigFunctionality::enableHeadingFusion;
+    _commands[CTRC_COMMAND] = &ConfigFunctionality::configureTraction;
+    _commands[GTRC_COMMAND] = &ConfigFunctionality::getTraction;
+    _commands[ATUN_COMMAND] = &ConfigFunctionality::autotunePid;
+    _commands[EPRF_COMMAND] = &ConfigFunctionality::enableVelocityProfile;
 }
 
 uint8_t ConfigFunctionality::enableTfMessages(const char *datain, const char **dataout)
@@ -550,14 +935,345 @@ uint8_t ConfigFunctionality::configurePid(const char *datain, const char **datao
 
 uint8_t ConfigFunctionality::getPid(const char *datain, const char **dataout)
 {
+    static char buffer[256];
     RosbotRegulator_params params;
     RosbotDrive::getInstance().getPidParams(params);
-    sprintf(this->_buffer,"%kp:%.3f ki:%.3f kd:%.3f out_max:%.3f out_min:%.3f a_max:%.3e speed_max: %.3f", 
-    params.kp, params.ki, params.kd, params.out_max, params.out_min, params.a_max, params.speed_max);
-    *dataout = this->_buffer;
+    snprintf(buffer, sizeof(buffer), "kp:%.3f ki:%.3f kd:%.3f out_max:%.3f out_min:%.3f a_max:%.3e speed_max: %.3f dt_us:%lu "
+    "type:%d kv:%.3f ks:%.3f ka:%.3f kt:%.3f tf:%.3f",
+    params.kp, params.ki, params.kd, params.out_max, params.out_min, params.a_max, params.speed_max, (unsigned long)params.dt_us,
+    params.type, params.kv, params.ks, params.ka, params.kt, params.tf);
+    *dataout = buffer;
     return rosbot_ekf::Configuration::Response::SUCCESS; 
 }
 
+uint8_t ConfigFunctionality::autotunePid(const char *datain, const char **dataout)
+{
+    static const char * states[] = {"idle", "running", "done", "failed"};
+    static char buffer[512];
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    if(strncmp(datain, "start", 5) == 0)
+    {
+        MotorTunerParams params = MotorTuner::DEFAULT_PARAMS;
+        unsigned long level_ms = params.level_us / 1000;
+        int n = sscanf(datain + 5,"%f %f %lu %f", &params.duty_low, &params.duty_high, &level_ms, &params.tc);
+        if(n != EOF && n != 4)
+            return rosbot_ekf::Configuration::Response::FAILURE;
+        if(params.duty_low <= 0.0f || params.duty_high <= params.duty_low || params.duty_high > DUTY_CYCLE_MAX || level_ms < 100 || params.tc < 0.0f)
+            return rosbot_ekf::Configuration::Response::FAILURE;
+        params.level_us = level_ms * 1000;
+        return drive.startTuning(params) ? rosbot_ekf::Configuration::Response::SUCCESS : rosbot_ekf::Configuration::Response::FAILURE;
+    }
+    if(strcmp(datain, "stop") == 0)
+    {
+        drive.stopTuning();
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    if(strcmp(datain, "apply") == 0)
+        return drive.applyTuning() ? rosbot_ekf::Configuration::Response::SUCCESS : rosbot_ekf::Configuration::Response::FAILURE;
+    if(strlen(datain))
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    MotorTunerResult result;
+    MotorTunerState state = drive.getTuningResult(result);
+    int len = snprintf(buffer, sizeof(buffer), "state:%s\n", states[state]);
+    for(int i=0; i<4; i++)
+    {
+        const MotorModel & m = result.wheel[i];
+        len += snprintf(buffer + len, sizeof(buffer) - len, "MOTOR%d valid:%d gain:%.3f offset:%.3f time_constant:%.4f dead_time:%.4f\n",
+            i + 1, m.valid ? 1 : 0, m.gain, m.offset, m.time_constant, m.dead_time);
+    }
+    if(result.model.valid)
+        snprintf(buffer + len, sizeof(buffer) - len, "kp:%.3f ki:%.3f kd:0.000 kv:%.3f ks:%.3f ka:%.3f", result.kp, result.ki, result.kv, result.ks, result.ka);
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::getProfile(const char *datain, const char **dataout)
+{
+#if MBED_CONF_PROFILER_ENABLED
+    static char buffer[384];
+    if(strcmp(datain, "reset") == 0)
+    {
+        Profiler::reset();
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    if(Profiler::print(buffer, sizeof(buffer), strlen(datain) ? datain : NULL) < 0)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+#else
+    return rosbot_ekf::Configuration::Response::FAILURE;
+#endif
+}
+
+uint8_t ConfigFunctionality::getSchedule(const char *datain, const char **dataout)
+{
+    static char buffer[384];
+    if(strcmp(datain, "reset") == 0)
+    {
+        main_scheduler.resetStats();
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    if(strlen(datain))
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    main_scheduler.print(buffer, sizeof(buffer));
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::configureImu(const char *datain, const char **dataout)
+{
+    int rate;
+    if(sscanf(datain,"rate:%d",&rate) != 1 || rate == 0)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    char request[24];
+    snprintf(request, sizeof(request), "imu %d", rate);
+    return configureRates(request, dataout);
+}
+
+uint8_t ConfigFunctionality::getImu(const char *datain, const char **dataout)
+{
+    if(strcmp(datain, "reset") == 0)
+    {
+        imu_latency.count = 0;
+        imu_latency.min_us = UINT32_MAX;
+        imu_latency.max_us = 0;
+        imu_latency.sum_us = 0;
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    snprintf(this->_buffer, sizeof(this->_buffer), "rate:%d samples:%lu overflows:%lu latency_us min:%lu mean:%lu max:%lu",
+        rosbot_sensors::getImuRate(), (unsigned long)imu_latency.count, (unsigned long)rosbot_sensors::imu_ring.overflows(),
+        (unsigned long)(imu_latency.count ? imu_latency.min_us : 0),
+        (unsigned long)(imu_latency.count ? imu_latency.sum_us / imu_latency.count : 0), (unsigned long)imu_latency.max_us);
+    *dataout = this->_buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::configureDistanceSensor(const char *datain, const char **dataout)
+{
+    int sensor;
+    unsigned long budget, period;
+    if(sscanf(datain,"%d %lu %lu", &sensor, &budget, &period) != 3 || budget == 0 || period < budget)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    DistanceSensorTiming timing = {budget, period};
+    // the sensors thread restarts only this sensor with the new timing
+    if(!MultiDistanceSensor::getInstance().setTiming(sensor, timing))
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::getDistanceSensors(const char *datain, const char **dataout)
+{
+    static char buffer[512];
+    MultiDistanceSensor & distance_sensors = MultiDistanceSensor::getInstance();
+    int len = 0;
+    for(int i=0; i<NUM_DISTANCE_SENSORS; i++)
+    {
+        DistanceSensorHealth health;
+        DistanceSensorTiming timing;
+        RangeFilterParams filter;
+        distance_sensors.getHealth(i, health);
+        distance_sensors.getTiming(i, timing);
+        distance_sensors.getFilter(i, filter);
+        len += snprintf(buffer + len, sizeof(buffer) - len, "%s %d %lu %lu errors:%lu restarts:%lu failed:%lu filter:%d %.2f %.2f rejected:%lu\n",
+            range_id[i], health.active ? 1 : 0, (unsigned long)timing.timing_budget_ms, (unsigned long)timing.period_ms,
+            (unsigned long)health.errors, (unsigned long)health.restarts, (unsigned long)health.failed_restarts,
+            filter.window, filter.max_rate, filter.min_confidence, (unsigned long)health.rejected);
+    }
+    snprintf(buffer + len, sizeof(buffer) - len, "bus_recoveries:%lu", (unsigned long)distance_sensors.getBusRecoveries());
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::configureDistanceSensorFilter(const char *datain, const char **dataout)
+{
+    int sensor, window;
+    float max_rate, min_confidence;
+    if(sscanf(datain,"%d %d %f %f", &sensor, &window, &max_rate, &min_confidence) != 4)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    if(window < 1 || window > RANGE_FILTER_MAX_WINDOW || max_rate < 0.0f || min_confidence < 0.0f || min_confidence > 1.0f)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    RangeFilterParams params = {(uint8_t)window, max_rate, min_confidence};
+    return MultiDistanceSensor::getInstance().setFilter(sensor, params) ? 
+        rosbot_ekf::Configuration::Response::SUCCESS : rosbot_ekf::Configuration::Response::FAILURE;
+}
+
+uint8_t ConfigFunctionality::enableTelemetry(const char *datain, const char **dataout)
+{
+    int en;
+    if(sscanf(datain,"%d",&en) == 1)
+    {
+        if(en)
+        {
+            initTelemetryPublisher();
+            telemetry_msg.updated = 0;
+        }
+        telemetry_enabled = en ? true : false;
+        return rosbot_ekf::Configuration::Response::SUCCESS; 
+    }
+    return rosbot_ekf::Configuration::Response::FAILURE;
+}
+
+uint8_t ConfigFunctionality::configureRates(const char *datain, const char **dataout)
+{
+    float rates[NUM_TOPICS];
+    for(int i=0; i<NUM_TOPICS; i++)
+        rates[i] = topic_rates[i].rate_hz;
+
+    // "topic rate" pairs, all of them are applied or none
+    char name[16];
+    float rate_hz;
+    int n, pairs = 0;
+    while(sscanf(datain, "%15s %f%n", name, &rate_hz, &n) == 2)
+    {
+        int topic = 0;
+        while(topic < NUM_TOPICS && strcmp(name, topic_rates[topic].name) != 0)
+            topic++;
+        if(topic == NUM_TOPICS || (rates[topic] = quantizeRate(topic, rate_hz)) < 0.0f)
+            return rosbot_ekf::Configuration::Response::FAILURE;
+        datain += n;
+        pairs++;
+    }
+    if(pairs == 0)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+
+    uint32_t load = linkLoad(rates);
+    if(load > linkBudget())
+    {
+        snprintf(this->_buffer, sizeof(this->_buffer), "load:%lu exceeds budget:%lu", (unsigned long)load, (unsigned long)linkBudget());
+        *dataout = this->_buffer;
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    }
+    return setTopicRates(rates) ? rosbot_ekf::Configuration::Response::SUCCESS : rosbot_ekf::Configuration::Response::FAILURE;
+}
+
+uint8_t ConfigFunctionality::getRates(const char *datain, const char **dataout)
+{
+    static char buffer[320];
+    float rates[NUM_TOPICS];
+    for(int i=0; i<NUM_TOPICS; i++)
+        rates[i] = topic_rates[i].rate_hz;
+    int len = 0;
+    for(int i=0; i<NUM_TOPICS && len < (int)sizeof(buffer); i++)
+    {
+        len += snprintf(buffer + len, sizeof(buffer) - len, "%s %.2f %luB %luB/s\n", topic_rates[i].name, rates[i],
+            (unsigned long)topicBytes(i), (unsigned long)(topicPublications(i, rates) * topicBytes(i)));
+    }
+    if(len < (int)sizeof(buffer))
+        snprintf(buffer + len, sizeof(buffer) - len, "load:%lu budget:%lu", (unsigned long)linkLoad(rates), (unsigned long)linkBudget());
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::getLink(const char *datain, const char **dataout)
+{
+    static char buffer[320];
+    SerialLink * link = nh.getHardware();
+    if(strcmp(datain, "reset") == 0)
+    {
+        link->resetStats();
+        link_stats.spin_timeouts = 0;
+        link_stats.resyncs = 0;
+        link_stats.disconnects = 0;
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    SerialLinkStats stats;
+    link->getStats(stats);
+    snprintf(buffer, sizeof(buffer), "baud:%ld tx_bytes_per_s:%lu rx_bytes_per_s:%lu tx_frames:%lu tx_dropped:%lu tx_peak:%lu/%d "
+        "tx_chunks:%lu rx_frames:%lu rx_overflows:%lu checksum_errors:%lu spin_timeouts:%lu resyncs:%lu disconnects:%lu",
+        link->getBaud(), (unsigned long)link_stats.tx_bytes_per_s, (unsigned long)link_stats.rx_bytes_per_s,
+        (unsigned long)stats.tx_frames, (unsigned long)stats.tx_dropped, (unsigned long)stats.tx_peak, MBED_CONF_SERIAL_LINK_TX_BUFFER_SIZE,
+        (unsigned long)stats.tx_chunks, (unsigned long)stats.rx_frames, (unsigned long)stats.rx_overflows, (unsigned long)stats.checksum_errors,
+        (unsigned long)link_stats.spin_timeouts, (unsigned long)link_stats.resyncs, (unsigned long)link_stats.disconnects);
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::enableHeadingFusion(const char *datain, const char **dataout)
+{
+    int en;
+    HeadingFilterParams params;
+    odometry.heading.getParams(params);
+    int n = sscanf(datain,"%d %f %f %f", &en, &params.time_constant, &params.bias_time_constant, &params.slip_rate);
+    if(n != 1 && n != 4)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    if(params.time_constant < 0.0f || params.bias_time_constant < 0.0f || params.slip_rate < 0.0f)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    odometry.heading.setParams(params);
+    rosbot_kinematics::enableRosbotHeadingFusion(odometry, en != 0);
+    snprintf(_buffer, sizeof(_buffer), "yaw:%.4f bias:%.5f slipping:%d",
+        odometry.heading.getYaw(), odometry.heading.getBias(), odometry.heading.isSlipping() ? 1 : 0);
+    *dataout = _buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::enableVelocityProfile(const char *datain, const char **dataout)
+{
+    int en;
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    DriveProfileParams params;
+    drive.getProfileParams(params);
+    VelocityLimits & limits = params.limits;
+    int n = sscanf(datain,"%d %f %f %f %f", &en, &limits.linear_acc, &limits.linear_jerk, &limits.angular_acc, &limits.angular_jerk);
+    if(n != 1 && n != 5)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    if(limits.linear_acc < 0.0f || limits.linear_jerk < 0.0f || limits.angular_acc < 0.0f || limits.angular_jerk < 0.0f)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    rosbot_kinematics::enableRosbotProfile(drive, en != 0, limits);
+    snprintf(_buffer, sizeof(_buffer), "enabled:%d linear_acc:%.2f linear_jerk:%.2f angular_acc:%.2f angular_jerk:%.2f",
+        drive.isProfileEnabled() ? 1 : 0, limits.linear_acc, limits.linear_jerk, limits.angular_acc, limits.angular_jerk);
+    *dataout = _buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::configureTraction(const char *datain, const char **dataout)
+{
+    float slip_ratio, stall_duty, stall_speed;
+    unsigned long slip_ms, stall_ms;
+    int actions;
+    if(sscanf(datain,"%f %f %f %lu %lu %d", &slip_ratio, &stall_duty, &stall_speed, &slip_ms, &stall_ms, &actions) != 6)
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    if(slip_ratio < 0.0f || stall_duty < 0.0f || stall_speed < 0.0f || actions < 0 || actions > (TRACTION_LIMIT_SLIP | TRACTION_CUT_STALL))
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    TractionParams params;
+    drive.getTractionParams(params);
+    params.slip_ratio = slip_ratio;
+    params.stall_duty = stall_duty;
+    params.stall_speed = stall_speed;
+    params.slip_detect_us = slip_ms * 1000;
+    params.stall_detect_us = stall_ms * 1000;
+    params.actions = (uint8_t)actions;
+    drive.setTractionParams(params);
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
+uint8_t ConfigFunctionality::getTraction(const char *datain, const char **dataout)
+{
+    static char buffer[512];
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    if(strcmp(datain, "reset") == 0)
+    {
+        drive.resetTractionStats();
+        return rosbot_ekf::Configuration::Response::SUCCESS;
+    }
+    if(strlen(datain))
+        return rosbot_ekf::Configuration::Response::FAILURE;
+    TractionParams params;
+    TractionStats stats;
+    drive.getTractionParams(params);
+    drive.getTractionStats(stats);
+    int len = snprintf(buffer, sizeof(buffer), "%.2f %.2f %.3f %lu %lu %d\n", params.slip_ratio, params.stall_duty, params.stall_speed,
+        (unsigned long)(params.slip_detect_us / 1000), (unsigned long)(params.stall_detect_us / 1000), params.actions);
+    for(int i=0; i<4; i++)
+    {
+        const TractionWheelStats & w = stats.wheel[i];
+        len += snprintf(buffer + len, sizeof(buffer) - len, "MOTOR%d slip:%.2f slipping:%d stalled:%d slip_events:%lu stall_events:%lu slip_time_ms:%lu\n",
+            i + 1, w.slip, w.slipping ? 1 : 0, w.stalled ? 1 : 0, (unsigned long)w.slip_events, (unsigned long)w.stall_events, (unsigned long)w.slip_time_ms);
+    }
+    *dataout = buffer;
+    return rosbot_ekf::Configuration::Response::SUCCESS;
+}
+
 uint8_t ConfigFunctionality::configureServo(const char *datain, const char **dataout)
 {
     return servoCommandParser(datain) ? rosbot_ekf::Configuration::Response::SUCCESS : rosbot_ekf::Configuration::Response::FAILURE;
@@ -572,6 +1288,7 @@ uint8_t ConfigFunctionality::calibrateOdometry(const char *datain, const char **
         rosbot_kinematics::custom_wheel_params.tyre_deflation = tyre_deflation;
         RosbotDrive & drive = RosbotDrive::getInstance();
         drive.updateWheelCoefficients(rosbot_kinematics::custom_wheel_params);
+        rosbot_kinematics::setupRosbotOdometry(drive);
         return rosbot_ekf::Configuration::Response::SUCCESS; 
     }
     return rosbot_ekf::Configuration::Response::FAILURE;
@@ -760,6 +1477,283 @@ void responseCallback(const rosbot_ekf::Configuration::Request & req, rosbot_ekf
     }
 }
 
+static void spinTask()
+{
+    PROFILE_SCOPE("spin");
+    static bool connected = false;
+    int spin_result = nh.spinOnce();
+    if(spin_result == ros::SPIN_TIMEOUT)
+        link_stats.spin_timeouts++;
+    else if(spin_result == ros::SPIN_ERR)
+        link_stats.resyncs++; // the host requested the topics
+    if(connected && !nh.connected())
+        link_stats.disconnects++;
+    connected = nh.connected();
+}
+
+/// serial link byte rates and the diagnostics message
+static void linkTask()
+{
+    static uint64_t last_ms = Kernel::get_ms_count();
+    static SerialLinkStats last = {0};
+    SerialLinkStats stats;
+    nh.getHardware()->getStats(stats);
+    uint64_t now = Kernel::get_ms_count();
+    if(now > last_ms && stats.tx_bytes >= last.tx_bytes && stats.rx_bytes >= last.rx_bytes) // not after a reset
+    {
+        link_stats.tx_bytes_per_s = (uint32_t)((stats.tx_bytes - last.tx_bytes) * 1000ULL / (now - last_ms));
+        link_stats.rx_bytes_per_s = (uint32_t)((stats.rx_bytes - last.rx_bytes) * 1000ULL / (now - last_ms));
+    }
+    bool degraded = stats.tx_dropped > last.tx_dropped || stats.rx_overflows > last.rx_overflows ||
+                    stats.checksum_errors > last.checksum_errors;
+    last_ms = now;
+    last = stats;
+
+    if(topic_rates[TOPIC_DIAGNOSTICS].rate_hz == 0.0f || !nh.connected())
+        return;
+    uint32_t values[LINK_STATUS_VALUES] = {link_stats.tx_bytes_per_s, link_stats.rx_bytes_per_s, stats.tx_frames,
+        stats.tx_dropped, stats.tx_peak, stats.tx_chunks, stats.rx_frames, stats.rx_overflows, stats.checksum_errors,
+        link_stats.spin_timeouts, link_stats.resyncs, link_stats.disconnects};
+    for(int i=0; i<LINK_STATUS_VALUES; i++)
+        snprintf((char*)link_status.values[i].value, LINK_STATUS_VALUE_SIZE, "%lu", (unsigned long)values[i]);
+    link_status.level = degraded ? diagnostic_msgs::DiagnosticStatus::WARN : diagnostic_msgs::DiagnosticStatus::OK;
+    link_status.message = degraded ? "frames lost" : "OK";
+    diagnostics_msg.header.stamp = nh.now();
+    diagnostics_pub->publish(&diagnostics_msg);
+}
+
+static void speedWatchdogTask()
+{
+    if(is_speed_watchdog_enabled)
+    {
+        if(!is_speed_watchdog_active && (odom_watchdog_timer.read_ms() - last_speed_command_time) > speed_watchdog_interval)
+        {
+            rosbot_kinematics::setRosbotSpeed(RosbotDrive::getInstance(), 0.0f, 0.0f);
+            is_speed_watchdog_active = true;
+        }
+    }
+}
+
+static void odometryTask()
+{
+    rosbot_kinematics::updateRosbotOdometry(RosbotDrive::getInstance(),odometry);
+}
+
+/// velocity and pose messages
+static void poseTask()
+{
+    current_vel.linear.x = sqrt(odometry.odom.robot_x_vel * odometry.odom.robot_x_vel + odometry.odom.robot_y_vel * odometry.odom.robot_y_vel);
+    current_vel.angular.z = odometry.odom.robot_angular_vel;
+    pose.pose.position.x = odometry.odom.robot_x_pos;
+    pose.pose.position.y = odometry.odom.robot_y_pos;
+    pose.pose.orientation = tf::createQuaternionFromYaw(odometry.odom.robot_angular_pos);
+    
+    pose.header.stamp = nh.now();
+    if(nh.connected() && !telemetry_enabled && topic_rates[TOPIC_POSE].rate_hz > 0.0f){
+        pose_pub->publish(&pose);
+        vel_pub->publish(&current_vel);
+    }
+}
+
+/// tf message with the current pose
+static void tfTask()
+{
+    if(tf_msgs_enabled && !telemetry_enabled && topic_rates[TOPIC_TF].rate_hz > 0.0f)
+    {
+        robot_tf.header.stamp = nh.now(); 
+        robot_tf.transform.translation.x = odometry.odom.robot_x_pos;
+        robot_tf.transform.translation.y = odometry.odom.robot_y_pos;
+        robot_tf.transform.rotation = tf::createQuaternionFromYaw(odometry.odom.robot_angular_pos);
+        if(nh.connected()) tf_pub->publish(&tf_msg);
+    }
+}
+
+static void jointStatesTask()
+{
+    if(joint_states_enabled && !telemetry_enabled && topic_rates[TOPIC_JOINTS].rate_hz > 0.0f)
+    {
+        pos[0] = odometry.odom.wheel_FL_ang_pos;
+        pos[1] = odometry.odom.wheel_FR_ang_pos;
+        pos[2] = odometry.odom.wheel_RL_ang_pos;
+        pos[3] = odometry.odom.wheel_RR_ang_pos;
+        joint_states.position = pos;
+        joint_states.header.stamp = nh.now(); 
+        if(nh.connected()) joint_state_pub->publish(&joint_states);
+    }
+}
+
+static void batteryTask()
+{
+    static int count = 0;
+    battery_state.voltage = rosbot_sensors::updateBatteryWatchdog();
+    // the watchdog is updated every period, the publication is divided down to the topic rate
+    float rate = topic_rates[TOPIC_BATTERY].rate_hz;
+    if(rate == 0.0f || ++count < (int)(topic_rates[TOPIC_BATTERY].max_hz / rate + 0.5f))
+        return;
+    count = 0;
+    if(nh.connected() && !telemetry_enabled) battery_pub->publish(&battery_state);
+}
+
+/// state of one tick in a single frame, replaces the separate messages when enabled
+static void telemetryTask()
+{
+    if(!telemetry_enabled || topic_rates[TOPIC_TELEMETRY].rate_hz == 0.0f)
+        return;
+    telemetry_msg.stamp = nh.now();
+    telemetry_msg.x = odometry.odom.robot_x_pos;
+    telemetry_msg.y = odometry.odom.robot_y_pos;
+    telemetry_msg.yaw = odometry.odom.robot_angular_pos;
+    telemetry_msg.linear_velocity = sqrt(odometry.odom.robot_x_vel * odometry.odom.robot_x_vel + odometry.odom.robot_y_vel * odometry.odom.robot_y_vel);
+    telemetry_msg.angular_velocity = odometry.odom.robot_angular_vel;
+    telemetry_msg.wheel_position[0] = odometry.odom.wheel_FL_ang_pos;
+    telemetry_msg.wheel_position[1] = odometry.odom.wheel_FR_ang_pos;
+    telemetry_msg.wheel_position[2] = odometry.odom.wheel_RL_ang_pos;
+    telemetry_msg.wheel_position[3] = odometry.odom.wheel_RR_ang_pos;
+    telemetry_msg.battery_mv = (uint16_t)(battery_state.voltage * 1000.0f);
+    if(nh.connected())
+    {
+        telemetry_pub->publish(&telemetry_msg);
+        telemetry_msg.updated = 0;
+    }
+}
+
+/// each sensor's range is published with its own timestamp as soon as it is ready
+static void rangeTask()
+{
+    osEvent evt;
+    while((evt = distance_sensor_mail_box.get(0)).status == osEventMail)
+    {
+        SensorsMeasurement * message = (SensorsMeasurement*)evt.value.p;
+        for(int i=0; i<4; i++)
+        {
+            if(!(message->updated & (1 << i)) || (message->rejected & (1 << i)))
+                continue;
+            if(message->range[i] < 0.0f)
+            {
+                // the failed sensor is restarted by MultiDistanceSensor, the others keep ranging
+                if(nh.connected())
+                {
+                    char buffer[48];
+                    snprintf(buffer, sizeof(buffer), "I2C error. Restarting VL53L0X sensor %s...", range_id[i]);
+                    nh.logerror(buffer);
+                }
+                continue;
+            }
+            if(telemetry_enabled)
+            {
+                telemetry_msg.range_mm[i] = (uint16_t)min(message->range[i] * 1000.0f, 65535.0f);
+                telemetry_msg.updated |= rosbot_ekf::Telemetry::RANGE_UPDATED << i;
+                continue;
+            }
+            // ranges faster than the topic rate are dropped, with half a sensor period of tolerance
+            float rate = topic_rates[TOPIC_RANGE].rate_hz;
+            DistanceSensorTiming timing;
+            MultiDistanceSensor::getInstance().getTiming(i, timing);
+            uint64_t now = Kernel::get_ms_count();
+            if(rate == 0.0f || (now - range_publish_ms[i] + timing.period_ms / 2) * rate < 1000.0f)
+                continue;
+            range_publish_ms[i] = now;
+            range_msg[i].header.stamp = nh.now(message->timestamp[i]);
+            range_msg[i].range = message->range[i];
+            if(nh.connected()) range_pub[i]->publish(&range_msg[i]);
+        }
+        distance_sensor_mail_box.free(message);
+    }
+}
+
+/// IMU records are stamped and serialized in place, straight from the ring
+static void imuTask()
+{
+    static uint32_t reported_overflows = 0;
+    rosbot_sensors::imu_record_t * record;
+    while((record = rosbot_sensors::imu_ring.peek()) != NULL)
+    {
+        // every sample feeds the heading fusion, the gyro is in deg/s
+        rosbot_kinematics::updateRosbotHeading(odometry, record->msg.angular_velocity[2] * (float)(M_PI / 180.0), record->ready_time_us);
+        if(telemetry_enabled)
+        {
+            // only the newest sample goes into the frame
+            telemetry_msg.orientation[0] = record->msg.orientation.x;
+            telemetry_msg.orientation[1] = record->msg.orientation.y;
+            telemetry_msg.orientation[2] = record->msg.orientation.z;
+            telemetry_msg.orientation[3] = record->msg.orientation.w;
+            memcpy(telemetry_msg.gyro, record->msg.angular_velocity, sizeof(telemetry_msg.gyro));
+            memcpy(telemetry_msg.accel, record->msg.linear_acceleration, sizeof(telemetry_msg.accel));
+            telemetry_msg.updated |= rosbot_ekf::Telemetry::IMU_UPDATED;
+            rosbot_sensors::imu_ring.release();
+            continue;
+        }
+        record->msg.header.stamp = nh.now(record->timestamp);
+        if(nh.connected() && topic_rates[TOPIC_IMU].rate_hz > 0.0f)
+        {
+            imu_pub->publish(&record->msg);
+            uint32_t latency_us = us_ticker_read() - record->ready_time_us;
+            imu_latency.count++;
+            imu_latency.sum_us += latency_us;
+            imu_latency.min_us = min<uint32_t>(imu_latency.min_us, latency_us);
+            imu_latency.max_us = max<uint32_t>(imu_latency.max_us, latency_us);
+        }
+        rosbot_sensors::imu_ring.release();
+    }
+
+    uint32_t overflows = rosbot_sensors::imu_ring.overflows();
+    if(overflows != reported_overflows && nh.connected())
+    {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "IMU ring overflow, %lu samples dropped", (unsigned long)overflows);
+        nh.logwarn(buffer);
+        reported_overflows = overflows;
+    }
+}
+
+/// buttons and logs
+static void statusTask()
+{
+    static bool welcome_flag = true;
+
+#if USE_WS2812B_ANIMATION_MANAGER
+    if(!nh.connected()) anim_manager->enableInterface(false);
+#endif
+
+    if(button1_publish_flag)
+    {
+        button1_publish_flag = false;
+        if(!button1)
+        {
+            button_msg.data = 1;
+            if(nh.connected()) button_pub->publish(&button_msg);
+        }
+    }
+
+    if(button2_publish_flag)
+    {
+        button2_publish_flag = false;
+        if(!button2)
+        {
+            button_msg.data = 2;
+            if(nh.connected()) button_pub->publish(&button_msg);
+        }
+    }
+
+    // LOGS
+    if(nh.connected())
+    {
+        if(welcome_flag)
+        {
+            welcome_flag = false;
+            nh.loginfo(WELLCOME_STR);
+            if(!distance_sensors_init_flag)
+                nh.logerror("VL53L0X sensors initialisation failure!");
+            if(!imu_init_flag)
+                nh.logerror("MPU9250 initialisation failure!");
+        }
+    }
+    else
+    {
+        welcome_flag = true;
+    }
+}
+
 #if defined(MEMORY_DEBUG_INFO)
 #define MAX_THREAD_INFO 10
 
@@ -803,6 +1797,14 @@ int print_debug_info()
 }
 #endif /* MEMORY_DEBUG_INFO */
 
+static int addMainTask(const char * name, Callback<void()> task, uint32_t period_ms, uint32_t phase_ms)
+{
+    int index = main_scheduler.addTask(name, task, period_ms, phase_ms);
+    if (index < 0)
+        error("Task %s does not fit in the task table!\r\n", name);
+    return index;
+}
+
 int main()
 {
     ThisThread::sleep_for(100);
@@ -815,6 +1817,7 @@ int main()
 
     drive.setupMotorSequence(MOTOR_FR,MOTOR_FL,MOTOR_RR,MOTOR_RL);
     drive.init(rosbot_kinematics::custom_wheel_params,RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+    rosbot_kinematics::setupRosbotOdometry(drive);
     drive.enable(true);
     drive.enablePidReg(true);
 
@@ -825,10 +1828,6 @@ int main()
 
     nh.initNode();
 
-    bool distance_sensors_init_flag = false;
-    bool imu_init_flag = false;
-    bool welcome_flag = true;
-    
     //TODO: add /diagnostic messages
     int num_sens_init;
     if((num_sens_init = distance_sensors.init()) > 0)
@@ -854,6 +1853,7 @@ int main()
     initJointStatePublisher();
     initImuPublisher();
     initButtonPublisher();
+    initDiagnosticsPublisher();
 
 #if USE_WS2812B_ANIMATION_MANAGER
     anim_manager = AnimationManager::getInstance();
@@ -864,187 +1864,24 @@ int main()
     print_debug_info();
 #endif /* MEMORY_DEBUG_INFO */ 
 
-    int spin_result;
-    int err_msg=0;
-    uint32_t spin_count=1;
-    float curr_odom_calc_time, last_odom_calc_time = 0.0f;
-    
+    // the phases spread the releases of the 10 ms tasks over the frame, the pose is published
+    // right after the odometry update and tf/joint_states are shifted within the 50 ms period
+    addMainTask("spin", spinTask, SPIN_PERIOD_MS, 0);
+    addMainTask("watchdog", speedWatchdogTask, WATCHDOG_PERIOD_MS, 0);
+    addMainTask("range", rangeTask, RANGE_PERIOD_MS, 3);
+    addMainTask("imu", imuTask, IMU_PERIOD_MS, 5);
+    addMainTask("status", statusTask, STATUS_PERIOD_MS, 7);
+    odometry_task = addMainTask("odom", odometryTask, ODOMETRY_PERIOD_MS, 1);
+    topic_rates[TOPIC_POSE].task = addMainTask("pose", poseTask, POSE_PERIOD_MS, 2);
+    topic_rates[TOPIC_TELEMETRY].task = addMainTask("telemetry", telemetryTask, POSE_PERIOD_MS, 2);
+    topic_rates[TOPIC_TF].task = addMainTask("tf", tfTask, POSE_PERIOD_MS, 19);
+    topic_rates[TOPIC_JOINTS].task = addMainTask("joints", jointStatesTask, POSE_PERIOD_MS, 34);
+    addMainTask("battery", batteryTask, BATTERY_PERIOD_MS, 9);
+    topic_rates[TOPIC_DIAGNOSTICS].task = addMainTask("link", linkTask, LINK_PERIOD_MS, 13);
+    main_scheduler.start();
+
     while (1)
     {
-
-        if(is_speed_watchdog_enabled)
-        {
-            if(!is_speed_watchdog_active && (odom_watchdog_timer.read_ms() - last_speed_command_time) > speed_watchdog_interval)
-            {
-                rosbot_kinematics::setRosbotSpeed(drive, 0.0f, 0.0f);
-                is_speed_watchdog_active = true;
-            }
-        }
-
-#if USE_WS2812B_ANIMATION_MANAGER
-        if(!nh.connected()) anim_manager->enableInterface(false);
-#endif
-
-        if (spin_count % 2 == 0)
-        {
-            curr_odom_calc_time = odom_watchdog_timer.read();
-            rosbot_kinematics::updateRosbotOdometry(drive,odometry,curr_odom_calc_time-last_odom_calc_time);
-            last_odom_calc_time = curr_odom_calc_time;
-        }
-
-        if(button1_publish_flag)
-        {
-            button1_publish_flag = false;
-            if(!button1)
-            {
-                button_msg.data = 1;
-                if(nh.connected()) button_pub->publish(&button_msg);
-            }
-        }
-
-        if(button2_publish_flag)
-        {
-            button2_publish_flag = false;
-            if(!button2)
-            {
-                button_msg.data = 2;
-                if(nh.connected()) button_pub->publish(&button_msg);
-            }
-        }
-
-        if (spin_count % 5 == 0) /// cmd_vel, odometry, joint_states, tf messages
-        {
-            current_vel.linear.x = sqrt(odometry.odom.robot_x_vel * odometry.odom.robot_x_vel + odometry.odom.robot_y_vel * odometry.odom.robot_y_vel);
-            current_vel.angular.z = odometry.odom.robot_angular_vel;
-            pose.pose.position.x = odometry.odom.robot_x_pos;
-            pose.pose.position.y = odometry.odom.robot_y_pos;
-            pose.pose.orientation = tf::createQuaternionFromYaw(odometry.odom.robot_angular_pos);
-            
-            pose.header.stamp = nh.now();
-            if(nh.connected()){
-                pose_pub->publish(&pose);
-                vel_pub->publish(&current_vel);
-            }
-
-            if(joint_states_enabled)
-            {
-                pos[0] = odometry.odom.wheel_FL_ang_pos;
-                pos[1] = odometry.odom.wheel_FR_ang_pos;
-                pos[2] = odometry.odom.wheel_RL_ang_pos;
-                pos[3] = odometry.odom.wheel_RR_ang_pos;
-                joint_states.position = pos;
-                joint_states.header.stamp = pose.header.stamp; 
-                if(nh.connected()) joint_state_pub->publish(&joint_states);
-            }
-
-            if(tf_msgs_enabled)
-            {
-                robot_tf.header.stamp = pose.header.stamp; 
-                robot_tf.transform.translation.x = pose.pose.position.x;
-                robot_tf.transform.translation.y = pose.pose.position.y;
-                robot_tf.transform.rotation.x = pose.pose.orientation.x;
-                robot_tf.transform.rotation.y = pose.pose.orientation.y;
-                robot_tf.transform.rotation.z = pose.pose.orientation.z;
-                robot_tf.transform.rotation.w = pose.pose.orientation.w;
-                if(nh.connected()) broadcaster.sendTransform(robot_tf);
-            }
-        }
-
-        if(spin_count % 40 == 0)
-        {
-            battery_state.voltage = rosbot_sensors::updateBatteryWatchdog();
-            if(nh.connected()) battery_pub->publish(&battery_state);
-        }
-
-        osEvent evt = distance_sensor_mail_box.get(0);
-        if(evt.status == osEventMail)
-        {
-            SensorsMeasurement * message = (SensorsMeasurement*)evt.value.p;
-            if(message->status == MultiDistanceSensor::ERR_I2C_FAILURE)
-            {
-                err_msg++;
-                if(distance_sensor_commands.empty() && err_msg == 3)
-                {
-                    if(nh.connected()) nh.logerror("I2C error. Restarting VL53L0X sensors...");
-                    uint8_t * data = distance_sensor_commands.alloc();
-                    *data = 2;
-                    distance_sensor_commands.put(data);
-                    data = distance_sensor_commands.alloc();
-                    *data = 1;
-                    distance_sensor_commands.put(data);
-                    err_msg = 0;
-                }
-            }
-            else
-            {
-                err_msg = 0;
-                for(int i=0; i<4; i++)
-                {
-                    range_msg[i].header.stamp = nh.now(message->timestamp);
-                    range_msg[i].range = message->range[i];
-                    if(nh.connected()) range_pub[i]->publish(&range_msg[i]);
-                }
-            }
-            distance_sensor_mail_box.free(message);
-        }
-        // }
-        // if(spin_count % 20 == 0 && distance_sensors_enabled) // ~ 5 HZ
-        // {
-        //     uint16_t range;
-        //     ros::Time t = nh.now();
-        //     for(int i=0;i<4;i++)
-        //     {
-        //         range = distance_sensors->getSensor(i)->readRangeContinuousMillimeters(false);
-        //         range_msg[i].header.stamp = t;
-        //         range_msg[i].range = (range != 65535) ? (float)range/1000.0f : -1.0f;
-        //         if(nh.connected()) range_pub[i]->publish(&range_msg[i]);
-        //     }
-        // }
-        
-        evt = rosbot_sensors::imu_sensor_mail_box.get(0);
-
-        if(evt.status == osEventMail)
-        {
-            rosbot_sensors::imu_meas_t * message = (rosbot_sensors::imu_meas_t*)evt.value.p;
-
-            imu_msg.header.stamp = nh.now(message->timestamp);
-            imu_msg.orientation.x = message->orientation[0];
-            imu_msg.orientation.y = message->orientation[1];
-            imu_msg.orientation.z = message->orientation[2];
-            imu_msg.orientation.w = message->orientation[3];
-            for(int i=0;i<3;i++)
-            {
-                imu_msg.angular_velocity[i] = message->angular_velocity[i];
-                imu_msg.linear_acceleration[i] = message->linear_velocity[i];
-            }
-            rosbot_sensors::imu_sensor_mail_box.free(message);
-            if(nh.connected()) imu_pub->publish(&imu_msg);
-        }
-        
-        // LOGS
-        if(nh.connected())
-        {
-            if(welcome_flag)
-            {
-                welcome_flag = false;
-                nh.loginfo(WELLCOME_STR);
-                if(!distance_sensors_init_flag)
-                    nh.logerror("VL53L0X sensors initialisation failure!");
-                if(!imu_init_flag)
-                    nh.logerror("MPU9250 initialisation failure!");
-            }
-        }
-        else
-        {
-            welcome_flag = true;
-        }
-
-        if((spin_result=nh.spinOnce()) != ros::SPIN_OK)
-        {
-            // nh.logwarn(spin_result == -1 ? "SPIN_ERR" : "SPIN_TIMEOUT");
-            do {}while(0); // do nothing at the moment
-        }
-        spin_count++;
-        ThisThread::sleep_for(MAIN_LOOP_INTERVAL_MS);
+        main_scheduler.dispatch();
     }
 }
\ No newline at end of file
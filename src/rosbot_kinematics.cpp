@@ -1,4 +1,5 @@
 #include "rosbot_kinematics.h"
+#include <Profiler.h>
 
 namespace rosbot_kinematics {
 
@@ -13,6 +14,12 @@ RosbotWheel custom_wheel_params = {
 
 void setRosbotSpeed(RosbotDrive & drive, float linear, float angular)
 {
+    if(drive.isProfileEnabled())
+    {
+        // the regulator loop ramps the body velocity and computes the wheel targets
+        drive.updateTargetVelocity(linear, angular);
+        return;
+    }
     NewTargetSpeed new_speed;
     new_speed.mode = MPS;
     new_speed.speed[MOTOR_FL] = new_speed.speed[MOTOR_RL] = linear - (angular * ROBOT_WIDTH_HALF);
@@ -20,35 +27,116 @@ void setRosbotSpeed(RosbotDrive & drive, float linear, float angular)
     drive.updateTargetSpeed(new_speed);
 }
 
-void updateRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom, float dtime)
+void enableRosbotProfile(RosbotDrive & drive, bool en, const VelocityLimits & limits)
 {
+    if(!en)
+    {
+        drive.disableProfile();
+        return;
+    }
+    DriveProfileParams params = {{MOTOR_FL, MOTOR_RL}, {MOTOR_FR, MOTOR_RR}, (float)ROBOT_WIDTH_HALF, limits};
+    drive.enableProfile(params);
+}
+
+void setupRosbotOdometry(RosbotDrive & drive)
+{
+#if MBED_CONF_ROSBOT_DRIVE_REGULATOR_ODOMETRY
+    DriveOdometryParams params = {{MOTOR_FL, MOTOR_RL}, {MOTOR_FR, MOTOR_RR}, (float)(ROBOT_WIDTH * custom_wheel_params.diameter_modificator)};
+    drive.enableOdometry(params);
+#endif
+}
+
+void updateRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom)
+{
+    PROFILE_SCOPE("odometry");
     float curr_wheel_R_ang_pos;
     float curr_wheel_L_ang_pos;
     Odometry * iodom = &odom.odom;
-    iodom->wheel_FR_ang_pos = drive.getAngularPos(MOTOR_FR);
-    iodom->wheel_FL_ang_pos = drive.getAngularPos(MOTOR_FL);
-    iodom->wheel_RR_ang_pos = drive.getAngularPos(MOTOR_RR);
-    iodom->wheel_RL_ang_pos = drive.getAngularPos(MOTOR_RL);
+    DriveStateSnapshot state;
+    drive.getDriveState(state); // all wheels from the same regulator iteration
+    bool regulator_odometry = drive.isOdometryEnabled();
+    if(!regulator_odometry)
+    {
+        odom.integrator.setGeometry(2 * M_PI * custom_wheel_params.radius / (custom_wheel_params.gear_ratio * custom_wheel_params.encoder_cpr * custom_wheel_params.tyre_deflation),
+                                    ROBOT_WIDTH * custom_wheel_params.diameter_modificator);
+        odom.integrator.update(state.ticks[MOTOR_FL] + state.ticks[MOTOR_RL], state.ticks[MOTOR_FR] + state.ticks[MOTOR_RR], 2, state.timestamp_us);
+        odom.integrator.setWheelSpeeds(0.5f * (state.cspeed_mps[MOTOR_FL] + state.cspeed_mps[MOTOR_RL]),
+                                       0.5f * (state.cspeed_mps[MOTOR_FR] + state.cspeed_mps[MOTOR_RR]));
+    }
+    // the pose of the regulator comes from the same encoder sample as the wheel positions
+    const OdometryPose & pose = regulator_odometry ? state.odometry : odom.integrator.getPose();
+
+    iodom->wheel_FR_ang_pos = state.angular_pos[MOTOR_FR];
+    iodom->wheel_FL_ang_pos = state.angular_pos[MOTOR_FL];
+    iodom->wheel_RR_ang_pos = state.angular_pos[MOTOR_RR];
+    iodom->wheel_RL_ang_pos = state.angular_pos[MOTOR_RL];
     curr_wheel_R_ang_pos = (iodom->wheel_FR_ang_pos + iodom->wheel_RR_ang_pos)/(2*custom_wheel_params.tyre_deflation);
     curr_wheel_L_ang_pos = (iodom->wheel_FL_ang_pos + iodom->wheel_RL_ang_pos)/(2*custom_wheel_params.tyre_deflation);
-    iodom->wheel_L_ang_vel = (curr_wheel_L_ang_pos - iodom->wheel_L_ang_pos) / (dtime);
-    iodom->wheel_R_ang_vel = (curr_wheel_R_ang_pos - iodom->wheel_R_ang_pos) / (dtime);
+    if(state.timestamp_us != odom.timestamp_us)
+    {
+        float dtime = (state.timestamp_us - odom.timestamp_us) * 1e-6f;
+        iodom->wheel_L_ang_vel = (curr_wheel_L_ang_pos - iodom->wheel_L_ang_pos) / dtime;
+        iodom->wheel_R_ang_vel = (curr_wheel_R_ang_pos - iodom->wheel_R_ang_pos) / dtime;
+    }
     iodom->wheel_L_ang_pos = curr_wheel_L_ang_pos;
     iodom->wheel_R_ang_pos = curr_wheel_R_ang_pos;
-    iodom->robot_angular_vel = (((iodom->wheel_R_ang_pos - iodom->wheel_L_ang_pos) * WHEEL_RADIUS / (ROBOT_WIDTH * custom_wheel_params.diameter_modificator)) - iodom->robot_angular_pos) / dtime;
-    iodom->robot_angular_pos = (iodom->wheel_R_ang_pos - iodom->wheel_L_ang_pos) * WHEEL_RADIUS / (ROBOT_WIDTH * custom_wheel_params.diameter_modificator);
-    iodom->robot_x_vel = (iodom->wheel_L_ang_vel * WHEEL_RADIUS + iodom->robot_angular_vel * ROBOT_WIDTH_HALF) * cos(iodom->robot_angular_pos);
-    iodom->robot_y_vel = (iodom->wheel_L_ang_vel * WHEEL_RADIUS + iodom->robot_angular_vel * ROBOT_WIDTH_HALF) * sin(iodom->robot_angular_pos);
-    iodom->robot_x_pos = iodom->robot_x_pos + iodom->robot_x_vel * dtime;
-    iodom->robot_y_pos = iodom->robot_y_pos + iodom->robot_y_vel * dtime;
+    odom.timestamp_us = state.timestamp_us;
+    double ds = pose.distance - odom.distance;
+    odom.distance = pose.distance;
+    if(odom.heading_fusion)
+    {
+        // standing means no ticks in the speed window and no speed requested, the gyro bias is estimated meanwhile
+        bool stationary = pose.linear_vel == 0.0f && pose.angular_vel == 0.0f;
+        for(int i = 0; i < 4 && stationary; i++)
+            stationary = state.tspeed_mps[i] == 0.0f;
+        double yaw = odom.heading.getYaw();
+        odom.heading.updateWheels(pose.yaw, stationary, state.timestamp_us);
+        double mid = 0.5 * (yaw + odom.heading.getYaw());
+        odom.fused_x += ds * cos(mid);
+        odom.fused_y += ds * sin(mid);
+        iodom->robot_angular_pos = (float)odom.heading.getYaw();
+        iodom->robot_angular_vel = odom.heading.getRate();
+        iodom->robot_x_pos = (float)odom.fused_x;
+        iodom->robot_y_pos = (float)odom.fused_y;
+    }
+    else
+    {
+        iodom->robot_angular_pos = (float)pose.yaw;
+        iodom->robot_angular_vel = pose.angular_vel;
+        iodom->robot_x_pos = (float)pose.x;
+        iodom->robot_y_pos = (float)pose.y;
+    }
+    // mean of the sides, the legacy vL + w * W/2 with w scaled by diameter_modificator was not zero turning in place
+    iodom->robot_x_vel = pose.linear_vel * cos(iodom->robot_angular_pos);
+    iodom->robot_y_vel = pose.linear_vel * sin(iodom->robot_angular_pos);
 }
 
 void resetRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom)
 {
     drive.enablePidReg(0);
-    memset(odom.buffor,0,sizeof(odom.buffor));
+    memset(&odom.odom,0,sizeof(odom.odom));
+    odom.integrator.reset();
+    odom.heading.reset(0.0);
+    odom.fused_x = odom.fused_y = 0.0;
+    odom.distance = 0.0;
     drive.resetDistance();
     drive.enablePidReg(1);
 }
 
+void enableRosbotHeadingFusion(RosbotOdometry & odom, bool en)
+{
+    if(en && !odom.heading_fusion)
+    {
+        odom.heading.reset(odom.odom.robot_angular_pos);
+        odom.fused_x = odom.odom.robot_x_pos;
+        odom.fused_y = odom.odom.robot_y_pos;
+    }
+    odom.heading_fusion = en;
+}
+
+void updateRosbotHeading(RosbotOdometry & odom, float yaw_rate, uint32_t timestamp_us)
+{
+    odom.heading.updateGyro(yaw_rate, timestamp_us);
+}
+
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define __ROSBOT_KINEMATICS_H__
 
 #include <RosbotDrive.h>
+#include <OdometryIntegrator.h>
+#include <HeadingFilter.h>
 
 #define ROBOT_WIDTH 0.215         // 0.22 0.195
 #define DIAMETER_MODIFICATOR 1.106 // 1.24, 1.09, 1.164
@@ -41,15 +43,31 @@ struct Odometry
     float robot_y_vel;       // meters per second
 };
 
-union RosbotOdometry
+struct RosbotOdometry
 {
     Odometry odom;
-    float buffor[14];
+    OdometryIntegrator integrator; // pose in double precision, odom holds its float copy
+    uint32_t timestamp_us;         // encoder sample of odom
+    HeadingFilter heading;         // gyro fused heading, used when heading_fusion is set
+    bool heading_fusion;
+    double fused_x;                // position integrated along the fused heading
+    double fused_y;
+    double distance;               // path length of the integrator at the last update
 };
 
+/** Set the wheel targets, or the target of the body velocity profile when it is enabled. */
 void setRosbotSpeed(RosbotDrive & drive, float linear, float angular);
-void updateRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom, float dtime);
+/** Ramp the speed commands with limited acceleration and jerk in the regulator loop. */
+void enableRosbotProfile(RosbotDrive & drive, bool en, const VelocityLimits & limits);
+/** Let the regulator loop integrate the odometry (rosbot-drive.regulator-odometry), call after wheel parameter changes. */
+void setupRosbotOdometry(RosbotDrive & drive);
+/** Update odom from the pose integrated by the regulator loop, or integrate the encoder ticks since the previous update. */
+void updateRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom);
 void resetRosbotOdometry(RosbotDrive & drive, RosbotOdometry & odom);
+/** Publish the heading fused from the gyro and the wheels, enabling starts from the current pose. */
+void enableRosbotHeadingFusion(RosbotOdometry & odom, bool en);
+/** Feed a gyro yaw rate sample [rad/s] of the IMU to the heading fusion. */
+void updateRosbotHeading(RosbotOdometry & odom, float yaw_rate, uint32_t timestamp_us);
 
 }
 #endif /* __ROSBOT_KINEMATICS_H__ */
\ No newline at end of file
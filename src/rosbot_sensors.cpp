@@ -1,4 +1,5 @@
 #include "rosbot_sensors.h"
+#include <Profiler.h>
 
 namespace rosbot_sensors{
 
@@ -69,20 +70,27 @@ const signed char DEFAULT_IMU_ORIENTATION[9] = {
 
 InterruptIn imu_int(SENS2_PIN1);
 
-Mail<imu_meas_t, 10> imu_sensor_mail_box;
+SpscRing<imu_record_t, IMU_RING_SIZE> imu_ring;
+
+#define IMU_DATA_FLAG 0x01
+#define IMU_POLL_TIMEOUT_MS 100 // readout without interrupt, in case an edge of the latched interrupt is lost
+#define IMU_PACKET_SIZE 28 // DMP FIFO packet: 6-axis quaternion (16), raw accel (6), calibrated gyro (6)
 
-volatile uint16_t new_data = 0;
 static MPU9250_DMP imu;
 static Mutex imu_mutex;
 Thread imu_thread;
+static volatile uint32_t imu_irq_time_us = 0;
+static int imu_rate = FIFO_SAMPLE_RATE_OPERATION;
 
 static void imu_interrupt_cb(void)
 {
-    core_util_atomic_incr_u16(&new_data,1);
+    imu_irq_time_us = us_ticker_read();
+    imu_thread.flags_set(IMU_DATA_FLAG);
 }
 
 static void imuCallback()
 {
+    PROFILE_SCOPE("imu");
     // Use dmpUpdateFifo to update the ax, gx, mx, etc. values
     imu_mutex.lock();
     // 10.2 Content of DMP Output to FIFO
@@ -93,28 +101,34 @@ static void imuCallback()
     // * Low Power 6-Axis Quaternion (16 bytes)
     // * Raw Sensor Data (12 bytes)
     // * Gesture Word (Android Orientation + Tap outputs) (4 bytes)
-    if(imu.fifoAvailable() >= 32)
+
+    // drain all complete packets, dmpUpdateFifo() fails when there is no full packet left
+    uint32_t irq_time_us = imu_irq_time_us;
+    uint32_t period_us = 1000000 / imu_rate;
+    uint16_t available;
+    for(int i=0; i<IMU_RING_SIZE && (available = imu.fifoAvailable()) > 0 && imu.dmpUpdateFifo() == INV_SUCCESS; i++)
     {
-        if (imu.dmpUpdateFifo() == INV_SUCCESS)
+        // the interrupt came with the newest packet, an older one was sampled a period earlier
+        // for every packet queued behind it
+        uint32_t queued = available / IMU_PACKET_SIZE;
+        // a full ring drops the sample and counts it in imu_ring.overflows()
+        imu_record_t * record = imu_ring.beginWrite();
+        if(record != NULL)
         {
-            if(!imu_sensor_mail_box.full())
-            {
-                imu_meas_t * new_msg = imu_sensor_mail_box.alloc();
-                new_msg->orientation[0] = imu.calcQuat(imu.qx);   
-                new_msg->orientation[1] = imu.calcQuat(imu.qy);   
-                new_msg->orientation[2] = imu.calcQuat(imu.qz);   
-                new_msg->orientation[3] = imu.calcQuat(imu.qw);
-                new_msg->angular_velocity[0] = imu.calcGyro(imu.gx);
-                new_msg->angular_velocity[1] = imu.calcGyro(imu.gy);
-                new_msg->angular_velocity[2] = imu.calcGyro(imu.gz);
-                new_msg->linear_velocity[0] = imu.calcAccel(imu.ax);
-                new_msg->linear_velocity[1] = imu.calcAccel(imu.ay);
-                new_msg->linear_velocity[2] = imu.calcAccel(imu.az);
-                new_msg->timestamp = imu.time;
-                imu_sensor_mail_box.put(new_msg);
-            }
+            record->msg.orientation.x = imu.calcQuat(imu.qx);   
+            record->msg.orientation.y = imu.calcQuat(imu.qy);   
+            record->msg.orientation.z = imu.calcQuat(imu.qz);   
+            record->msg.orientation.w = imu.calcQuat(imu.qw);
+            record->msg.angular_velocity[0] = imu.calcGyro(imu.gx);
+            record->msg.angular_velocity[1] = imu.calcGyro(imu.gy);
+            record->msg.angular_velocity[2] = imu.calcGyro(imu.gz);
+            record->msg.linear_acceleration[0] = imu.calcAccel(imu.ax);
+            record->msg.linear_acceleration[1] = imu.calcAccel(imu.ay);
+            record->msg.linear_acceleration[2] = imu.calcAccel(imu.az);
+            record->timestamp = imu.time;
+            record->ready_time_us = irq_time_us - (queued > 0 ? queued - 1 : 0) * period_us;
+            imu_ring.commitWrite();
         }
-        core_util_atomic_decr_u16(&new_data,1);
     }
     imu_mutex.unlock();
 }
@@ -123,8 +137,8 @@ static void imu_loop()
 {
     while(1)
     {
-        if(new_data && imu_state) imuCallback();
-        ThisThread::sleep_for(20);
+        ThisThread::flags_wait_any_for(IMU_DATA_FLAG, IMU_POLL_TIMEOUT_MS);
+        if(imu_state) imuCallback();
     }
 }
 
@@ -146,7 +160,7 @@ int initImu()
                        DMP_FEATURE_GYRO_CAL       | // Use gyro calibration
                        DMP_FEATURE_SEND_RAW_ACCEL | // Enable raw accel measurements
                        DMP_FEATURE_SEND_CAL_GYRO,   // Enable cal gyro measurements
-                       10);                         // Set DMP FIFO rate
+                       imu_rate);                   // Set DMP FIFO rate
 
     err += imu.dmpSetOrientation(DEFAULT_IMU_ORIENTATION);
     
@@ -192,6 +206,23 @@ void enableImu(int en)
     imu_mutex.unlock();
 }
 
+bool setImuRate(int rate_hz)
+{
+    if(rate_hz < FIFO_SAMPLE_RATE_MIN || rate_hz > FIFO_SAMPLE_RATE_MAX)
+        return false;
+    imu_mutex.lock();
+    bool ok = imu.dmpSetFifoRate(rate_hz) == INV_SUCCESS;
+    if(ok)
+        imu_rate = rate_hz;
+    imu_mutex.unlock();
+    return ok;
+}
+
+int getImuRate()
+{
+    return imu_rate;
+}
+
 int resetImu()
 {
     if(!imu_state)
@@ -211,7 +242,7 @@ int resetImu()
                        DMP_FEATURE_GYRO_CAL       | // Use gyro calibration
                        DMP_FEATURE_SEND_RAW_ACCEL | // Enable raw accel measurements
                        DMP_FEATURE_SEND_CAL_GYRO,   // Enable raw gyre measurements
-                       10);                         // Set DMP FIFO rate
+                       imu_rate);                   // Set DMP FIFO rate
 
     err = imu.dmpSetOrientation(DEFAULT_IMU_ORIENTATION);
     
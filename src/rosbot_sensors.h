@@ -4,22 +4,30 @@
 #include <mbed.h>
 #include <MultiDistanceSensor.h>
 #include <SparkFunMPU9250-DMP.h>
+#include <SpscRing.h>
+#include <rosbot_ekf/Imu.h>
 
-#define FIFO_SAMPLE_RATE_OPERATION 10
+#define FIFO_SAMPLE_RATE_OPERATION 10 // default DMP FIFO rate [Hz]
+#define FIFO_SAMPLE_RATE_MIN 10
+#define FIFO_SAMPLE_RATE_MAX 200
+#define IMU_RING_SIZE 16
 
 namespace rosbot_sensors{
 
+/**
+ * IMU record filled by the IMU thread straight from the DMP FIFO. The main loop stamps
+ * the message and publishes it in place.
+ */
 typedef struct 
 {
-    float orientation[4];
-    float angular_velocity[3];
-    float linear_velocity[3];
-    uint32_t timestamp;
-}imu_meas_t;
+    rosbot_ekf::Imu msg;
+    uint32_t timestamp; // IMU time [ms]
+    uint32_t ready_time_us; // us_ticker time the sample was ready: the data ready interrupt stepped back by the packets queued after it
+}imu_record_t;
 
 float updateBatteryWatchdog();
 
-extern Mail<imu_meas_t, 10> imu_sensor_mail_box;
+extern SpscRing<imu_record_t, IMU_RING_SIZE> imu_ring;
 
 int initImu();
 
@@ -27,6 +35,15 @@ int resetImu();
 
 void enableImu(int en);
 
+/**
+ * @brief Set DMP FIFO rate.
+ * @param rate_hz rate from FIFO_SAMPLE_RATE_MIN to FIFO_SAMPLE_RATE_MAX
+ * @return false if the rate is out of range or the IMU rejected it
+ */
+bool setImuRate(int rate_hz);
+
+int getImuRate();
+
 class ServoManger : NonCopyable<ServoManger>
 {
 
@@ -0,0 +1,115 @@
+/** @file heading-filter-test.cpp
+ * Test of the gyro and wheel heading fusion on a skid steering drive.
+ *
+ * The route alternates standing, turns in place and arcs where the wheel heading overshoots
+ * the true one by a slip that changes from turn to turn, and straights without slip. The gyro
+ * has a constant bias and white noise. The heading errors of the wheels alone, of the raw
+ * gyro and of the filter are compared.
+ */
+#include <HeadingFilter.h>
+#include <math.h>
+#include <stdio.h>
+#include <random>
+
+#define IMU_PERIOD_US 10000   // 100 Hz gyro
+#define WHEEL_PERIOD_US 20000 // odometry task
+#define GYRO_BIAS 0.01f       // rad/s
+#define GYRO_NOISE 0.005f     // rad/s
+#define ROUTE_S 600
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+struct Phase
+{
+    float rate;     // true yaw rate [rad/s]
+    float slip;     // relative overshoot of the wheel yaw rate
+    float duration; // s
+    bool standing;  // wheels stand still
+};
+
+int main()
+{
+    HeadingFilter filter;
+    check(filter.getYaw() == 0.0 && filter.getBias() == 0.0f, "new filter starts at zero");
+
+    // without gyro samples the filter follows the wheels
+    filter.updateWheels(0.0, true, 0);
+    for (int i = 1; i <= 50; i++) filter.updateWheels(0.01 * i, false, i * WHEEL_PERIOD_US);
+    check(fabs(filter.getYaw() - 0.5) < 1e-9 && fabs(filter.getRate() - 0.5f) < 1e-3f, "wheel heading without gyro");
+
+    // zero time constant is the wheel heading
+    HeadingFilterParams params = {0.0f, 2.0f, 0.05f};
+    filter.setParams(params);
+    filter.reset(1.0);
+    filter.updateWheels(0.0, false, 0);
+    filter.updateGyro(0.0f, 0);
+    for (int i = 1; i <= 50; i++)
+    {
+        filter.updateGyro(3.0f, i * WHEEL_PERIOD_US);
+        filter.updateWheels(0.02 * i, false, i * WHEEL_PERIOD_US);
+    }
+    check(fabs(filter.getYaw() - 2.0) < 1e-6, "zero time constant follows the wheels");
+
+    static const Phase route[] = {
+        {0.0f, 0.0f, 5.0f, true},     // standing, bias estimation
+        {1.0f, 0.25f, 1.6f, false},   // turn in place
+        {0.0f, 0.0f, 6.0f, false},    // straight
+        {0.4f, 0.10f, 4.0f, false},   // arc
+        {0.0f, 0.0f, 3.0f, true},     // standing
+        {-1.2f, 0.30f, 2.0f, false},  // turn in place the other way
+        {0.0f, 0.0f, 8.0f, false},    // straight
+        {-0.3f, 0.08f, 5.0f, false},  // arc
+    };
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, GYRO_NOISE);
+    std::uniform_real_distribution<float> slip_spread(0.7f, 1.3f);
+
+    filter.setParams(HeadingFilter::DEFAULT_PARAMS);
+    filter.reset(0.0);
+    double truth = 0.0, wheels = 0.0, gyro = 0.0;
+    double wheel_sq = 0.0, gyro_sq = 0.0, fused_sq = 0.0;
+    int samples = 0;
+    uint32_t t_us = 0;
+    filter.updateWheels(wheels, true, t_us);
+    for (int phase = 0; t_us < ROUTE_S * 1000000UL; phase = (phase + 1) % (sizeof(route) / sizeof(route[0])))
+    {
+        const Phase & p = route[phase];
+        float slip = p.slip * slip_spread(rng);
+        for (uint32_t end = t_us + (uint32_t)(p.duration * 1e6f); t_us < end;)
+        {
+            t_us += IMU_PERIOD_US;
+            double step = p.rate * IMU_PERIOD_US * 1e-6;
+            truth += step;
+            wheels += step * (1.0 + slip);
+            float measured = p.rate + GYRO_BIAS + noise(rng);
+            gyro += measured * IMU_PERIOD_US * 1e-6;
+            filter.updateGyro(measured, t_us);
+            if (t_us % WHEEL_PERIOD_US == 0)
+            {
+                filter.updateWheels(wheels, p.standing, t_us);
+                wheel_sq += (wheels - truth) * (wheels - truth);
+                gyro_sq += (gyro - truth) * (gyro - truth);
+                fused_sq += (filter.getYaw() - truth) * (filter.getYaw() - truth);
+                samples++;
+            }
+        }
+    }
+    double wheel_rms = sqrt(wheel_sq / samples), gyro_rms = sqrt(gyro_sq / samples), fused_rms = sqrt(fused_sq / samples);
+    printf("heading after %d s: truth %.3f, wheels %.3f, raw gyro %.3f, fused %.3f rad\r\n", ROUTE_S, truth, wheels, gyro, filter.getYaw());
+    printf("rms error: wheels %.4f, raw gyro %.4f, fused %.4f rad; bias %.4f rad/s (true %.4f)\r\n", wheel_rms, gyro_rms,
+           fused_rms, filter.getBias(), GYRO_BIAS);
+    check(fabs(filter.getBias() - GYRO_BIAS) < 0.2f * GYRO_BIAS, "gyro bias is estimated while standing");
+    check(fused_rms < 0.1 * wheel_rms, "fusion removes the wheel slip");
+    check(fused_rms < 0.1 * gyro_rms, "fusion removes the gyro drift");
+    check(fabs(filter.getYaw() - truth) < 0.035, "fused heading stays within 2 degrees");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
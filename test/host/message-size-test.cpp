@@ -0,0 +1,150 @@
+/** @file message-size-test.cpp
+ * Test of the serialized length of the published topics used by the link budget.
+ *
+ * The standard messages are not built on the host, they are replaced by structures with the
+ * field names of the generated rosserial messages. rosbot_ekf/Telemetry is serialized for real.
+ */
+#include <RosserialMessageSize.h>
+#include <rosbot_ekf/Telemetry.h>
+#include <stdio.h>
+
+#define FRAME_OVERHEAD 8 // ROSSERIAL_FRAME_OVERHEAD in main.cpp
+#define OUTPUT_SIZE 512  // output buffer of RosbotNodeHandle
+#define LINK_STATUS_VALUES 12
+#define LINK_STATUS_VALUE_SIZE 12
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+struct Header
+{
+    const char * frame_id;
+};
+
+struct PoseStamped
+{
+    Header header;
+};
+
+struct Twist
+{
+};
+
+struct TransformStamped
+{
+    Header header;
+    const char * child_frame_id;
+};
+
+struct TfMessage
+{
+    uint32_t transforms_length;
+    TransformStamped * transforms;
+};
+
+struct JointState
+{
+    Header header;
+    uint32_t name_length;
+    const char ** name;
+    uint32_t position_length;
+    uint32_t velocity_length;
+    uint32_t effort_length;
+};
+
+struct Imu
+{
+    Header header;
+    float angular_velocity[3];
+    float linear_acceleration[3];
+};
+
+struct Range
+{
+    Header header;
+};
+
+struct BatteryState
+{
+    Header header;
+    uint32_t cell_voltage_length;
+    const char * location;
+    const char * serial_number;
+};
+
+struct KeyValue
+{
+    const char * key;
+    const char * value;
+};
+
+struct DiagnosticStatus
+{
+    const char * name;
+    const char * message;
+    const char * hardware_id;
+    uint32_t values_length;
+    KeyValue * values;
+};
+
+struct DiagnosticArray
+{
+    Header header;
+    uint32_t status_length;
+    DiagnosticStatus * status;
+};
+
+int main()
+{
+    // the messages as the firmware fills them
+    PoseStamped pose = {{"odom"}};
+    Twist velocity;
+    TransformStamped robot_tf = {{"odom"}, "base_link"};
+    TfMessage tf = {1, &robot_tf};
+    const char * joint_names[] = {"front_left_wheel_hinge", "front_right_wheel_hinge", "rear_left_wheel_hinge", "rear_right_wheel_hinge"};
+    JointState joints = {{"base_link"}, 4, joint_names, 4, 4, 4};
+    Imu imu = {{""}};
+    Range range = {{"range_fr"}};
+    BatteryState battery = {{""}, 0, "", ""};
+
+    static const char * keys[LINK_STATUS_VALUES] = {"tx_bytes_per_s", "rx_bytes_per_s", "tx_frames", "tx_dropped", "tx_peak",
+        "tx_chunks", "rx_frames", "rx_overflows", "checksum_errors", "spin_timeouts", "resyncs", "disconnects"};
+    char strings[LINK_STATUS_VALUES][LINK_STATUS_VALUE_SIZE] = {};
+    KeyValue values[LINK_STATUS_VALUES];
+    for (int i = 0; i < LINK_STATUS_VALUES; i++) values[i] = {keys[i], strings[i]};
+    DiagnosticStatus link_status = {"rosbot: serial link", "OK", "CORE2", LINK_STATUS_VALUES, values};
+    DiagnosticArray diagnostics = {{""}, 1, &link_status};
+
+    check(rosserial_size::string("odom") == 8 && rosserial_size::string(NULL) == 4, "strings are prefixed with their length");
+    check(rosserial_size::header(pose.header) == 4 + 8 + 8, "header: seq, stamp and frame_id");
+    check(rosserial_size::poseStamped(pose) == 20 + 56 && rosserial_size::twist(velocity) == 48, "pose and velocity");
+    check(rosserial_size::tfMessage(tf) == 4 + 20 + 13 + 56, "tf");
+    check(rosserial_size::jointState(joints) == 25 + 4 + 4 * 4 + 22 + 23 + 21 + 22 + 3 * (4 + 4 * 8), "joint states");
+    check(rosserial_size::imu(imu) == 16 + 32 + 24 && rosserial_size::range(range) == 24 + 17, "IMU and range");
+    check(rosserial_size::batteryState(battery) == 16 + 24 + 3 + 1 + 4 + 4 + 4, "battery");
+
+    rosbot_ekf::Telemetry telemetry;
+    unsigned char buffer[OUTPUT_SIZE];
+    check(rosserial_size::telemetry(telemetry) == (uint32_t)telemetry.serialize(buffer), "telemetry matches the serialization");
+
+    uint32_t empty = rosserial_size::diagnosticArray(diagnostics);
+    for (int i = 0; i < LINK_STATUS_VALUES; i++)
+    {
+        memset(strings[i], '9', LINK_STATUS_VALUE_SIZE - 1);
+        strings[i][LINK_STATUS_VALUE_SIZE - 1] = '\0';
+    }
+    uint32_t full = rosserial_size::diagnosticArray(diagnostics);
+    printf("diagnostics: %lu bytes with empty values, %lu bytes with the longest values\r\n", (unsigned long)empty, (unsigned long)full);
+    check(empty == 289, "diagnostics with empty values");
+    check(full == empty + LINK_STATUS_VALUES * (LINK_STATUS_VALUE_SIZE - 1), "diagnostics follow the value lengths");
+    check(full + FRAME_OVERHEAD <= OUTPUT_SIZE, "longest diagnostics fit in the node handle output buffer");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+/** @file motor-tuner-test.cpp
+ * Test of the wheel model identification on synthetic first order plus dead time drives.
+ */
+#include <MotorTuner.h>
+#include <math.h>
+#include <stdio.h>
+
+#define DT_US 1000
+#define MAX_DELAY 64
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+static bool near(float value, float expected, float tolerance)
+{
+    return fabsf(value - expected) <= tolerance * fabsf(expected);
+}
+
+/** Discrete FOPDT drive: the speed follows K (duty - offset) with time constant T after the dead time L. */
+struct Drive
+{
+    MotorModel model;
+    float speed;
+    float delayed[MAX_DELAY];
+    int head;
+
+    float step(float duty)
+    {
+        int delay = (int)(model.dead_time * 1e6f / DT_US + 0.5f);
+        delayed[(head + delay) % MAX_DELAY] = duty;
+        float u = delayed[head];
+        head = (head + 1) % MAX_DELAY;
+        float target = fabsf(u) > model.offset ? model.gain * (u - copysignf(model.offset, u)) : 0.0f;
+        speed += (target - speed) * (1.0f - expf(-DT_US * 1e-6f / model.time_constant));
+        return speed;
+    }
+};
+
+static MotorTunerState run(MotorTuner & tuner, Drive * drives, int max_iterations)
+{
+    float speed[4] = {0.0f, 0.0f, 0.0f, 0.0f}, duty[4];
+    MotorTunerResult result;
+    for (int n = 0; n < max_iterations && tuner.update(speed, DT_US, duty); n++)
+        for (int i = 0; i < 4; i++) speed[i] = drives[i].step(duty[i]);
+    return tuner.getResult(result);
+}
+
+int main()
+{
+    MotorTuner tuner;
+    MotorTunerResult result;
+    const MotorModel reference = {1.5f, 0.04f, 0.08f, 0.012f, true};
+    Drive drives[4] = {};
+    for (int i = 0; i < 4; i++) drives[i].model = reference;
+    drives[2].model.time_constant = 0.12f;
+    drives[3].model.gain = 1.2f;
+
+    MotorTunerParams params = MotorTuner::DEFAULT_PARAMS;
+    float duty[4];
+    const float still[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    check(!tuner.update(still, DT_US, duty) && duty[0] == 0.0f, "idle tuner does not drive the wheels");
+    tuner.start(params);
+    tuner.update(still, DT_US, duty);
+    check(tuner.isRunning() && duty[0] == params.duty_low && duty[3] == params.duty_low, "experiment starts at the low level");
+
+    tuner.start(params);
+    MotorTunerState state = run(tuner, drives, 10000);
+    tuner.getResult(result);
+    check(state == TUNER_DONE && !tuner.isRunning() && tuner.getDuty() == 0.0f, "experiment ends with the wheels switched off");
+    const MotorModel & m = result.wheel[0];
+    printf("MOTOR1 gain %.3f offset %.4f time constant %.4f dead time %.4f\r\n", m.gain, m.offset, m.time_constant, m.dead_time);
+    check(m.valid && near(m.gain, reference.gain, 0.01f) && near(m.offset, reference.offset, 0.05f), "static gain and friction offset");
+    check(near(m.time_constant, reference.time_constant, 0.1f) && near(m.dead_time, reference.dead_time, 0.25f), "time constant and dead time");
+    check(near(result.wheel[2].time_constant, 0.12f, 0.1f) && near(result.wheel[3].gain, 1.2f, 0.01f), "wheels are identified separately");
+    check(near(result.model.gain, 0.25f * (3 * 1.5f + 1.2f), 0.01f), "regulator model is the mean of the wheels");
+
+    // SIMC gains of the reference model
+    MotorTunerResult gains;
+    MotorTuner::computeGains(reference, 0.05f, gains);
+    float kp = 0.08f / (1.5f * 0.062f);
+    check(near(gains.kp, kp, 1e-4f) && near(gains.ki, kp * 0.01f / 0.08f, 1e-4f), "PI gains follow the SIMC rules");
+    check(near(gains.kv, 1.0f / 1.5f, 1e-4f) && near(gains.ks, 0.04f, 1e-4f) && near(gains.ka, 0.08f / 1.5f, 1e-4f), "feed-forward inverts the model");
+    MotorTuner::computeGains(reference, 0.0f, gains);
+    check(near(gains.kp, 0.08f / (1.5f * 0.024f), 1e-4f) && near(gains.ki, gains.kp * 0.01f / 0.08f, 1e-4f), "tightest tuning from the dead time");
+    MotorModel slow = reference;
+    slow.time_constant = 1.0f;
+    MotorTuner::computeGains(slow, 0.05f, gains);
+    check(near(gains.ki, gains.kp * 0.01f / (4.0f * 0.062f), 1e-4f), "integral time of a lag dominated drive");
+
+    RosbotRegulator_params regulator = {};
+    regulator.kd = 0.015f;
+    tuner.applyGains(regulator);
+    check(regulator.kp == result.kp && regulator.ki == result.ki && regulator.kd == 0.0f && regulator.kv == result.kv, "gains are applied");
+
+    // MOTOR2 does not turn
+    drives[1].model.gain = 0.0f;
+    tuner.start(params);
+    state = run(tuner, drives, 10000);
+    tuner.getResult(result);
+    check(state == TUNER_FAILED && !result.wheel[1].valid && result.wheel[0].valid, "wheel that does not turn fails the experiment");
+    check(result.model.valid && near(result.model.gain, (2 * 1.5f + 1.2f) / 3.0f, 0.01f), "mean model leaves the failed wheel out");
+
+    tuner.start(params);
+    run(tuner, drives, 100);
+    tuner.abort();
+    tuner.update(still, DT_US, duty);
+    check(tuner.getResult(result) == TUNER_FAILED && duty[0] == 0.0f && !result.model.valid, "aborted experiment switches the wheels off");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
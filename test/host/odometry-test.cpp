@@ -0,0 +1,240 @@
+/** @file odometry-test.cpp
+ * Test of the exact arc odometry integrator against the former float Euler integration.
+ *
+ * A 1 km route of straights, arcs and turns in place is driven in closed form, the wheel
+ * encoders are quantized to ticks and sampled every ODOMETRY_PERIOD_MS like the firmware
+ * odometry task. Both integrators replay the same encoder trace and are compared with the
+ * true pose. A recorded trace can be replayed instead, the file has one line per sample:
+ * timestamp_us ticks_fr ticks_fl ticks_rr ticks_rl
+ *
+ * Usage: odometry-test [trace_file]
+ */
+#include <OdometryIntegrator.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// ROSbot geometry, see src/rosbot_kinematics.h
+#define ROBOT_WIDTH 0.215
+#define DIAMETER_MODIFICATOR 1.106
+#define TYRE_DEFLATION 1.042
+#define GEAR_RATIO 34.014
+#define ENCODER_CPR 48
+#define WHEEL_RADIUS 0.0425
+#define ODOMETRY_PERIOD_MS 20
+#define ROUTE_LENGTH_M 1000.0
+#define SUBSTEPS 20
+
+static const double TRACK = ROBOT_WIDTH * DIAMETER_MODIFICATOR;
+static const double METERS_PER_TICK = 2 * M_PI * WHEEL_RADIUS / (GEAR_RATIO * ENCODER_CPR * TYRE_DEFLATION);
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+struct Sample
+{
+    uint32_t timestamp_us;
+    int32_t ticks[4]; // FR, FL, RR, RL
+};
+
+struct Pose
+{
+    double x, y, yaw;
+};
+
+/** Former odometry: float wheel angles, heading from the wheel difference, Euler step with the new heading. */
+class LegacyOdometry
+{
+public:
+    LegacyOdometry() : _l(0), _r(0), _yaw(0), _x(0), _y(0) {}
+
+    void update(const Sample & s, float dtime)
+    {
+        const float coefficient = 2 * M_PI / (GEAR_RATIO * ENCODER_CPR);
+        float r = (coefficient * s.ticks[0] + coefficient * s.ticks[2]) / (2 * TYRE_DEFLATION);
+        float l = (coefficient * s.ticks[1] + coefficient * s.ticks[3]) / (2 * TYRE_DEFLATION);
+        float l_vel = (l - _l) / dtime;
+        _l = l;
+        _r = r;
+        float yaw = (_r - _l) * WHEEL_RADIUS / (ROBOT_WIDTH * DIAMETER_MODIFICATOR);
+        float yaw_vel = (yaw - _yaw) / dtime;
+        _yaw = yaw;
+        _x = _x + (l_vel * WHEEL_RADIUS + yaw_vel * ROBOT_WIDTH / 2.0) * cos(_yaw) * dtime;
+        _y = _y + (l_vel * WHEEL_RADIUS + yaw_vel * ROBOT_WIDTH / 2.0) * sin(_yaw) * dtime;
+    }
+
+    Pose pose() const
+    {
+        Pose p = {_x, _y, _yaw};
+        return p;
+    }
+
+private:
+    float _l, _r, _yaw, _x, _y;
+};
+
+struct Segment
+{
+    double linear;   // m/s
+    double angular;  // rad/s
+    double duration; // s
+};
+
+/** Drive the route in closed form, @return encoder samples and the true pose at every sample */
+static void driveRoute(std::vector<Sample> & samples, std::vector<Pose> & truth)
+{
+    static const Segment loop[] = {
+        {0.8, 0.0, 25.0},        // straight
+        {0.5, 0.5, M_PI},        // 90 deg arc of 1 m radius
+        {0.3, -0.6, 4.0},        // tighter arc the other way
+        {0.0, 1.5, 2.0},         // turn in place
+        {1.0, 0.05, 20.0},       // long gentle curve
+        {-0.4, 0.0, 5.0},        // reverse
+        {0.6, -0.3, 2 * M_PI},   // wide turn
+    };
+    Pose p = {0, 0, 0};
+    double left = 0, right = 0, driven = 0, t = 0;
+    const double dt = ODOMETRY_PERIOD_MS * 1e-3;
+    Sample s = {0, {0, 0, 0, 0}};
+    samples.push_back(s);
+    truth.push_back(p);
+    for (int i = 0; driven < ROUTE_LENGTH_M; i = (i + 1) % (sizeof(loop) / sizeof(loop[0])))
+    {
+        const Segment & seg = loop[i];
+        for (double elapsed = 0; elapsed < seg.duration && driven < ROUTE_LENGTH_M; elapsed += dt)
+        {
+            for (int k = 0; k < SUBSTEPS; k++)
+            {
+                double h = dt / SUBSTEPS, ds = seg.linear * h, dyaw = seg.angular * h;
+                if (dyaw != 0.0)
+                {
+                    p.x += ds / dyaw * (sin(p.yaw + dyaw) - sin(p.yaw));
+                    p.y -= ds / dyaw * (cos(p.yaw + dyaw) - cos(p.yaw));
+                }
+                else
+                {
+                    p.x += ds * cos(p.yaw);
+                    p.y += ds * sin(p.yaw);
+                }
+                p.yaw += dyaw;
+                left += ds - dyaw * TRACK / 2;
+                right += ds + dyaw * TRACK / 2;
+                driven += fabs(ds);
+            }
+            t += dt;
+            // rear encoders lag the front ones by a fraction of a tick
+            s.timestamp_us = (uint32_t)llround(t * 1e6);
+            s.ticks[0] = (int32_t)floor(right / METERS_PER_TICK);
+            s.ticks[1] = (int32_t)floor(left / METERS_PER_TICK);
+            s.ticks[2] = (int32_t)floor(right / METERS_PER_TICK - 0.4);
+            s.ticks[3] = (int32_t)floor(left / METERS_PER_TICK - 0.4);
+            samples.push_back(s);
+            truth.push_back(p);
+        }
+    }
+}
+
+static bool readTrace(const char * path, std::vector<Sample> & samples)
+{
+    FILE * f = fopen(path, "r");
+    if (f == NULL)
+        return false;
+    Sample s;
+    while (fscanf(f, "%u %d %d %d %d", &s.timestamp_us, &s.ticks[0], &s.ticks[1], &s.ticks[2], &s.ticks[3]) == 5)
+        samples.push_back(s);
+    fclose(f);
+    return !samples.empty();
+}
+
+static double error(const Pose & a, const Pose & b)
+{
+    return hypot(a.x - b.x, a.y - b.y);
+}
+
+static Pose integratorPose(const OdometryIntegrator & odom)
+{
+    const OdometryPose & p = odom.getPose();
+    Pose pose = {p.x, p.y, p.yaw};
+    return pose;
+}
+
+int main(int argc, char ** argv)
+{
+    OdometryIntegrator odom;
+    odom.setGeometry(METERS_PER_TICK, TRACK);
+
+    // straight line, exact in ticks
+    odom.update(0, 0, 1, 0);
+    odom.update(10000, 10000, 1, 1000000);
+    const OdometryPose & p = odom.getPose();
+    check(fabs(p.x - 10000 * METERS_PER_TICK) < 1e-12 && p.y == 0.0 && p.yaw == 0.0, "straight segment");
+    check(fabs(p.linear_vel - 10000 * METERS_PER_TICK) < 1e-6 && p.angular_vel == 0.0f, "velocity over the sampling interval");
+    odom.setWheelSpeeds(0.3f, 0.5f);
+    check(fabs(p.linear_vel - 0.4f) < 1e-6 && fabs(p.angular_vel - 0.2f / TRACK) < 1e-5, "velocity of the measured wheel speeds");
+
+    // one full circle in 100 steps ends where it started
+    odom.reset();
+    odom.update(0, 0, 1, 0);
+    double circle = 2 * M_PI * TRACK / METERS_PER_TICK; // right side ticks with the left side standing
+    for (int i = 1; i <= 100; i++) odom.update(0, (int32_t)llround(circle * i / 100), 1, i * 20000);
+    check(error(integratorPose(odom), Pose{0, 0, 0}) < 2 * METERS_PER_TICK && fabs(p.yaw - 2 * M_PI) < 1e-3,
+          "full circle closes");
+
+    odom.reset();
+    odom.update(500, -500, 1, 0);
+    check(p.x == 0.0 && p.y == 0.0 && p.yaw == 0.0, "first update after reset latches the counts");
+
+    std::vector<Sample> samples;
+    std::vector<Pose> truth;
+    bool replay = argc > 1;
+    if (replay)
+    {
+        if (!readTrace(argv[1], samples))
+        {
+            printf("cannot read %s\r\n", argv[1]);
+            return 1;
+        }
+    }
+    else
+        driveRoute(samples, truth);
+
+    odom.reset();
+    LegacyOdometry legacy;
+    double legacy_max = 0, exact_max = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const Sample & s = samples[i];
+        odom.update(s.ticks[1] + s.ticks[3], s.ticks[0] + s.ticks[2], 2, s.timestamp_us);
+        if (i > 0)
+            legacy.update(s, (s.timestamp_us - samples[i - 1].timestamp_us) * 1e-6f);
+        if (!replay)
+        {
+            legacy_max = fmax(legacy_max, error(legacy.pose(), truth[i]));
+            exact_max = fmax(exact_max, error(integratorPose(odom), truth[i]));
+        }
+    }
+
+    Pose exact = integratorPose(odom), former = legacy.pose();
+    printf("samples: %zu, duration: %.0f s\r\n", samples.size(), (samples.back().timestamp_us - samples.front().timestamp_us) * 1e-6);
+    printf("exact arc: x %.4f y %.4f yaw %.5f\r\n", exact.x, exact.y, exact.yaw);
+    printf("legacy:    x %.4f y %.4f yaw %.5f\r\n", former.x, former.y, former.yaw);
+    if (!replay)
+    {
+        Pose end = truth.back();
+        printf("truth:     x %.4f y %.4f yaw %.5f\r\n", end.x, end.y, end.yaw);
+        printf("position error over %.0f m - exact arc: final %.4f m, max %.4f m; legacy: final %.4f m, max %.4f m\r\n",
+               ROUTE_LENGTH_M, error(exact, end), exact_max, error(former, end), legacy_max);
+        check(exact_max < 0.01, "exact arc integration stays within 1 cm over the route");
+        check(exact_max * 10 < legacy_max, "exact arc integration drifts an order of magnitude less");
+    }
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
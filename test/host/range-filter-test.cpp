@@ -0,0 +1,62 @@
+/** @file range-filter-test.cpp
+ * Test of the distance sensor range filter.
+ */
+#include <RangeFilter.h>
+#include <math.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+int main()
+{
+    RangeFilter filter;
+    bool passthrough = true;
+    for (int t = 0; t < 20; t++)
+    {
+        float range = 0.1f + 0.05f * (t % 7);
+        passthrough = passthrough && filter.update(range, 0.0f, t * 33) == range;
+    }
+    check(passthrough, "default parameters pass samples unchanged");
+
+    RangeFilterParams params = {5, 0.0f, 0.0f};
+    filter.setParams(params);
+    float out[10];
+    static const float spiky[10] = {0.5f, 0.5f, 0.5f, 3.0f, 0.5f, 0.5f, 0.02f, 0.5f, 0.5f, 0.5f};
+    bool flat = true;
+    for (int t = 0; t < 10; t++)
+    {
+        out[t] = filter.update(spiky[t], 1.0f, t * 33);
+        flat = flat && out[t] == 0.5f;
+    }
+    check(flat, "median window removes single spikes");
+
+    params.window = 3;
+    params.max_rate = 1.0f;
+    filter.setParams(params);
+    filter.update(0.5f, 1.0f, 0);
+    filter.update(0.5f, 1.0f, 100);
+    float step = filter.update(1.5f, 1.0f, 200);
+    step = filter.update(1.5f, 1.0f, 300);
+    check(fabsf(step - 0.6f) < 1e-4f, "rate of change is limited");
+
+    params.max_rate = 0.0f;
+    params.min_confidence = 0.5f;
+    filter.setParams(params);
+    check(filter.update(0.8f, 0.2f, 0) < 0.0f, "low confidence sample is rejected");
+    check(filter.update(0.8f, 0.9f, 33) == 0.8f, "confident sample is accepted");
+
+    check(RangeFilter::confidence(4, 10.0f, 0.0f) == 0.0f, "invalid range status has no confidence");
+    check(RangeFilter::confidence(11, 10.0f, 0.0f) == 1.0f, "strong signal without ambient light has full confidence");
+    check(RangeFilter::confidence(11, 10.0f, 10.0f) < RangeFilter::confidence(11, 10.0f, 1.0f), "ambient light lowers confidence");
+    check(RangeFilter::confidence(11, 0.2f, 0.0f) < RangeFilter::confidence(11, 0.8f, 0.0f), "weak signal lowers confidence");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,95 @@
+/** @file regulator-bank-bench.cpp
+ * Per-tick cost of the four wheel regulator: four virtual RosbotRegulatorCMSIS instances
+ * against one RosbotRegulatorBank4, and the cost of the feed-forward law of the bank.
+ *
+ * Usage: regulator-bank-bench [ticks]
+ */
+#include <chrono>
+#include <RosbotDrive.h>
+#include "RosbotRegulatorCMSIS.h"
+#include "RosbotRegulatorBank4.h"
+
+#define DEFAULT_TICKS 2000000
+
+#define TRACE_LENGTH 4096
+
+/** Inputs of the regulators recorded from a simple first order wheel model, replayed by the benchmark. */
+struct Trace
+{
+    float setpoint[TRACE_LENGTH][4];
+    float feedback[TRACE_LENGTH][4];
+
+    void record(const RosbotRegulator_params & params)
+    {
+        RosbotRegulatorCMSIS regulator(params);
+        float speed = 0.0f;
+        for (int t = 0; t < TRACE_LENGTH; t++)
+        {
+            // steps between a few speeds in both directions, with stops
+            static const float targets[8] = {0.0f, 0.5f, 0.5f, -0.3f, 0.0f, 0.05f, 1.0f, -1.0f};
+            for (int i = 0; i < 4; i++)
+            {
+                setpoint[t][i] = targets[((t >> 8) + i) & 7];
+                feedback[t][i] = speed + 0.01f * i;
+            }
+            speed += 0.05f * (regulator.updateState(setpoint[t][0], speed) * 1.25f - speed);
+        }
+    }
+};
+
+template <typename Step>
+static double run(const Trace & trace, uint32_t ticks, Step step, float & checksum)
+{
+    float out[4];
+    double acc = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < ticks; t++)
+    {
+        uint32_t k = t % TRACE_LENGTH;
+        step(trace.setpoint[k], trace.feedback[k], out);
+        acc += out[0] + out[1] + out[2] + out[3];
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    checksum = (float)acc;
+    return ns / ticks;
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t ticks = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_TICKS;
+    const RosbotRegulator_params & params = RosbotDrive::DEFAULT_REGULATOR_PARAMS;
+
+    RosbotRegulator * regulator[4];
+    for (int i = 0; i < 4; i++) regulator[i] = new RosbotRegulatorCMSIS(params);
+    static RosbotRegulatorBank4 bank;
+    bank.updateParams(params);
+    static Trace trace;
+    trace.record(params);
+
+    float checksum_virtual, checksum_bank;
+    double ns_virtual = run(trace, ticks, [&](const float * sp, const float * fb, float * out) {
+        for (int i = 0; i < 4; i++) out[i] = regulator[i]->updateState(sp[i], fb[i]);
+    }, checksum_virtual);
+    double ns_bank = run(trace, ticks, [&](const float * sp, const float * fb, float * out) {
+        bank.updateState(sp, fb, out);
+    }, checksum_bank);
+
+    printf("%-28s %10s %12s\r\n", "regulator", "ns/tick", "checksum");
+    printf("%-28s %10.1f %12.4f\r\n", "4x RosbotRegulatorCMSIS", ns_virtual, checksum_virtual);
+    printf("%-28s %10.1f %12.4f\r\n", "RosbotRegulatorBank4", ns_bank, checksum_bank);
+    printf("speedup %.2fx, outputs %s\r\n", ns_virtual / ns_bank, checksum_virtual == checksum_bank ? "identical" : "DIFFER");
+
+    RosbotRegulator_params ff_params = params;
+    ff_params.type = REGULATOR_FEEDFORWARD;
+    static RosbotRegulatorBank4 ff_bank;
+    ff_bank.updateParams(ff_params);
+
+    float checksum_ff_bank;
+    double ns_ff_bank = run(trace, ticks, [&](const float * sp, const float * fb, float * out) {
+        ff_bank.updateState(sp, fb, out);
+    }, checksum_ff_bank);
+    printf("%-28s %10.1f %12.4f\r\n", "RosbotRegulatorBank4 FF", ns_ff_bank, checksum_ff_bank);
+
+    for (int i = 0; i < 4; i++) delete regulator[i];
+    return checksum_virtual == checksum_bank ? 0 : 1;
+}
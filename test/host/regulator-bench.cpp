@@ -0,0 +1,99 @@
+/** @file regulator-bench.cpp
+ * PID parameters sweep against the simulated drive train.
+ *
+ * Usage: regulator-bench [kp_list] [ki_list] [kd_list] [target]
+ * Lists are comma separated, e.g. regulator-bench 0.6,0.8,1.0 0.1,0.2 0.015 0.5
+ */
+#include <RosbotDrive.h>
+#include <chrono>
+#include <vector>
+#include "RosbotPlant.h"
+#include "StepResponse.h"
+
+#define SAMPLE_INTERVAL_US 1000
+#define REGULATOR_THREAD_ID 0
+
+static std::vector<float> parseList(const char * str, float def)
+{
+    std::vector<float> out;
+    if (str == nullptr)
+    {
+        out.push_back(def);
+        return out;
+    }
+    char buffer[256];
+    strncpy(buffer, str, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = 0;
+    for (char * token = strtok(buffer, ","); token != NULL; token = strtok(NULL, ","))
+        out.push_back(strtof(token, NULL));
+    return out;
+}
+
+static host::StepMetrics runCase(RosbotDrive & drive, float target, host::SliceStats & stats)
+{
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+
+    // settle at rest
+    NewTargetSpeed speed = {{0.0f, 0.0f, 0.0f, 0.0f}, MPS};
+    drive.updateTargetSpeed(speed);
+    kernel.runFor(1000000);
+
+    host::SliceStats before = kernel.getSliceStats(REGULATOR_THREAD_ID);
+    float t_step = kernel.now() * 1e-6f;
+    host::StepRecorder recorder(t_step, 0.0f, target);
+    for (int i = 0; i < 4; i++) speed.speed[i] = target;
+    drive.updateTargetSpeed(speed);
+    while (kernel.now() * 1e-6f < t_step + 2.0f)
+    {
+        kernel.runFor(SAMPLE_INTERVAL_US);
+        recorder.add(kernel.now() * 1e-6f, plant.getWheelSpeed(MOTOR1), plant.getDuty(MOTOR1));
+    }
+    stats = kernel.getSliceStats(REGULATOR_THREAD_ID);
+    stats.slices -= before.slices;
+    stats.total_ns -= before.total_ns;
+    return recorder.analyze();
+}
+
+int main(int argc, char ** argv)
+{
+    std::vector<float> kp = parseList(argc > 1 ? argv[1] : nullptr, RosbotDrive::DEFAULT_REGULATOR_PARAMS.kp);
+    std::vector<float> ki = parseList(argc > 2 ? argv[2] : nullptr, RosbotDrive::DEFAULT_REGULATOR_PARAMS.ki);
+    std::vector<float> kd = parseList(argc > 3 ? argv[3] : nullptr, RosbotDrive::DEFAULT_REGULATOR_PARAMS.kd);
+    float target = argc > 4 ? strtof(argv[4], NULL) : 0.5f;
+
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    host::PlantGeometry geometry = host::RosbotPlant::DEFAULT_GEOMETRY;
+    geometry.wiring = RosbotDrive::DEFAULT_WHEEL_PARAMS.polarity;
+    plant.configure(geometry);
+    plant.attach();
+    drive.init(RosbotDrive::DEFAULT_WHEEL_PARAMS, RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+    drive.enable(true);
+    drive.enablePidReg(true);
+
+    printf("%6s %6s %6s | %10s %10s %10s %10s %10s | %10s %10s\r\n",
+           "kp", "ki", "kd", "latency", "rise", "settling", "overshoot", "rms", "iter_ns", "iter/s");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (float p : kp)
+        for (float i : ki)
+            for (float d : kd)
+            {
+                RosbotRegulator_params params = RosbotDrive::DEFAULT_REGULATOR_PARAMS;
+                params.kp = p;
+                params.ki = i;
+                params.kd = d;
+                drive.updatePidParams(params);
+
+                host::SliceStats stats;
+                host::StepMetrics m = runCase(drive, target, stats);
+                double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                uint64_t iterations = kernel.getSliceStats(REGULATOR_THREAD_ID).slices;
+                printf("%6.3f %6.3f %6.3f | %8.1fms %8.1fms %8.1fms %9.1f%% %10.4f | %10.0f %10.0f\r\n",
+                       p, i, d, m.latency * 1e3f, m.rise_time * 1e3f, m.settling_time * 1e3f, m.overshoot * 100.0f,
+                       m.rms_error, stats.slices ? stats.total_ns / stats.slices : 0.0, iterations / wall);
+            }
+    return 0;
+}
@@ -0,0 +1,359 @@
+/** @file regulator-sim-test.cpp
+ * Closed-loop test of RosbotDrive running against the simulated drive train.
+ */
+#include <RosbotDrive.h>
+#include <Profiler.h>
+#include "RosbotPlant.h"
+#include "StepResponse.h"
+
+#define SAMPLE_INTERVAL_US 1000
+#define REGULATOR_THREAD_ID 0 // the regulator is the only simulated thread
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+static void runStep(RosbotDrive & drive, float target, float duration, host::StepRecorder * recorder)
+{
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+    NewTargetSpeed speed = {{target, target, target, target}, MPS};
+    float t0 = kernel.now() * 1e-6f;
+    drive.updateTargetSpeed(speed);
+    while (kernel.now() * 1e-6f < t0 + duration)
+    {
+        kernel.runFor(SAMPLE_INTERVAL_US);
+        for (int i = 0; i < 4; i++)
+            recorder[i].add(kernel.now() * 1e-6f, plant.getWheelSpeed(i), plant.getDuty(i));
+    }
+}
+
+/** Run constant low speed and return rms error of the speed estimate, of the tracking and the duty ripple. */
+static void runLowSpeed(RosbotDrive & drive, float target, float & estimate_rms, float & tracking_rms, float & duty_ripple)
+{
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+    NewTargetSpeed speed = {{target, target, target, target}, MPS};
+    drive.updateTargetSpeed(speed);
+    kernel.runFor(1000000);
+    double estimate_acc = 0.0, tracking_acc = 0.0, duty_acc = 0.0, duty_sq_acc = 0.0;
+    int n = 0;
+    for (; n < 2000; n++)
+    {
+        kernel.runFor(SAMPLE_INTERVAL_US);
+        float real = plant.getWheelSpeed(MOTOR1);
+        float duty = plant.getDuty(MOTOR1);
+        estimate_acc += (drive.getSpeed(MOTOR1) - real) * (drive.getSpeed(MOTOR1) - real);
+        tracking_acc += (real - target) * (real - target);
+        duty_acc += duty;
+        duty_sq_acc += duty * duty;
+    }
+    estimate_rms = sqrt(estimate_acc / n);
+    tracking_rms = sqrt(tracking_acc / n);
+    duty_ripple = sqrt(duty_sq_acc / n - (duty_acc / n) * (duty_acc / n));
+}
+
+int main()
+{
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+    RosbotDrive & drive = RosbotDrive::getInstance();
+
+    host::PlantGeometry geometry = host::RosbotPlant::DEFAULT_GEOMETRY;
+    geometry.wiring = RosbotDrive::DEFAULT_WHEEL_PARAMS.polarity;
+    plant.configure(geometry);
+    plant.attach();
+
+    drive.setupMotorSequence(MOTOR1, MOTOR4, MOTOR2, MOTOR3);
+    drive.init(RosbotDrive::DEFAULT_WHEEL_PARAMS, RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+    drive.enable(true);
+    drive.enablePidReg(true);
+
+    kernel.runFor(200000);
+    bool idle = true;
+    for (int i = 0; i < 4; i++) idle = idle && plant.getWheelSpeed(i) == 0.0f && drive.getSpeed((RosbotMotNum)i) == 0.0f;
+    check(idle, "wheels stay still without a target speed");
+
+    kernel.resetSliceStats();
+    float t_step = kernel.now() * 1e-6f;
+    host::StepRecorder up[4] = {{t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}};
+    runStep(drive, 0.5f, 1.5f, up);
+
+    for (int i = 0; i < 4; i++)
+    {
+        host::StepMetrics m = up[i].analyze();
+        printf("MOTOR%d 0 -> 0.5 m/s: latency %.1f ms, rise %.1f ms, settling %.1f ms, overshoot %.1f %%, rms error %.4f m/s\r\n",
+               i + 1, m.latency * 1e3f, m.rise_time * 1e3f, m.settling_time * 1e3f, m.overshoot * 100.0f, m.rms_error);
+        check(m.latency >= 0.0f && m.latency <= 0.02f, "regulator responds within two periods");
+        check(m.settling_time > 0.0f && m.settling_time < 0.8f, "speed settles within 800 ms");
+        check(m.overshoot < 0.1f, "overshoot below 10%");
+        check(m.rms_error < 0.02f, "steady state rms error below 0.02 m/s");
+        check(fabs(drive.getSpeed((RosbotMotNum)i) - 0.5f) < 0.05f, "measured speed follows the plant");
+    }
+
+    host::SliceStats stats = kernel.getSliceStats(REGULATOR_THREAD_ID);
+    printf("regulator: %llu iterations, mean %.0f ns, max %.0f ns per iteration\r\n",
+           (unsigned long long)stats.slices, stats.slices ? stats.total_ns / stats.slices : 0.0, stats.max_ns);
+    check(stats.slices >= 149 && stats.slices <= 151, "regulator runs at 100 Hz");
+
+    RegulatorTimingStats timing;
+    drive.getTimingStats(timing);
+    printf("regulator timing: %lu iterations, %lu overruns, jitter mean %.1f us max %lu us, exec max %lu us\r\n",
+           (unsigned long)timing.iterations, (unsigned long)timing.overruns, timing.jitter_mean_us,
+           (unsigned long)timing.jitter_max_us, (unsigned long)timing.exec_max_us);
+    check(timing.iterations == kernel.now() / 10000, "regulator releases follow the absolute 10 ms schedule");
+    check(timing.overruns == 0, "no regulator overruns");
+
+    ProfilerProbe probe;
+    check(Profiler::getStats(0, probe) && strcmp(probe.name, "regulator") == 0 && probe.count == timing.iterations,
+          "regulator probe records every iteration");
+
+    DriveStateSnapshot state;
+    drive.getDriveState(state);
+    bool coherent = state.sequence == timing.iterations + 1; // +1 - state published by init()
+    for (int i = 0; i < 4; i++)
+    {
+        int32_t ticks = plant.getTicks(i);
+        coherent = coherent && state.ticks[i] == ((RosbotDrive::DEFAULT_WHEEL_PARAMS.polarity >> (i + 4)) & 1 ? -ticks : ticks);
+        coherent = coherent && state.ticks[i] == drive.getEncoderTicks((RosbotMotNum)i);
+        coherent = coherent && state.cspeed_mps[i] == drive.getSpeed((RosbotMotNum)i);
+        coherent = coherent && state.tspeed_mps[i] == 0.5f;
+        coherent = coherent && state.pidout[i] == plant.getDuty(i);
+    }
+    check(coherent, "drive state snapshot matches the last regulator iteration");
+
+    t_step = kernel.now() * 1e-6f;
+    host::StepRecorder down[4] = {{t_step, 0.5f, 0.0f}, {t_step, 0.5f, 0.0f}, {t_step, 0.5f, 0.0f}, {t_step, 0.5f, 0.0f}};
+    runStep(drive, 0.0f, 1.0f, down);
+    bool stopped = true;
+    for (int i = 0; i < 4; i++) stopped = stopped && fabs(plant.getWheelSpeed(i)) < 0.01f;
+    check(stopped, "wheels stop after zero target");
+
+    float estimate[2], tracking[2], ripple[2];
+    const SpeedEstimator estimators[2] = {TICK_DELTA, EDGE_PERIOD};
+    const char * names[2] = {"TICK_DELTA", "EDGE_PERIOD"};
+    for (float target : {0.03f, 0.01f})
+    {
+        for (int e = 0; e < 2; e++)
+        {
+            drive.setSpeedEstimator(estimators[e]);
+            runLowSpeed(drive, target, estimate[e], tracking[e], ripple[e]);
+            printf("%.2f m/s %s: estimate rms %.5f m/s, tracking rms %.5f m/s, duty ripple %.4f\r\n",
+                   target, names[e], estimate[e], tracking[e], ripple[e]);
+        }
+        check(estimate[1] < 0.5f * estimate[0], "EDGE_PERIOD estimator is more accurate at low speed");
+        check(ripple[1] < ripple[0], "EDGE_PERIOD estimator reduces regulator output ripple at low speed");
+        check(tracking[1] < 1.1f * tracking[0], "EDGE_PERIOD estimator keeps low speed tracking");
+    }
+    drive.setSpeedEstimator(TICK_DELTA);
+
+    // 1 kHz regulator: the acceleration ramp and the gains are period independent
+    runStep(drive, 0.0f, 1.0f, down);
+    RosbotRegulator_params params = RosbotDrive::DEFAULT_REGULATOR_PARAMS;
+    params.dt_us = 1000;
+    drive.updatePidParams(params);
+    drive.getPidParams(params);
+    check(params.dt_us == 1000, "regulator period set to 1000 us");
+    host::SliceStats before = kernel.getSliceStats(REGULATOR_THREAD_ID);
+    t_step = kernel.now() * 1e-6f;
+    host::StepRecorder fast[4] = {{t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}};
+    runStep(drive, 0.5f, 1.5f, fast);
+    stats = kernel.getSliceStats(REGULATOR_THREAD_ID);
+    host::StepMetrics m10 = up[0].analyze();
+    host::StepMetrics m1 = fast[0].analyze();
+    printf("MOTOR1 0 -> 0.5 m/s at 1 kHz: latency %.1f ms, rise %.1f ms, settling %.1f ms, overshoot %.1f %%, rms error %.4f m/s\r\n",
+           m1.latency * 1e3f, m1.rise_time * 1e3f, m1.settling_time * 1e3f, m1.overshoot * 100.0f, m1.rms_error);
+    check(stats.slices - before.slices >= 1499 && stats.slices - before.slices <= 1501, "regulator runs at 1 kHz");
+    check(m1.latency >= 0.0f && m1.latency <= 0.002f, "1 kHz regulator responds within two periods");
+    check(fabs(m1.rise_time - m10.rise_time) < 0.1f * m10.rise_time, "acceleration limit does not depend on the regulator period");
+    check(m1.settling_time > 0.0f && m1.settling_time < 0.8f, "speed settles within 800 ms at 1 kHz");
+    check(m1.overshoot < 0.1f, "overshoot below 10% at 1 kHz");
+    check(m1.rms_error < 0.02f, "steady state rms error below 0.02 m/s at 1 kHz");
+    runStep(drive, 0.0f, 1.0f, down);
+    drive.updatePidParams(RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+
+    // odometry integrated by the regulator on its own encoder samples
+    DriveOdometryParams odometry = {{MOTOR3, MOTOR4}, {MOTOR1, MOTOR2}, 0.2378f};
+    drive.enableOdometry(odometry);
+    DriveStateSnapshot start;
+    drive.getDriveState(start);
+    runStep(drive, 0.4f, 1.0f, up);
+    drive.getDriveState(state);
+    const RosbotWheel & wheel = RosbotDrive::DEFAULT_WHEEL_PARAMS;
+    double meters_per_tick = 2 * M_PI * wheel.radius / (wheel.gear_ratio * wheel.encoder_cpr * wheel.tyre_deflation);
+    double driven = 0.0;
+    for (int i = 0; i < 4; i++) driven += (state.ticks[i] - start.ticks[i]) * meters_per_tick / 4;
+    printf("odometry: x %.4f m, y %.4f m, yaw %.5f rad, %.3f m/s after %.4f m\r\n", state.odometry.x, state.odometry.y,
+           state.odometry.yaw, state.odometry.linear_vel, driven);
+    check(state.odometry.timestamp_us == state.timestamp_us, "odometry is integrated on every regulator encoder sample");
+    check(fabs(state.odometry.x - driven) < 1e-3 && fabs(state.odometry.yaw) < 0.01, "odometry follows the encoders");
+    check(fabs(state.odometry.linear_vel - 0.4f) < 0.05f, "odometry velocity follows the wheels");
+    float mean_speed = 0.0f;
+    for (int i = 0; i < 4; i++) mean_speed += state.cspeed_mps[i] / 4;
+    check(fabs(state.odometry.linear_vel - mean_speed) < 1e-5f, "odometry velocity is the windowed wheel speed");
+    runStep(drive, 0.0f, 1.0f, down);
+    drive.resetDistance();
+    drive.getDriveState(state);
+    check(state.odometry.x == 0.0 && state.odometry.yaw == 0.0, "odometry is reset with the distance");
+    drive.disableOdometry();
+
+    // feed-forward regulator: saturated by a load and an unreachable target, then back in range
+    params = RosbotDrive::DEFAULT_REGULATOR_PARAMS;
+    params.type = REGULATOR_FEEDFORWARD;
+    drive.updatePidParams(params);
+    t_step = kernel.now() * 1e-6f;
+    host::StepRecorder ff[4] = {{t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}};
+    runStep(drive, 0.5f, 1.5f, ff);
+    host::StepMetrics mff = ff[0].analyze();
+    printf("MOTOR1 0 -> 0.5 m/s feed-forward: rise %.1f ms, settling %.1f ms, overshoot %.1f %%, rms error %.4f m/s\r\n",
+           mff.rise_time * 1e3f, mff.settling_time * 1e3f, mff.overshoot * 100.0f, mff.rms_error);
+    check(mff.settling_time > 0.0f && mff.settling_time < 0.5f && mff.overshoot < 0.1f, "feed-forward regulator settles without overshoot");
+    check(mff.rms_error < up[0].analyze().rms_error, "feed-forward regulator tracks closer than the incremental one");
+    float recovery[2];
+    for (int t = 0; t < 2; t++)
+    {
+        params.type = t ? REGULATOR_FEEDFORWARD : REGULATOR_INCREMENTAL;
+        drive.updatePidParams(params);
+        for (int i = 0; i < 4; i++) plant.setLoad(i, 0.3f);
+        runStep(drive, 1.0f, 1.5f, up);
+        t_step = kernel.now() * 1e-6f;
+        host::StepRecorder windup[4] = {{t_step, plant.getWheelSpeed(0), 0.5f}, {t_step, plant.getWheelSpeed(1), 0.5f},
+                                        {t_step, plant.getWheelSpeed(2), 0.5f}, {t_step, plant.getWheelSpeed(3), 0.5f}};
+        runStep(drive, 0.5f, 1.5f, windup);
+        recovery[t] = windup[0].analyze().settling_time;
+        for (int i = 0; i < 4; i++) plant.setLoad(i, 0.0f);
+        runStep(drive, 0.0f, 1.0f, down);
+    }
+    if (recovery[0] < 0.0f)
+        printf("saturated -> 0.5 m/s settling: incremental did not settle, feed-forward %.1f ms\r\n", recovery[1] * 1e3f);
+    else
+        printf("saturated -> 0.5 m/s settling: incremental %.1f ms, feed-forward %.1f ms\r\n", recovery[0] * 1e3f, recovery[1] * 1e3f);
+    check(recovery[1] > 0.0f && recovery[1] < 0.6f && (recovery[0] < 0.0f || recovery[0] > recovery[1]), "feed-forward regulator does not wind up");
+    drive.updatePidParams(RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+
+    // blocked wheel: static friction above the saturated output
+    TractionParams traction = TractionMonitor::DEFAULT_PARAMS;
+    traction.actions = TRACTION_CUT_STALL;
+    drive.setTractionParams(traction);
+    drive.resetTractionStats();
+    host::MotorModel blocked = host::RosbotPlant::DEFAULT_MOTOR_MODEL;
+    blocked.friction_duty = 1.0f;
+    plant.setMotorModel(MOTOR2, blocked);
+    runStep(drive, 0.3f, 1.5f, up);
+    TractionStats traction_stats;
+    drive.getTractionStats(traction_stats);
+    drive.getDriveState(state);
+    printf("traction: MOTOR2 stall events %lu, duty %.2f\r\n", (unsigned long)traction_stats.wheel[MOTOR2].stall_events, plant.getDuty(MOTOR2));
+    check(traction_stats.wheel[MOTOR2].stalled && traction_stats.wheel[MOTOR2].stall_events == 1, "blocked wheel is detected as stalled");
+    check(state.traction == 1 << (MOTOR2 + 4), "stall is published in the drive state");
+    check(plant.getDuty(MOTOR2) == 0.0f && fabs(plant.getWheelSpeed(MOTOR1) - 0.3f) < 0.02f, "stalled wheel is switched off, the others drive on");
+    runStep(drive, 0.0f, 0.5f, down);
+    plant.setMotorModel(MOTOR2, host::RosbotPlant::DEFAULT_MOTOR_MODEL);
+    runStep(drive, 0.3f, 1.0f, up);
+    drive.getTractionStats(traction_stats);
+    check(!traction_stats.wheel[MOTOR2].stalled && fabs(plant.getWheelSpeed(MOTOR2) - 0.3f) < 0.02f, "stop command releases the wheel");
+    runStep(drive, 0.0f, 1.0f, down);
+    drive.setTractionParams(TractionMonitor::DEFAULT_PARAMS);
+
+    // auto-tuning of the lifted robot, the plant wheels turn freely
+    MotorTunerParams tuning = MotorTuner::DEFAULT_PARAMS;
+    MotorTunerResult tuned;
+    check(drive.startTuning(tuning) && !drive.applyTuning(), "gains are not applied before the experiment ends");
+    kernel.runFor(tuning.level_us);
+    runStep(drive, 0.5f, 0.1f, up);
+    check(fabs(plant.getDuty(MOTOR1) - tuning.duty_high) < 1e-6f, "target speed is ignored during the experiment");
+    kernel.runFor(3 * tuning.level_us);
+    check(drive.getTuningResult(tuned) == TUNER_DONE, "experiment ends");
+    kernel.runFor(1000000);
+    check(fabs(plant.getWheelSpeed(MOTOR1)) < 0.01f, "regulator stops the wheels after the experiment");
+    printf("tuning: gain %.3f offset %.3f time constant %.1f ms dead time %.1f ms -> kp %.3f ki %.3f kv %.3f ks %.3f ka %.3f\r\n",
+           tuned.model.gain, tuned.model.offset, tuned.model.time_constant * 1e3f, tuned.model.dead_time * 1e3f,
+           tuned.kp, tuned.ki, tuned.kv, tuned.ks, tuned.ka);
+    check(fabs(tuned.model.gain - 1.5f) < 0.1f && fabs(tuned.model.time_constant - 0.08f) < 0.02f, "drive model is identified");
+    check(drive.applyTuning(), "identified gains are applied");
+    drive.getPidParams(params);
+    params.type = REGULATOR_FEEDFORWARD;
+    drive.updatePidParams(params);
+    t_step = kernel.now() * 1e-6f;
+    host::StepRecorder at[4] = {{t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}, {t_step, 0.0f, 0.5f}};
+    runStep(drive, 0.5f, 1.5f, at);
+    host::StepMetrics mat = at[0].analyze();
+    printf("MOTOR1 0 -> 0.5 m/s tuned feed-forward: rise %.1f ms, settling %.1f ms, overshoot %.1f %%, rms error %.4f m/s\r\n",
+           mat.rise_time * 1e3f, mat.settling_time * 1e3f, mat.overshoot * 100.0f, mat.rms_error);
+    check(mat.settling_time > 0.0f && mat.settling_time < 0.5f && mat.overshoot < 0.1f, "tuned regulator settles without overshoot");
+    runStep(drive, 0.0f, 1.0f, down);
+    check(drive.startTuning(tuning), "experiment restarts");
+    kernel.runFor(tuning.level_us / 2);
+    drive.stopTuning();
+    kernel.runFor(1000000);
+    check(drive.getTuningResult(tuned) == TUNER_FAILED && fabs(plant.getWheelSpeed(MOTOR1)) < 0.01f, "stopped experiment stops the wheels");
+    drive.updatePidParams(RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+
+    // arc from standstill with per-wheel ramps and with the body velocity profile
+    DriveProfileParams arc_profile = {{MOTOR4, MOTOR3}, {MOTOR1, MOTOR2}, 0.1075f, VelocityProfiler::DEFAULT_LIMITS};
+    const float linear = 0.4f, angular = 1.5f;
+    float curvature_error[2], acc_max[2];
+    for (int p = 0; p < 2; p++)
+    {
+        if (p)
+        {
+            drive.enableProfile(arc_profile);
+            drive.updateTargetVelocity(linear, angular);
+        }
+        else
+        {
+            float left = linear - angular * arc_profile.half_track, right = linear + angular * arc_profile.half_track;
+            NewTargetSpeed arc = {{right, right, left, left}, MPS};
+            drive.updateTargetSpeed(arc);
+        }
+        curvature_error[p] = acc_max[p] = 0.0f;
+        float speed_prev = 0.0f;
+        for (int n = 0; n < 1000; n++)
+        {
+            kernel.runFor(SAMPLE_INTERVAL_US);
+            float left = 0.5f * (plant.getWheelSpeed(MOTOR3) + plant.getWheelSpeed(MOTOR4));
+            float right = 0.5f * (plant.getWheelSpeed(MOTOR1) + plant.getWheelSpeed(MOTOR2));
+            float v = 0.5f * (left + right);
+            if (v > 0.05f)
+                curvature_error[p] = fmaxf(curvature_error[p], fabsf((right - left) / (2.0f * arc_profile.half_track * v) - angular / linear));
+            // acceleration of the outer wheel over regulator periods
+            if (n % 10 == 9)
+            {
+                acc_max[p] = fmaxf(acc_max[p], fabsf(plant.getWheelSpeed(MOTOR1) - speed_prev) / 0.01f);
+                speed_prev = plant.getWheelSpeed(MOTOR1);
+            }
+        }
+        drive.getDriveState(state);
+        printf("arc %s: curvature error %.3f 1/m, outer wheel acceleration max %.2f m/s^2, targets %.3f %.3f m/s\r\n", p ? "profiled" : "per-wheel ramps",
+               curvature_error[p], acc_max[p], state.tspeed_mps[MOTOR4], state.tspeed_mps[MOTOR1]);
+        check(fabs(state.tspeed_mps[MOTOR4] - 0.23875f) < 1e-4f && fabs(state.tspeed_mps[MOTOR1] - 0.56125f) < 1e-4f, "arc targets are reached");
+        NewTargetSpeed halt = {{0.0f, 0.0f, 0.0f, 0.0f}, MPS};
+        if (p)
+            drive.updateTargetVelocity(0.0f, 0.0f);
+        else
+            drive.updateTargetSpeed(halt);
+        kernel.runFor(1500000);
+    }
+    check(curvature_error[1] < 0.5f * curvature_error[0], "profiled arc keeps the curvature during the acceleration");
+    check(acc_max[1] < acc_max[0], "profiled arc lowers the peak wheel acceleration");
+    stopped = true;
+    for (int i = 0; i < 4; i++) stopped = stopped && fabs(plant.getWheelSpeed(i)) < 0.01f;
+    check(stopped, "profiled stop");
+    drive.updateTargetVelocity(linear, angular);
+    kernel.runFor(100000);
+    drive.disableProfile();
+    kernel.runFor(20000);
+    drive.getDriveState(state);
+    check(fabs(state.tspeed_mps[MOTOR4] - 0.23875f) < 1e-4f && fabs(state.tspeed_mps[MOTOR1] - 0.56125f) < 1e-4f, "profile disabled during the ramp leaves the last target");
+    NewTargetSpeed halt = {{0.0f, 0.0f, 0.0f, 0.0f}, MPS};
+    drive.updateTargetSpeed(halt);
+    kernel.runFor(1000000);
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
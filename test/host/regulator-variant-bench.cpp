@@ -0,0 +1,110 @@
+/** @file regulator-variant-bench.cpp
+ * Step responses of the incremental and the feed-forward wheel regulators of RosbotRegulatorBank4,
+ * the regulator the firmware runs, against the simulated drive train.
+ *
+ * Every case holds a speed before the step, optionally under a constant load. The last case
+ * asks for more than the saturated output can give before the step, so the regulator winds up.
+ *
+ * Usage: regulator-variant-bench [kp] [ki] [kd]
+ */
+#include <RosbotDrive.h>
+#include "RosbotPlant.h"
+#include "StepResponse.h"
+
+#define SAMPLE_INTERVAL_US 1000
+#define HOLD_S 1.5f
+#define STEP_S 2.0f
+
+struct BenchCase
+{
+    const char * name;
+    float load;    // equivalent duty on every wheel
+    float initial; // speed held before the step [m/s]
+    float target;  // [m/s]
+};
+
+static const BenchCase cases[] = {
+    {"0 -> 0.5", 0.0f, 0.0f, 0.5f},
+    {"0 -> 1.0", 0.0f, 0.0f, 1.0f},
+    {"0 -> 0.5 loaded", 0.3f, 0.0f, 0.5f},
+    {"0.5 -> -0.5", 0.0f, 0.5f, -0.5f},
+    {"saturated -> 0.5", 0.3f, 1.0f, 0.5f},
+};
+
+static void hold(RosbotDrive & drive, float speed, float duration)
+{
+    NewTargetSpeed target = {{speed, speed, speed, speed}, MPS};
+    drive.updateTargetSpeed(target);
+    host::SimKernel::instance().runFor((uint64_t)(duration * 1e6f));
+}
+
+/** Time in ms, a response that never crossed the level has no time. */
+static const char * formatTime(char * buffer, size_t size, float time)
+{
+    if (time < 0.0f)
+        snprintf(buffer, size, "unsettled");
+    else
+        snprintf(buffer, size, "%.1fms", time * 1e3f);
+    return buffer;
+}
+
+static host::StepMetrics runCase(RosbotDrive & drive, const BenchCase & c)
+{
+    host::SimKernel & kernel = host::SimKernel::instance();
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+
+    hold(drive, 0.0f, 1.0f);
+    for (int i = 0; i < 4; i++) plant.setLoad(i, c.load);
+    if (c.initial != 0.0f)
+        hold(drive, c.initial, HOLD_S);
+
+    float t_step = kernel.now() * 1e-6f;
+    host::StepRecorder recorder(t_step, plant.getWheelSpeed(MOTOR1), c.target);
+    NewTargetSpeed target = {{c.target, c.target, c.target, c.target}, MPS};
+    drive.updateTargetSpeed(target);
+    while (kernel.now() * 1e-6f < t_step + STEP_S)
+    {
+        kernel.runFor(SAMPLE_INTERVAL_US);
+        recorder.add(kernel.now() * 1e-6f, plant.getWheelSpeed(MOTOR1), plant.getDuty(MOTOR1));
+    }
+    hold(drive, 0.0f, 1.0f);
+    for (int i = 0; i < 4; i++) plant.setLoad(i, 0.0f);
+    return recorder.analyze();
+}
+
+int main(int argc, char ** argv)
+{
+    host::RosbotPlant & plant = host::RosbotPlant::instance();
+    RosbotDrive & drive = RosbotDrive::getInstance();
+    host::PlantGeometry geometry = host::RosbotPlant::DEFAULT_GEOMETRY;
+    geometry.wiring = RosbotDrive::DEFAULT_WHEEL_PARAMS.polarity;
+    plant.configure(geometry);
+    plant.attach();
+    drive.init(RosbotDrive::DEFAULT_WHEEL_PARAMS, RosbotDrive::DEFAULT_REGULATOR_PARAMS);
+    drive.enable(true);
+    drive.enablePidReg(true);
+
+    printf("%-12s %-18s | %10s %10s %10s %10s\r\n", "regulator", "case", "rise", "settling", "overshoot", "rms");
+    const char * names[2] = {"incremental", "feedforward"};
+    const RosbotRegulatorType types[2] = {REGULATOR_INCREMENTAL, REGULATOR_FEEDFORWARD};
+    for (int t = 0; t < 2; t++)
+    {
+        RosbotRegulator_params params = RosbotDrive::DEFAULT_REGULATOR_PARAMS;
+        params.type = types[t];
+        if (argc > 1 && types[t] == REGULATOR_FEEDFORWARD)
+        {
+            params.kp = strtof(argv[1], NULL);
+            params.ki = argc > 2 ? strtof(argv[2], NULL) : params.ki;
+            params.kd = argc > 3 ? strtof(argv[3], NULL) : params.kd;
+        }
+        drive.updatePidParams(params);
+        for (const BenchCase & c : cases)
+        {
+            host::StepMetrics m = runCase(drive, c);
+            char rise[16], settling[16];
+            printf("%-12s %-18s | %10s %10s %9.1f%% %10.4f\r\n", names[t], c.name, formatTime(rise, sizeof(rise), m.rise_time),
+                   formatTime(settling, sizeof(settling), m.settling_time), m.overshoot * 100.0f, m.rms_error);
+        }
+    }
+    return 0;
+}
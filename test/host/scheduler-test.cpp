@@ -0,0 +1,103 @@
+/** @file scheduler-test.cpp
+ * Test of the main loop task scheduler in virtual time.
+ */
+#include <TaskScheduler.h>
+#include <string>
+#include <vector>
+
+#define TEST_DURATION_MS 1000
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+/** Records release times of a task and optionally blocks for a given time like a long computation. */
+struct TestTask
+{
+    const char * name;
+    uint32_t exec_ms;
+    std::vector<uint64_t> starts;
+    std::string * trace;
+
+    void run()
+    {
+        starts.push_back(Kernel::get_ms_count());
+        if (trace)
+            *trace += name;
+        if (exec_ms)
+            ThisThread::sleep_for(exec_ms);
+    }
+};
+
+static void runScheduler(TaskScheduler & scheduler, uint64_t until_ms)
+{
+    while (Kernel::get_ms_count() < until_ms)
+        scheduler.dispatch();
+}
+
+int main()
+{
+    const char * name;
+    TaskStats stats;
+
+    // tasks are added in reverse rate-monotonic order on purpose
+    std::string trace;
+    TestTask slow = {"s", 0, {}, &trace}, mid = {"m", 0, {}, &trace}, fast = {"f", 0, {}, &trace};
+    TaskScheduler scheduler;
+    int slow_id = scheduler.addTask("slow", callback(&slow, &TestTask::run), 50, 0);
+    int mid_id = scheduler.addTask("mid", callback(&mid, &TestTask::run), 20, 0);
+    int fast_id = scheduler.addTask("fast", callback(&fast, &TestTask::run), 10, 0);
+    uint64_t t0 = Kernel::get_ms_count();
+    scheduler.start();
+    scheduler.dispatch();
+    check(trace == "fms", "released tasks run in rate-monotonic order");
+
+    runScheduler(scheduler, t0 + TEST_DURATION_MS);
+    check(fast.starts.size() == 100 && mid.starts.size() == 50 && slow.starts.size() == 20, "tasks run at their periods");
+    bool on_grid = true;
+    for (size_t k = 0; k < fast.starts.size(); k++) on_grid = on_grid && fast.starts[k] == t0 + 10 * k;
+    for (size_t k = 0; k < slow.starts.size(); k++) on_grid = on_grid && slow.starts[k] == t0 + 50 * k;
+    check(on_grid, "releases follow the absolute schedule");
+    bool clean = true;
+    for (int i = 0; scheduler.getStats(i, name, stats); i++)
+        clean = clean && stats.skipped == 0 && stats.overruns == 0 && stats.max_latency_ms == 0;
+    check(clean, "no skipped releases, overruns or latency without load");
+
+    // phases and a task overrunning the period of the fast task
+    TestTask hog = {"h", 25, {}, NULL}, tick = {"t", 0, {}, NULL}, quiet = {"q", 0, {}, NULL};
+    TaskScheduler loaded;
+    int tick_id = loaded.addTask("tick", callback(&tick, &TestTask::run), 10, 0);
+    int quiet_id = loaded.addTask("quiet", callback(&quiet, &TestTask::run), 50, 3);
+    int hog_id = loaded.addTask("hog", callback(&hog, &TestTask::run), 100, 5);
+    t0 = Kernel::get_ms_count();
+    loaded.start();
+    runScheduler(loaded, t0 + TEST_DURATION_MS);
+    check(quiet.starts.size() && quiet.starts[0] == t0 + 3 && hog.starts.size() && hog.starts[0] == t0 + 5,
+          "first releases are delayed by the phases");
+
+    TaskStats tick_stats, hog_stats;
+    loaded.getStats(tick_id, name, tick_stats);
+    loaded.getStats(hog_id, name, hog_stats);
+    check(tick_stats.overruns == 10 && tick_stats.skipped == 10, "overruns and skipped releases of the blocked task are counted");
+    check(tick_stats.max_latency_ms == 20, "latency of the blocked task is measured");
+    check(tick_stats.runs + tick_stats.skipped == 100, "late task stays on its release grid");
+    check(hog_stats.overruns == 0 && hog_stats.max_exec_us >= 25000, "long task within its deadline is not an overrun");
+
+    loaded.resetStats();
+    loaded.getStats(tick_id, name, tick_stats);
+    check(tick_stats.runs == 0 && tick_stats.overruns == 0 && strcmp(name, "tick") == 0, "statistics reset keeps the task");
+
+    check(loaded.setPeriod(quiet_id, 20) && loaded.getPeriod(quiet_id) == 20, "task period can be changed");
+    char buffer[256];
+    int len = loaded.print(buffer, sizeof(buffer));
+    check(len > 0 && strncmp(buffer, "tick 10 ", 8) == 0 && strstr(buffer, "\nquiet 20 ") && strstr(buffer, "\nhog 100 "),
+          "statistics are printed in rate-monotonic order");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
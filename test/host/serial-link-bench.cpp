@@ -0,0 +1,108 @@
+/** @file serial-link-bench.cpp
+ * Loopback throughput of the rosserial serial link against the simulated UART.
+ *
+ * The line runs in virtual time, one byte per 10 bit times at the rosserial baudrate. Frames
+ * are published at the offered load, every byte shifted out is looped back to the receiver,
+ * where the frames are checked by the rosserial frame parser. Reported are the delivered
+ * throughput, frames dropped on a full transmit ring, chunks handed to the transmitter per byte
+ * and the host time of write() per byte (the cost of publish()). The chunks follow the shim's
+ * model of the UART, they are not a measurement of the interrupt load of the MCU: on CORE2 an
+ * asynchronous transfer still takes one interrupt per byte.
+ *
+ * Built twice: with chunked asynchronous transfers (serial-link-bench) and with the transmit
+ * interrupt per byte (serial-link-irq-bench).
+ *
+ * Usage: serial-link-bench [offered_bytes_per_s] [frame_size]
+ */
+#include <SerialLink.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define BITS_PER_BYTE 10 // 8N1
+#define DURATION_S 10
+
+/** rosserial frame with a message filling the frame size. */
+static std::vector<uint8_t> makeFrame(uint16_t topic, int size)
+{
+    int length = size - 8;
+    std::vector<uint8_t> frame = {0xff, 0xfe, (uint8_t)(length & 0xff), (uint8_t)(length >> 8), 0, (uint8_t)(topic & 0xff), (uint8_t)(topic >> 8)};
+    frame[4] = 255 - ((frame[2] + frame[3]) % 256);
+    int sum = frame[5] + frame[6];
+    for (int i = 0; i < length; i++)
+    {
+        frame.push_back((uint8_t)(i * 7));
+        sum += frame.back();
+    }
+    frame.push_back(255 - (sum % 256));
+    return frame;
+}
+
+/** Send one byte on the line back to the receiver, @return number of bytes read */
+static int loopback(SerialLink & link, RawSerial & serial)
+{
+    if (!serial.hostShift())
+        return 0;
+    serial.hostSend(&serial.line.back(), 1);
+    serial.line.clear();
+    int n = 0;
+    while (link.read() >= 0) n++;
+    return n;
+}
+
+/** @return true if every frame was delivered intact or counted as dropped */
+static bool run(SerialLink & link, RawSerial & serial, double offered_bps, int frame_size)
+{
+    std::vector<uint8_t> frame = makeFrame(100, frame_size);
+    long bytes_per_s = link.getBaud() / BITS_PER_BYTE;
+    long slots = bytes_per_s * DURATION_S;
+    double frames_per_slot = offered_bps / frame_size / bytes_per_s;
+    double due = 0.0, write_ns = 0.0;
+    uint64_t delivered = 0;
+    link.resetStats();
+
+    for (long slot = 0; slot < slots; slot++)
+    {
+        for (due += frames_per_slot; due >= 1.0; due -= 1.0)
+        {
+            auto start = std::chrono::steady_clock::now();
+            link.write(frame.data(), frame.size());
+            write_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+        delivered += loopback(link, serial);
+    }
+    double throughput = (double)delivered / DURATION_S;
+    for (int n; (n = loopback(link, serial)) > 0;) delivered += n;
+
+    SerialLinkStats stats;
+    link.getStats(stats);
+    printf("%8.0f %6d %10.0f %6.1f%% %8u %8.3f %8.1f\r\n", offered_bps, frame_size, throughput,
+           100.0 * throughput / bytes_per_s, stats.tx_dropped, (double)stats.tx_chunks / stats.tx_bytes,
+           write_ns / stats.tx_bytes);
+    return stats.rx_frames == stats.tx_frames && stats.checksum_errors == 0 && delivered == stats.tx_bytes &&
+           stats.rx_overflows == 0;
+}
+
+int main(int argc, char ** argv)
+{
+    static SerialLink link;
+    RawSerial & serial = *RawSerial::port(MBED_CONF_ROSSERIAL_MBED_TX_PIN);
+    link.init();
+    double capacity = (double)link.getBaud() / BITS_PER_BYTE;
+
+    printf("%s transmission, %ld baud\r\n", SERIAL_LINK_ASYNC_TX ? "chunked" : "per byte", link.getBaud());
+    printf("%8s %6s %10s %7s %8s %8s %8s\r\n", "offered", "frame", "delivered", "link", "dropped", "chunks/B", "ns/B");
+    bool intact = true;
+    if (argc > 1)
+        intact = run(link, serial, atof(argv[1]), argc > 2 ? atoi(argv[2]) : 103);
+    else
+    {
+        const double loads[] = {0.25, 0.5, 0.8, 1.0, 1.2};
+        const int frames[] = {24, 103, 400};
+        for (int f = 0; f < 3; f++)
+            for (int l = 0; l < 5; l++) intact = run(link, serial, loads[l] * capacity, frames[f]) && intact;
+    }
+
+    printf("%s\r\n", intact ? "OK" : "FAILED");
+    return intact ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/** @file serial-link-test.cpp
+ * Test of the rosserial serial link accounting against the simulated UART.
+ *
+ * Built twice: with chunked asynchronous transfers (serial-link-test) and with the transmit
+ * interrupt per byte (serial-link-irq-test).
+ */
+#include <SerialLink.h>
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+/** rosserial frame with a message of given length filled with a pattern. */
+static std::vector<uint8_t> makeFrame(uint16_t topic, int length, uint8_t seed)
+{
+    std::vector<uint8_t> frame = {0xff, 0xfe, (uint8_t)(length & 0xff), (uint8_t)(length >> 8), 0, (uint8_t)(topic & 0xff), (uint8_t)(topic >> 8)};
+    frame[4] = 255 - ((frame[2] + frame[3]) % 256);
+    int sum = frame[5] + frame[6];
+    for (int i = 0; i < length; i++)
+    {
+        frame.push_back((uint8_t)(seed + i));
+        sum += frame.back();
+    }
+    frame.push_back(255 - (sum % 256));
+    return frame;
+}
+
+static void drain(RawSerial & serial)
+{
+    while (serial.hostShift())
+        ;
+}
+
+int main()
+{
+    static SerialLink link;
+    RawSerial & serial = *RawSerial::port(MBED_CONF_ROSSERIAL_MBED_TX_PIN);
+    link.init();
+    SerialLinkStats stats;
+
+    // transmission
+    std::vector<uint8_t> frame = makeFrame(100, 92, 1);
+    link.write(frame.data(), frame.size());
+    drain(serial);
+    link.getStats(stats);
+    check(serial.line == frame, "frame is transmitted from the interrupt");
+    check(stats.tx_frames == 1 && stats.tx_bytes == frame.size() && stats.tx_dropped == 0, "transmitted frame is counted");
+#if SERIAL_LINK_ASYNC_TX
+    check(stats.tx_chunks == 1, "frame is sent in one transfer");
+#else
+    check(stats.tx_chunks == frame.size() - 1, "frame is sent byte by byte after the first one");
+#endif
+
+    // frames that do not fit are dropped whole while the transmitter is stalled
+    serial.line.clear();
+    frame = makeFrame(101, 112, 2);
+    for (int i = 0; i < 10; i++) link.write(frame.data(), frame.size());
+    link.getStats(stats);
+    check(stats.tx_dropped == 2 && stats.tx_frames == 9, "frames are dropped on a full transmit ring");
+    check(stats.tx_peak <= MBED_CONF_SERIAL_LINK_TX_BUFFER_SIZE && stats.tx_peak > 900, "transmit ring peak is tracked");
+    drain(serial);
+    RosserialFrameParser parser;
+    int frames = 0, errors = 0;
+    for (size_t i = 0; i < serial.line.size(); i++)
+    {
+        RosserialFrameParser::Event event = parser.feed(serial.line[i]);
+        frames += event == RosserialFrameParser::FRAME;
+        errors += event == RosserialFrameParser::CHECKSUM_ERROR;
+    }
+    check(frames == 8 && errors == 0 && serial.line.size() == 8 * frame.size(), "only whole frames are transmitted");
+
+    // reception
+    std::vector<uint8_t> good = makeFrame(0, 8, 3), bad_message = makeFrame(125, 20, 4), bad_length = makeFrame(125, 0, 5);
+    bad_message[10] ^= 0x10;
+    bad_length[4] ^= 0x01;
+    std::vector<uint8_t> stream = {0x00, 0xff}; // noise and a repeated sync byte before the first frame
+    stream.insert(stream.end(), good.begin(), good.end());
+    stream.insert(stream.end(), bad_message.begin(), bad_message.end());
+    stream.insert(stream.end(), bad_length.begin(), bad_length.end());
+    stream.insert(stream.end(), good.begin(), good.end());
+    serial.hostSend(stream.data(), stream.size());
+    int received = 0;
+    bool same = true;
+    for (int c; (c = link.read()) >= 0; received++) same = same && c == stream[received];
+    link.getStats(stats);
+    check(same && received == (int)stream.size() && stats.rx_bytes == stream.size(), "received bytes are read in order");
+    check(stats.rx_frames == 2 && stats.checksum_errors == 2, "frames with wrong checksums are counted");
+
+    std::vector<uint8_t> burst(MBED_CONF_SERIAL_LINK_RX_BUFFER_SIZE + 76, 0x55);
+    serial.hostSend(burst.data(), burst.size());
+    link.getStats(stats);
+    check(stats.rx_overflows == 76, "bytes lost on a full receive ring are counted");
+
+    link.resetStats();
+    link.getStats(stats);
+    check(stats.tx_bytes == 0 && stats.tx_dropped == 0 && stats.rx_overflows == 0 && stats.checksum_errors == 0,
+          "statistics are reset");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
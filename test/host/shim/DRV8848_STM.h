@@ -0,0 +1,69 @@
+/** @file DRV8848_STM.h
+ * Host facade of drv88xx-driver-mbed - motor outputs are forwarded to host::RosbotPlant.
+ */
+#ifndef __HOST_DRV8848_STM_H__
+#define __HOST_DRV8848_STM_H__
+
+#include <mbed.h>
+#include "RosbotPlant.h"
+
+enum MotNum : uint8_t
+{
+    MOT1 = 0,
+    MOT2 = 1
+};
+
+struct DRV8848_Params_t
+{
+    PinName ain1;
+    PinName ain2;
+    PinName pwma;
+    PinName bin1;
+    PinName bin2;
+    PinName pwmb;
+    PinName fault;
+    PinName sleep;
+};
+
+class DRV8848 : NonCopyable<DRV8848>
+{
+public:
+    class DRVMotor
+    {
+        friend class DRV8848;
+
+    public:
+        void setPolarity(bool polarity) { _polarity = polarity; }
+        void init(uint32_t freq) { setPower(0.0f); }
+        void setDriveMode(bool mode) {}
+        void setPower(float power)
+        {
+            _power = std::max(-1.0f, std::min(1.0f, power));
+            host::RosbotPlant::instance().setDuty(_index, _polarity ? -_power : _power);
+        }
+        float getDutyCycle() { return _power; }
+
+    private:
+        DRVMotor() : _index(0), _polarity(false), _power(0.0f) {}
+        int _index;
+        bool _polarity;
+        float _power;
+    };
+
+    DRV8848(const DRV8848_Params_t * params)
+    : _index(params->ain1 == MOT1A_IN ? 0 : 1)
+    {
+        _mot[0]._index = 2 * _index;
+        _mot[1]._index = 2 * _index + 1;
+    }
+
+    DRVMotor * getDCMotor(MotNum num) { return &_mot[num]; }
+
+    void enable(bool en) { host::RosbotPlant::instance().enableDriver(_index, en); }
+
+private:
+    int _index;
+    DRVMotor _mot[2];
+};
+
+#endif /* __HOST_DRV8848_STM_H__ */
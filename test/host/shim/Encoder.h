@@ -0,0 +1,40 @@
+/** @file Encoder.h
+ * Host facade of encoder-mbed - counts are read from host::RosbotPlant.
+ */
+#ifndef __HOST_ENCODER_H__
+#define __HOST_ENCODER_H__
+
+#include <mbed.h>
+#include "RosbotPlant.h"
+
+enum EncoderNum : uint8_t
+{
+    ENCODER_1 = 0,
+    ENCODER_2 = 1,
+    ENCODER_3 = 2,
+    ENCODER_4 = 3
+};
+
+class Encoder : NonCopyable<Encoder>
+{
+public:
+    Encoder(EncoderNum num) : _index(num), _polarity(false), _offset(0) {}
+
+    void init() { resetCount(); }
+    void setPolarity(bool polarity) { _polarity = polarity; }
+    int32_t getCount() { return raw() - _offset; }
+    void resetCount() { _offset = raw(); }
+
+private:
+    int32_t raw() const
+    {
+        int32_t ticks = host::RosbotPlant::instance().getTicks(_index);
+        return _polarity ? -ticks : ticks;
+    }
+
+    int _index;
+    bool _polarity;
+    int32_t _offset;
+};
+
+#endif /* __HOST_ENCODER_H__ */
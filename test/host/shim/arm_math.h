@@ -0,0 +1,38 @@
+/** @file arm_math.h
+ * Host replacement for the CMSIS-DSP subset used by the firmware (portable C implementation).
+ */
+#ifndef __HOST_ARM_MATH_SHIM_H__
+#define __HOST_ARM_MATH_SHIM_H__
+
+#include <cstdint>
+#include <cstring>
+
+typedef float float32_t;
+
+typedef struct
+{
+    float32_t A0;       /**< The derived gain, A0 = Kp + Ki + Kd . */
+    float32_t A1;       /**< The derived gain, A1 = -Kp - 2Kd. */
+    float32_t A2;       /**< The derived gain, A2 = Kd . */
+    float32_t state[3]; /**< The state array of length 3. */
+    float32_t Kp;       /**< The proportional gain. */
+    float32_t Ki;       /**< The integral gain. */
+    float32_t Kd;       /**< The derivative gain. */
+} arm_pid_instance_f32;
+
+static inline float32_t arm_pid_f32(arm_pid_instance_f32 * S, float32_t in)
+{
+    float32_t out;
+
+    /* y[n] = y[n-1] + A0 * x[n] + A1 * x[n-1] + A2 * x[n-2]  */
+    out = (S->A0 * in) + (S->A1 * S->state[0]) + (S->A2 * S->state[1]) + (S->state[2]);
+
+    /* Update state */
+    S->state[1] = S->state[0];
+    S->state[0] = in;
+    S->state[2] = out;
+
+    return (out);
+}
+
+#endif /* __HOST_ARM_MATH_SHIM_H__ */
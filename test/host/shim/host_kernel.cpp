@@ -0,0 +1,228 @@
+#include "host_kernel.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace host {
+
+typedef std::chrono::steady_clock clock_type;
+
+struct SimContext
+{
+    int id;
+    const char * name;
+    std::condition_variable cv;
+    std::function<bool()> ready;
+    uint64_t wake_us;
+    bool finished;
+    clock_type::time_point resumed_at;
+    SliceStats stats;
+};
+
+static std::mutex kernel_mutex;
+static std::condition_variable harness_cv;
+static SimContext * current = nullptr; // nullptr - the harness holds the token
+static thread_local SimContext * this_context = nullptr;
+
+SimKernel::SimKernel()
+: _now_us(0)
+, _timer_ids(0)
+, _max_step_us(UINT64_MAX)
+{}
+
+SimKernel & SimKernel::instance()
+{
+    // never destroyed - simulated threads stay blocked inside the kernel until the process exits
+    static SimKernel * kernel = new SimKernel();
+    return *kernel;
+}
+
+bool SimKernel::inSimThread() const
+{
+    return this_context != nullptr;
+}
+
+int SimKernel::spawn(std::function<void()> fn, const char * name)
+{
+    SimContext * ctx = new SimContext();
+    ctx->id = (int)_threads.size();
+    ctx->name = name;
+    ctx->wake_us = _now_us;
+    ctx->finished = false;
+    ctx->stats = {0, 0.0, 0.0};
+    _threads.push_back(ctx);
+
+    std::thread th([ctx, fn]() {
+        this_context = ctx;
+        {
+            std::unique_lock<std::mutex> lock(kernel_mutex);
+            ctx->cv.wait(lock, [ctx] { return current == ctx; });
+            ctx->resumed_at = clock_type::now();
+        }
+        fn();
+        std::unique_lock<std::mutex> lock(kernel_mutex);
+        ctx->finished = true;
+        current = nullptr;
+        harness_cv.notify_one();
+    });
+    th.detach();
+    return ctx->id;
+}
+
+void SimKernel::resume(SimContext * ctx)
+{
+    std::unique_lock<std::mutex> lock(kernel_mutex);
+    ctx->ready = nullptr;
+    ctx->wake_us = UINT64_MAX;
+    current = ctx;
+    ctx->cv.notify_one();
+    harness_cv.wait(lock, [] { return current == nullptr; });
+}
+
+void SimKernel::blockUntil(std::function<bool()> ready)
+{
+    SimContext * ctx = this_context;
+    if (ctx == nullptr)
+    {
+        // harness context - keep simulating until the condition holds
+        while (!ready())
+        {
+            uint64_t next = UINT64_MAX;
+            for (const Timer & t : _timers) next = std::min(next, t.due_us);
+            for (SimContext * c : _threads)
+                if (!c->finished && c->wake_us > _now_us) next = std::min(next, c->wake_us);
+            if (next == UINT64_MAX)
+                return; // nothing can ever change the condition
+            runUntil(next);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(kernel_mutex);
+    double slice_ns = std::chrono::duration<double, std::nano>(clock_type::now() - ctx->resumed_at).count();
+    ctx->stats.slices++;
+    ctx->stats.total_ns += slice_ns;
+    ctx->stats.max_ns = std::max(ctx->stats.max_ns, slice_ns);
+    ctx->ready = ready;
+    current = nullptr;
+    harness_cv.notify_one();
+    ctx->cv.wait(lock, [ctx] { return current == ctx; });
+    ctx->resumed_at = clock_type::now();
+}
+
+void SimKernel::sleepUntil(uint64_t t_us)
+{
+    if (this_context == nullptr)
+    {
+        runUntil(t_us);
+        return;
+    }
+    this_context->wake_us = t_us;
+    blockUntil(nullptr);
+}
+
+int SimKernel::addTimer(std::function<void()> cb, uint64_t period_us, bool periodic)
+{
+    Timer t = {++_timer_ids, cb, period_us, _now_us + period_us, periodic};
+    _timers.push_back(t);
+    return t.id;
+}
+
+void SimKernel::removeTimer(int id)
+{
+    _timers.erase(std::remove_if(_timers.begin(), _timers.end(), [id](const Timer & t) { return t.id == id; }), _timers.end());
+}
+
+void SimKernel::setStepHook(StepHook hook, uint64_t max_step_us)
+{
+    _step_hook = hook;
+    _max_step_us = max_step_us ? max_step_us : UINT64_MAX;
+}
+
+void SimKernel::advanceTo(uint64_t t_us)
+{
+    while (_now_us < t_us)
+    {
+        uint64_t step = std::min(t_us - _now_us, _max_step_us);
+        if (_step_hook)
+            _step_hook(_now_us, _now_us + step);
+        _now_us += step;
+    }
+}
+
+bool SimKernel::fireDueTimers()
+{
+    bool fired = false;
+    for (;;)
+    {
+        std::vector<Timer>::iterator due = _timers.end();
+        for (std::vector<Timer>::iterator it = _timers.begin(); it != _timers.end(); ++it)
+            if (it->due_us <= _now_us && (due == _timers.end() || it->due_us < due->due_us))
+                due = it;
+        if (due == _timers.end())
+            return fired;
+
+        std::function<void()> cb = due->cb;
+        if (due->periodic)
+            due->due_us += due->period_us;
+        else
+            _timers.erase(due);
+        cb();
+        fired = true;
+    }
+}
+
+bool SimKernel::runReadyThreads()
+{
+    bool any = false;
+    for (size_t i = 0; i < _threads.size(); i++)
+    {
+        SimContext * ctx = _threads[i];
+        if (ctx->finished)
+            continue;
+        if (_now_us >= ctx->wake_us || (ctx->ready && ctx->ready()))
+        {
+            resume(ctx);
+            any = true;
+        }
+    }
+    return any;
+}
+
+void SimKernel::runUntil(uint64_t t_us)
+{
+    for (;;)
+    {
+        bool progress = true;
+        while (progress)
+        {
+            progress = fireDueTimers();
+            progress = runReadyThreads() || progress;
+        }
+
+        if (_now_us >= t_us)
+            return;
+
+        uint64_t next = t_us;
+        for (const Timer & t : _timers) next = std::min(next, t.due_us);
+        for (SimContext * c : _threads)
+            if (!c->finished && c->wake_us > _now_us) next = std::min(next, c->wake_us);
+        advanceTo(next);
+    }
+}
+
+SliceStats SimKernel::getSliceStats(int thread_id) const
+{
+    if (thread_id < 0 || thread_id >= (int)_threads.size())
+        return SliceStats{0, 0.0, 0.0};
+    return _threads[thread_id]->stats;
+}
+
+void SimKernel::resetSliceStats()
+{
+    for (SimContext * c : _threads) c->stats = {0, 0.0, 0.0};
+}
+
+} // namespace host
@@ -0,0 +1,86 @@
+/** @file host_kernel.h
+ * Lockstep virtual-time kernel used by the host (Linux) build of the firmware libraries.
+ *
+ * Every mbed thread started through the shim runs on its own std::thread, but only one
+ * simulated context (a thread or the harness) executes at a time. Time advances only when
+ * every simulated thread is blocked, which makes each simulation run fully deterministic.
+ */
+#ifndef __HOST_KERNEL_H__
+#define __HOST_KERNEL_H__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace host {
+
+struct SimContext;
+
+struct SliceStats
+{
+    uint64_t slices;   // number of times the thread was resumed
+    double total_ns;   // wall clock time spent running the thread
+    double max_ns;     // longest single slice
+};
+
+class SimKernel
+{
+public:
+    typedef std::function<void(uint64_t from_us, uint64_t to_us)> StepHook;
+
+    static SimKernel & instance();
+
+    uint64_t now() const { return _now_us; }
+
+    /** Spawn new simulated thread. The thread starts running at current virtual time. */
+    int spawn(std::function<void()> fn, const char * name);
+
+    /** Block calling context until virtual time reaches t_us. From the harness it advances the simulation. */
+    void sleepUntil(uint64_t t_us);
+
+    /** Block calling thread until ready() returns true. Must be called from simulated thread. */
+    void blockUntil(std::function<bool()> ready);
+
+    /** Register periodic timer callback (runs in the harness context, like an ISR). */
+    int addTimer(std::function<void()> cb, uint64_t period_us, bool periodic);
+    void removeTimer(int id);
+
+    /** Register a hook called every time virtual time moves forward (plant integration). */
+    void setStepHook(StepHook hook, uint64_t max_step_us);
+
+    void runFor(uint64_t us) { runUntil(_now_us + us); }
+    void runUntil(uint64_t t_us);
+
+    bool inSimThread() const;
+
+    /** Wall clock cost of the thread, used by benchmarks. */
+    SliceStats getSliceStats(int thread_id) const;
+    void resetSliceStats();
+
+private:
+    struct Timer
+    {
+        int id;
+        std::function<void()> cb;
+        uint64_t period_us;
+        uint64_t due_us;
+        bool periodic;
+    };
+
+    SimKernel();
+    void resume(SimContext * ctx);
+    void advanceTo(uint64_t t_us);
+    bool runReadyThreads();
+    bool fireDueTimers();
+
+    uint64_t _now_us;
+    int _timer_ids;
+    std::vector<SimContext *> _threads;
+    std::vector<Timer> _timers;
+    StepHook _step_hook;
+    uint64_t _max_step_us;
+};
+
+} // namespace host
+
+#endif /* __HOST_KERNEL_H__ */
@@ -0,0 +1,358 @@
+/** @file mbed.h
+ * Thin Mbed OS shim for the host (Linux) build.
+ *
+ * Only the subset of the API used by the libraries compiled on host is provided.
+ * Threads, tickers and sleeps are routed to host::SimKernel, so the code runs
+ * in deterministic virtual time.
+ */
+#ifndef __HOST_MBED_SHIM_H__
+#define __HOST_MBED_SHIM_H__
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <vector>
+#include "host_kernel.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MBED_ASSERT(expr) assert(expr)
+
+/* CMSIS data memory barrier. */
+#define __DMB() std::atomic_thread_fence(std::memory_order_seq_cst)
+
+typedef enum
+{
+    osPriorityIdle = 1,
+    osPriorityLow = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal = 24,
+    osPriorityAboveNormal = 32,
+    osPriorityHigh = 40,
+    osPriorityRealtime = 48
+} osPriority;
+
+typedef enum
+{
+    osOK = 0,
+    osError = -1
+} osStatus;
+
+#define OS_STACK_SIZE 4096
+
+/* Pins referenced by the libraries built on host. */
+typedef enum
+{
+    NC = -1,
+    MOT1A_IN, MOT1B_IN, MOT1_PWM,
+    MOT2A_IN, MOT2B_IN, MOT2_PWM,
+    MOT12_FAULT, MOT12_SLEEP,
+    MOT3A_IN, MOT3B_IN, MOT3_PWM,
+    MOT4A_IN, MOT4B_IN, MOT4_PWM,
+    MOT34_FAULT, MOT34_SLEEP,
+    RPI_SERIAL_TX, RPI_SERIAL_RX
+} PinName;
+
+template <typename T>
+class NonCopyable
+{
+protected:
+    NonCopyable() {}
+    ~NonCopyable() {}
+
+private:
+    NonCopyable(const NonCopyable &);
+    NonCopyable & operator=(const NonCopyable &);
+};
+
+namespace mbed {
+
+template <typename F>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> : public std::function<R(Args...)>
+{
+public:
+    Callback() {}
+    Callback(R (*fn)(Args...)) : std::function<R(Args...)>(fn) {}
+    template <typename T, typename U>
+    Callback(U * obj, R (T::*method)(Args...))
+    : std::function<R(Args...)>([obj, method](Args... args) { return (obj->*method)(args...); })
+    {}
+};
+
+template <typename T, typename U, typename R, typename... Args>
+Callback<R(Args...)> callback(U * obj, R (T::*method)(Args...))
+{
+    return Callback<R(Args...)>(obj, method);
+}
+
+template <typename R, typename... Args>
+Callback<R(Args...)> callback(R (*fn)(Args...))
+{
+    return Callback<R(Args...)>(fn);
+}
+
+/** Critical sections are no-ops - only one simulated context runs at a time. */
+class CriticalSectionLock
+{
+public:
+    CriticalSectionLock() {}
+    ~CriticalSectionLock() {}
+};
+
+/** Periodic timer interrupt. Callbacks run in the harness context at exact virtual time. */
+class Ticker : NonCopyable<Ticker>
+{
+public:
+    Ticker() : _id(0) {}
+    ~Ticker() { detach(); }
+
+    void attach_us(Callback<void()> func, uint64_t t)
+    {
+        detach();
+        _id = host::SimKernel::instance().addTimer(func, t, true);
+    }
+
+    void attach(Callback<void()> func, float t) { attach_us(func, (uint64_t)(t * 1000000.0f)); }
+
+    void detach()
+    {
+        if (_id)
+            host::SimKernel::instance().removeTimer(_id);
+        _id = 0;
+    }
+
+private:
+    int _id;
+};
+
+#ifndef DEVICE_SERIAL_ASYNCH
+#define DEVICE_SERIAL_ASYNCH 1
+#endif
+
+#define SERIAL_EVENT_TX_COMPLETE (1 << 0)
+
+typedef Callback<void(int)> event_callback_t;
+
+typedef enum
+{
+    DMA_USAGE_NEVER,
+    DMA_USAGE_OPPORTUNISTIC,
+    DMA_USAGE_ALWAYS,
+    DMA_USAGE_TEMPORARY_ALLOCATED,
+    DMA_USAGE_ALLOCATED
+} DMAUsage;
+
+class SerialBase
+{
+public:
+    enum IrqType
+    {
+        RxIrq = 0,
+        TxIrq
+    };
+};
+
+/**
+ * UART with a one byte transmit data register. The other end of the line is driven by the
+ * harness: hostSend() delivers received bytes, hostShift() completes the transmission of the
+ * byte in the data register; both raise the attached interrupts. An asynchronous write() is
+ * shifted out by hostShift() too and its callback runs after the last byte.
+ */
+class RawSerial : public SerialBase, NonCopyable<RawSerial>
+{
+public:
+    RawSerial(PinName tx, PinName rx, int baud = 9600) : _baud(baud), _tx_full(false), _tx_data(0), _async(NULL), _async_left(0), _async_event(0)
+    {
+        port(tx) = this;
+    }
+
+    /** Host only - serial port created on the transmit pin. */
+    static RawSerial *& port(PinName tx)
+    {
+        static std::map<int, RawSerial *> ports;
+        return ports[tx];
+    }
+
+    void baud(int baudrate) { _baud = baudrate; }
+
+    void set_dma_usage_tx(DMAUsage usage) {}
+
+    void attach(Callback<void()> func, IrqType type = RxIrq)
+    {
+        _irq[type] = func;
+        if (type == TxIrq && func && !_tx_full)
+            func();
+    }
+
+    int putc(int c)
+    {
+        assert(!_tx_full);
+        _tx_data = (uint8_t)c;
+        _tx_full = true;
+        return c;
+    }
+
+    int getc()
+    {
+        int c = _rx.front();
+        _rx.erase(_rx.begin());
+        return c;
+    }
+
+    /** Asynchronous transfer, @return 0 if started, -1 if a transfer is in progress */
+    int write(const uint8_t * buffer, int length, const event_callback_t & callback, int event = SERIAL_EVENT_TX_COMPLETE)
+    {
+        if (_async_left || _tx_full || length <= 0)
+            return -1;
+        _async = buffer;
+        _async_left = length;
+        _async_callback = callback;
+        _async_event = event;
+        putc(*_async++);
+        return 0;
+    }
+
+    bool readable() { return !_rx.empty(); }
+    bool writeable() { return !_tx_full && !_async_left; }
+
+    /** Host only - receive bytes from the other end. */
+    void hostSend(const uint8_t * data, size_t length)
+    {
+        _rx.insert(_rx.end(), data, data + length);
+        if (_irq[RxIrq])
+            _irq[RxIrq]();
+    }
+
+    /** Host only - finish sending the byte in the data register, @return false if it was empty. */
+    bool hostShift()
+    {
+        if (!_tx_full)
+            return false;
+        line.push_back(_tx_data);
+        _tx_full = false;
+        if (_async_left)
+        {
+            if (--_async_left)
+                putc(*_async++);
+            else if (_async_event & SERIAL_EVENT_TX_COMPLETE)
+                _async_callback(SERIAL_EVENT_TX_COMPLETE);
+            return true;
+        }
+        if (_irq[TxIrq])
+            _irq[TxIrq]();
+        return true;
+    }
+
+    std::vector<uint8_t> line; ///< Host only - transmitted bytes.
+
+private:
+    int _baud;
+    bool _tx_full;
+    uint8_t _tx_data;
+    std::vector<uint8_t> _rx;
+    Callback<void()> _irq[2];
+    const uint8_t * _async;
+    int _async_left;
+    int _async_event;
+    event_callback_t _async_callback;
+};
+
+} // namespace mbed
+
+inline uint32_t us_ticker_read() { return (uint32_t)host::SimKernel::instance().now(); }
+
+#define osWaitForever 0xFFFFFFFFU
+#define osFlagsWaitAny 0x00000000U
+#define osFlagsNoClear 0x00000002U
+
+namespace rtos {
+
+class EventFlags : NonCopyable<EventFlags>
+{
+public:
+    EventFlags() : _flags(0) {}
+
+    uint32_t set(uint32_t flags) { return _flags |= flags; }
+    uint32_t clear(uint32_t flags = 0x7fffffff)
+    {
+        uint32_t old = _flags;
+        _flags &= ~flags;
+        return old;
+    }
+    uint32_t get() const { return _flags; }
+
+    uint32_t wait_any(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true)
+    {
+        host::SimKernel::instance().blockUntil([this, flags] { return (_flags & flags) != 0; });
+        uint32_t result = _flags;
+        if (clear)
+            _flags &= ~flags;
+        return result;
+    }
+
+private:
+    volatile uint32_t _flags;
+};
+
+class Mutex : NonCopyable<Mutex>
+{
+public:
+    Mutex() {}
+    void lock() {}
+    bool trylock() { return true; }
+    void unlock() {}
+};
+
+class Thread : NonCopyable<Thread>
+{
+public:
+    Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE,
+           unsigned char * stack_mem = nullptr, const char * name = nullptr)
+    : _name(name)
+    , _id(-1)
+    {}
+
+    osStatus start(mbed::Callback<void()> task)
+    {
+        if (_id != -1)
+            return osError;
+        _id = host::SimKernel::instance().spawn(task, _name);
+        return osOK;
+    }
+
+    /** Host only - simulation thread id used to query host::SliceStats. */
+    int sim_id() const { return _id; }
+
+private:
+    const char * _name;
+    int _id;
+};
+
+namespace Kernel {
+inline uint64_t get_ms_count() { return host::SimKernel::instance().now() / 1000; }
+}
+
+namespace ThisThread {
+inline void sleep_until(uint64_t millisec) { host::SimKernel::instance().sleepUntil(millisec * 1000); }
+inline void sleep_for(uint32_t millisec) { sleep_until(Kernel::get_ms_count() + millisec); }
+}
+
+} // namespace rtos
+
+using namespace mbed;
+using namespace rtos;
+using namespace std;
+
+#endif /* __HOST_MBED_SHIM_H__ */
@@ -0,0 +1,55 @@
+/** @file mbed_config.h
+ * Configuration macros normally generated by Mbed CLI from mbed_lib.json / mbed_app.json files.
+ */
+#ifndef __HOST_MBED_CONFIG_H__
+#define __HOST_MBED_CONFIG_H__
+
+#ifndef MBED_CONF_ROSBOT_DRIVE_TIMER_TICK
+#define MBED_CONF_ROSBOT_DRIVE_TIMER_TICK 1
+#endif
+
+#ifndef MBED_CONF_ROSBOT_DRIVE_SPEED_ESTIMATOR
+#define MBED_CONF_ROSBOT_DRIVE_SPEED_ESTIMATOR TICK_DELTA
+#endif
+
+#ifndef MBED_CONF_ROSBOT_DRIVE_REGULATOR_PERIOD_US
+#define MBED_CONF_ROSBOT_DRIVE_REGULATOR_PERIOD_US 10000
+#endif
+
+#ifndef MBED_CONF_ROSBOT_DRIVE_REGULATOR_ODOMETRY
+#define MBED_CONF_ROSBOT_DRIVE_REGULATOR_ODOMETRY 0
+#endif
+
+#ifndef MBED_CONF_ROSBOT_DRIVE_SPEED_WINDOW_US
+#define MBED_CONF_ROSBOT_DRIVE_SPEED_WINDOW_US 10000
+#endif
+
+#ifndef MBED_CONF_PROFILER_ENABLED
+#define MBED_CONF_PROFILER_ENABLED 1
+#endif
+
+#ifndef MBED_CONF_SERIAL_LINK_TX_BUFFER_SIZE
+#define MBED_CONF_SERIAL_LINK_TX_BUFFER_SIZE 1024
+#endif
+
+#ifndef MBED_CONF_SERIAL_LINK_ASYNC_TX
+#define MBED_CONF_SERIAL_LINK_ASYNC_TX 1
+#endif
+
+#ifndef MBED_CONF_SERIAL_LINK_RX_BUFFER_SIZE
+#define MBED_CONF_SERIAL_LINK_RX_BUFFER_SIZE 1024
+#endif
+
+#ifndef MBED_CONF_ROSSERIAL_MBED_TX_PIN
+#define MBED_CONF_ROSSERIAL_MBED_TX_PIN RPI_SERIAL_TX
+#endif
+
+#ifndef MBED_CONF_ROSSERIAL_MBED_RX_PIN
+#define MBED_CONF_ROSSERIAL_MBED_RX_PIN RPI_SERIAL_RX
+#endif
+
+#ifndef MBED_CONF_ROSSERIAL_MBED_BAUDRATE
+#define MBED_CONF_ROSSERIAL_MBED_BAUDRATE 500000
+#endif
+
+#endif /* __HOST_MBED_CONFIG_H__ */
@@ -0,0 +1,22 @@
+/** @file msg.h
+ * rosserial message base class for the host build of the generated messages.
+ */
+#ifndef __HOST_ROS_MSG_SHIM_H__
+#define __HOST_ROS_MSG_SHIM_H__
+
+namespace ros
+{
+
+class Msg
+{
+public:
+    virtual ~Msg() {}
+    virtual int serialize(unsigned char * outbuffer) const = 0;
+    virtual int deserialize(unsigned char * inbuffer) = 0;
+    virtual const char * getType() = 0;
+    virtual const char * getMD5() = 0;
+};
+
+} // namespace ros
+
+#endif /* __HOST_ROS_MSG_SHIM_H__ */
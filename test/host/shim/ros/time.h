@@ -0,0 +1,23 @@
+/** @file time.h
+ * rosserial time stamp for the host build of the generated messages.
+ */
+#ifndef __HOST_ROS_TIME_SHIM_H__
+#define __HOST_ROS_TIME_SHIM_H__
+
+#include <stdint.h>
+
+namespace ros
+{
+
+class Time
+{
+public:
+    uint32_t sec, nsec;
+
+    Time() : sec(0), nsec(0) {}
+    Time(uint32_t _sec, uint32_t _nsec) : sec(_sec), nsec(_nsec) {}
+};
+
+} // namespace ros
+
+#endif /* __HOST_ROS_TIME_SHIM_H__ */
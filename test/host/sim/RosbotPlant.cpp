@@ -0,0 +1,119 @@
+#include "RosbotPlant.h"
+#include "host_kernel.h"
+#include <cmath>
+
+namespace host {
+
+// ~1.5 m/s free wheel speed at full duty, loaded robot time constant
+const MotorModel RosbotPlant::DEFAULT_MOTOR_MODEL = {
+    .no_load_speed = 1200.0f,
+    .time_constant = 0.08f,
+    .friction_duty = 0.04f};
+
+const PlantGeometry RosbotPlant::DEFAULT_GEOMETRY = {
+    .radius = 0.0425f,
+    .gear_ratio = 34.014f,
+    .encoder_cpr = 48,
+    .wiring = 0b00111100};
+
+RosbotPlant::RosbotPlant()
+: _geometry(DEFAULT_GEOMETRY)
+, _driver_enabled{false, false}
+{
+    for (int i = 0; i < 4; i++) _wheel[i].model = DEFAULT_MOTOR_MODEL;
+    reset();
+}
+
+RosbotPlant & RosbotPlant::instance()
+{
+    static RosbotPlant plant;
+    return plant;
+}
+
+void RosbotPlant::attach(uint64_t step_us)
+{
+    SimKernel::instance().setStepHook([this](uint64_t from, uint64_t to) { step((to - from) * 1e-6); }, step_us);
+}
+
+void RosbotPlant::configure(const PlantGeometry & geometry)
+{
+    _geometry = geometry;
+}
+
+void RosbotPlant::setMotorModel(int wheel, const MotorModel & model)
+{
+    _wheel[wheel].model = model;
+}
+
+void RosbotPlant::setLoad(int wheel, float load_duty)
+{
+    _wheel[wheel].load = load_duty;
+}
+
+void RosbotPlant::reset()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        _wheel[i].duty = 0.0f;
+        _wheel[i].load = 0.0f;
+        _wheel[i].omega = 0.0;
+        _wheel[i].angle = 0.0;
+    }
+}
+
+void RosbotPlant::setDuty(int motor, float duty)
+{
+    _wheel[motor].duty = (_geometry.wiring >> motor & 1) ? -duty : duty;
+}
+
+void RosbotPlant::enableDriver(int driver, bool en)
+{
+    _driver_enabled[driver] = en;
+}
+
+int32_t RosbotPlant::getTicks(int encoder) const
+{
+    int32_t ticks = (int32_t)floor(_wheel[encoder].angle / (2.0 * M_PI) * _geometry.encoder_cpr);
+    return (_geometry.wiring >> (encoder + 4) & 1) ? -ticks : ticks;
+}
+
+float RosbotPlant::getWheelSpeed(int wheel) const
+{
+    return (float)(_wheel[wheel].omega / _geometry.gear_ratio * _geometry.radius);
+}
+
+float RosbotPlant::getDuty(int wheel) const
+{
+    return _wheel[wheel].duty;
+}
+
+double RosbotPlant::getWheelDistance(int wheel) const
+{
+    return _wheel[wheel].angle / _geometry.gear_ratio * _geometry.radius;
+}
+
+void RosbotPlant::step(double dt)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        Wheel & w = _wheel[i];
+        double drive = (_driver_enabled[i / 2] ? w.duty : 0.0) - w.load;
+        double friction = w.model.friction_duty;
+
+        if (w.omega == 0.0 && fabs(drive) <= friction)
+            continue; // static friction holds the wheel
+
+        double dir = w.omega != 0.0 ? copysign(1.0, w.omega) : copysign(1.0, drive);
+        double target = w.model.no_load_speed * (drive - dir * friction);
+        double omega = target + (w.omega - target) * exp(-dt / w.model.time_constant);
+
+        // kinetic friction cannot reverse the wheel on its own
+        if (w.omega != 0.0 && copysign(1.0, omega) != dir && fabs(drive) <= friction)
+            omega = 0.0;
+
+        w.angle += 0.5 * (w.omega + omega) * dt;
+        w.omega = omega;
+    }
+}
+
+} // namespace host
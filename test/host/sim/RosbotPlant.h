@@ -0,0 +1,76 @@
+/** @file RosbotPlant.h
+ * Simulated ROSbot drive train: four DC motors with gearboxes and quadrature encoders.
+ */
+#ifndef __ROSBOT_PLANT_H__
+#define __ROSBOT_PLANT_H__
+
+#include <cstdint>
+
+namespace host {
+
+struct MotorModel
+{
+    float no_load_speed; // motor shaft speed at full duty [rad/s]
+    float time_constant; // mechanical time constant with the robot's inertia reflected [s]
+    float friction_duty; // duty needed to overcome static friction
+};
+
+struct PlantGeometry
+{
+    float radius;         // wheel radius [m]
+    float gear_ratio;     // motor revolutions per wheel revolution
+    uint32_t encoder_cpr; // encoder counts per motor revolution
+    uint8_t wiring;       // physical wiring, uses RosbotWheel::polarity layout (LSB -> motor, MSB -> encoder)
+};
+
+class RosbotPlant
+{
+public:
+    static const MotorModel DEFAULT_MOTOR_MODEL;
+    static const PlantGeometry DEFAULT_GEOMETRY;
+    static const uint64_t DEFAULT_STEP_US = 50;
+
+    static RosbotPlant & instance();
+
+    /** Hook the plant integration into host::SimKernel. */
+    void attach(uint64_t step_us = DEFAULT_STEP_US);
+
+    void configure(const PlantGeometry & geometry);
+    void setMotorModel(int wheel, const MotorModel & model);
+
+    /** Constant load on the wheel expressed as equivalent duty (positive opposes forward motion). */
+    void setLoad(int wheel, float load_duty);
+
+    /* Firmware side - used by DRV8848 and Encoder facades. */
+    void setDuty(int motor, float duty);
+    void enableDriver(int driver, bool en);
+    int32_t getTicks(int encoder) const;
+
+    /* Ground truth. */
+    float getWheelSpeed(int wheel) const; // [m/s]
+    float getDuty(int wheel) const;
+    double getWheelDistance(int wheel) const; // [m]
+
+    void step(double dt);
+    void reset();
+
+private:
+    struct Wheel
+    {
+        MotorModel model;
+        float duty;
+        float load;
+        double omega; // motor shaft speed [rad/s]
+        double angle; // motor shaft angle [rad]
+    };
+
+    RosbotPlant();
+
+    PlantGeometry _geometry;
+    Wheel _wheel[4];
+    bool _driver_enabled[2];
+};
+
+} // namespace host
+
+#endif /* __ROSBOT_PLANT_H__ */
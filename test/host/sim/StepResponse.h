@@ -0,0 +1,88 @@
+/** @file StepResponse.h
+ * Step response metrics computed from a recorded speed trace.
+ */
+#ifndef __STEP_RESPONSE_H__
+#define __STEP_RESPONSE_H__
+
+#include <cmath>
+#include <vector>
+
+namespace host {
+
+struct StepMetrics
+{
+    float latency;       // time to first response of the output [s]
+    float rise_time;     // 10% -> 90% of the step [s]
+    float settling_time; // time after which the trace stays within the band [s]
+    float overshoot;     // peak overshoot relative to the step size
+    float rms_error;     // tracking error over the last quarter of the trace [m/s]
+};
+
+class StepRecorder
+{
+public:
+    StepRecorder(float t_step, float initial, float target)
+    : _t_step(t_step)
+    , _initial(initial)
+    , _target(target)
+    {}
+
+    void add(float t, float value, float output)
+    {
+        _samples.push_back(Sample{t, value, output});
+    }
+
+    StepMetrics analyze(float band = 0.05f) const
+    {
+        StepMetrics m = {-1.0f, -1.0f, -1.0f, 0.0f, 0.0f};
+        float step = _target - _initial;
+        float t10 = -1.0f, t90 = -1.0f, peak = 0.0f;
+        float settled_at = _t_step;
+        size_t n = _samples.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            const Sample & s = _samples[i];
+            if (s.t < _t_step)
+                continue;
+            float rel = (s.value - _initial) / step;
+            if (m.latency < 0.0f && s.output != 0.0f)
+                m.latency = s.t - _t_step;
+            if (t10 < 0.0f && rel >= 0.1f)
+                t10 = s.t;
+            if (t90 < 0.0f && rel >= 0.9f)
+                t90 = s.t;
+            peak = std::max(peak, rel - 1.0f);
+            if (std::fabs(s.value - _target) > band * std::fabs(step))
+                settled_at = s.t;
+        }
+        if (t10 >= 0.0f && t90 >= 0.0f)
+            m.rise_time = t90 - t10;
+        if (n > 0 && settled_at < _samples[n - 1].t)
+            m.settling_time = settled_at - _t_step;
+        m.overshoot = peak;
+
+        double acc = 0.0;
+        size_t cnt = 0;
+        for (size_t i = n - n / 4; i < n; i++, cnt++)
+            acc += (_samples[i].value - _target) * (_samples[i].value - _target);
+        m.rms_error = cnt ? (float)std::sqrt(acc / cnt) : 0.0f;
+        return m;
+    }
+
+private:
+    struct Sample
+    {
+        float t;
+        float value;
+        float output;
+    };
+
+    float _t_step;
+    float _initial;
+    float _target;
+    std::vector<Sample> _samples;
+};
+
+} // namespace host
+
+#endif /* __STEP_RESPONSE_H__ */
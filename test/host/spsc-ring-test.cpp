@@ -0,0 +1,100 @@
+/** @file spsc-ring-test.cpp
+ * Test of the single-producer/single-consumer ring with a real producer thread.
+ */
+#include <SpscRing.h>
+#include <thread>
+
+#define RECORDS 1000000
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+struct Record
+{
+    uint32_t seq;
+    uint32_t payload[7];
+};
+
+int main()
+{
+    static SpscRing<Record, 16> ring;
+    check(ring.peek() == NULL && ring.size() == 0, "new ring is empty");
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        Record * r = ring.beginWrite();
+        r->seq = i;
+        ring.commitWrite();
+    }
+    check(ring.beginWrite() == NULL && ring.overflows() == 1, "full ring drops and counts the record");
+    bool ordered = true;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        Record * r = ring.peek();
+        ordered = ordered && r != NULL && r->seq == i;
+        ring.release();
+    }
+    check(ordered && ring.peek() == NULL, "records are read in order");
+
+    // blocks wrap around the end of the buffer and are read in contiguous runs
+    static SpscRing<uint8_t, 16> bytes;
+    uint8_t block[12];
+    for (int i = 0; i < 12; i++) block[i] = i;
+    check(bytes.write(block, 12) && bytes.size() == 12, "block is written");
+    bytes.release(10);
+    check(bytes.write(block, 12) && !bytes.write(block, 3) && bytes.overflows() == 1, "block that does not fit is dropped and counted");
+    uint8_t * run;
+    uint32_t n = bytes.peekContiguous(run);
+    bool runs = n == 6 && run[0] == 10 && run[1] == 11 && run[2] == 0 && run[5] == 3;
+    bytes.release(n);
+    n = bytes.peekContiguous(run);
+    runs = runs && n == 8 && run[0] == 4 && run[7] == 11;
+    bytes.release(n);
+    check(runs && bytes.peekContiguous(run) == 0, "contiguous runs end at the end of the buffer");
+
+    // the producer fills every word of the record, the consumer checks them
+    static SpscRing<Record, 16> shared;
+    uint32_t written = 0;
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < RECORDS; i++)
+        {
+            Record * r = shared.beginWrite();
+            if (r == NULL)
+                continue;
+            r->seq = i;
+            for (int k = 0; k < 7; k++) r->payload[k] = i * (k + 1);
+            shared.commitWrite();
+            written++;
+        }
+    });
+    uint32_t received = 0, last = 0;
+    bool intact = true, monotonic = true;
+    while (true)
+    {
+        Record * r = shared.peek();
+        if (r == NULL)
+        {
+            if (received + shared.overflows() == RECORDS)
+                break;
+            continue;
+        }
+        for (int k = 0; k < 7; k++) intact = intact && r->payload[k] == r->seq * (k + 1);
+        monotonic = monotonic && (received == 0 || r->seq > last);
+        last = r->seq;
+        received++;
+        shared.release();
+    }
+    producer.join();
+    check(intact, "records are not torn");
+    check(monotonic, "records keep the production order");
+    check(received == written && received + shared.overflows() == RECORDS, "every record is received or counted as overflow");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/** @file telemetry-bench.cpp
+ * Serial link load of the separate state topics versus the packed rosbot_ekf/Telemetry frame.
+ *
+ * Message sizes of the separate topics follow the rosserial serialization of the messages
+ * published by the firmware, every message is framed by rosserial with 8 more bytes. The packed
+ * frame is serialized, framed and decoded for real to measure the host decoder.
+ *
+ * Usage: telemetry-bench [imu_rate_hz] [range_rate_hz]
+ */
+#include <rosbot_ekf/Telemetry.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define BAUDRATE 500000     // rosserial-mbed.baudrate in mbed_app.json
+#define BITS_PER_BYTE 10    // 8N1
+#define FRAME_OVERHEAD 8    // sync, protocol, length, length checksum, topic id, checksum
+#define TICK_RATE_HZ 20     // POSE_PERIOD_MS
+#define BATTERY_RATE_HZ 2.5 // BATTERY_PERIOD_MS
+#define DECODE_FRAMES 1048576
+#define STREAM_FRAMES 1024
+
+static int header(const char * frame_id)
+{
+    return 4 + 8 + 4 + (int)strlen(frame_id); // seq, stamp, frame_id
+}
+
+static int string(const char * str)
+{
+    return 4 + (int)strlen(str);
+}
+
+struct Topic
+{
+    const char * name;
+    int size;
+    double rate_hz;
+};
+
+static int frame(const rosbot_ekf::Telemetry & msg, uint16_t topic_id, unsigned char * out)
+{
+    int len = msg.serialize(out + 7);
+    out[0] = 0xff;
+    out[1] = 0xfe;
+    out[2] = len & 0xff;
+    out[3] = len >> 8;
+    out[4] = 255 - ((out[2] + out[3]) % 256);
+    out[5] = topic_id & 0xff;
+    out[6] = topic_id >> 8;
+    int sum = out[5] + out[6];
+    for (int i = 0; i < len; i++) sum += out[7 + i];
+    out[7 + len] = 255 - (sum % 256);
+    return len + FRAME_OVERHEAD;
+}
+
+/** Host side decoder: frame checks like rosserial_python, then deserialization. */
+static int decode(unsigned char * in, int size, rosbot_ekf::Telemetry & msg)
+{
+    if (size < FRAME_OVERHEAD || in[0] != 0xff || in[1] != 0xfe)
+        return -1;
+    int len = in[2] | (in[3] << 8);
+    if (((in[2] + in[3] + in[4]) % 256) != 255 || len + FRAME_OVERHEAD > size)
+        return -1;
+    int sum = in[5] + in[6] + in[7 + len];
+    for (int i = 0; i < len; i++) sum += in[7 + i];
+    if (sum % 256 != 255)
+        return -1;
+    msg.deserialize(in + 7);
+    return len + FRAME_OVERHEAD;
+}
+
+int main(int argc, char ** argv)
+{
+    double imu_rate = argc > 1 ? atof(argv[1]) : 10.0; // FIFO_SAMPLE_RATE_OPERATION
+    double range_rate = argc > 2 ? atof(argv[2]) : 10.0; // multi-distance-sensor.period-ms
+
+    const char * joints[] = {"front_left_wheel_hinge", "front_right_wheel_hinge", "rear_left_wheel_hinge", "rear_right_wheel_hinge"};
+    int joint_names = 4;
+    for (int i = 0; i < 4; i++) joint_names += string(joints[i]);
+
+    std::vector<Topic> topics = {
+        {"pose", header("odom") + 3 * 8 + 4 * 8, TICK_RATE_HZ},
+        {"velocity", 6 * 8, TICK_RATE_HZ},
+        {"tf", 4 + header("odom") + string("base_link") + 3 * 8 + 4 * 8, TICK_RATE_HZ},
+        {"joint_states", header("base_link") + joint_names + (4 + 4 * 8) + 4 + 4, TICK_RATE_HZ},
+        {"mpu9250", header("") + 4 * 8 + 6 * 4, imu_rate},
+        {"range/fr", header("range_fr") + 1 + 4 * 4, range_rate},
+        {"range/fl", header("range_fl") + 1 + 4 * 4, range_rate},
+        {"range/rr", header("range_rr") + 1 + 4 * 4, range_rate},
+        {"range/rl", header("range_rl") + 1 + 4 * 4, range_rate},
+        {"battery", header("") + 6 * 4 + 3 + 1 + 4 + 4 + 4, BATTERY_RATE_HZ},
+    };
+
+    rosbot_ekf::Telemetry msg;
+    msg.stamp = ros::Time(1234, 567890000);
+    msg.x = 1.5f;
+    msg.yaw = -0.25f;
+    for (int i = 0; i < 4; i++)
+    {
+        msg.wheel_position[i] = 10.0f * i;
+        msg.range_mm[i] = 100 * (i + 1);
+    }
+    msg.orientation[3] = 1.0f;
+    msg.gyro[2] = 0.5f;
+    msg.accel[2] = 9.81f;
+    msg.battery_mv = 11900;
+    msg.updated = rosbot_ekf::Telemetry::IMU_UPDATED | (rosbot_ekf::Telemetry::RANGE_UPDATED << 2);
+
+    unsigned char buffer[256];
+    int frame_size = frame(msg, 125, buffer);
+
+    printf("%-14s %6s %8s %8s\r\n", "topic", "bytes", "rate_hz", "bytes/s");
+    double separate_bps = 0.0, separate_tick = 0.0;
+    for (size_t i = 0; i < topics.size(); i++)
+    {
+        int size = topics[i].size + FRAME_OVERHEAD;
+        separate_bps += size * topics[i].rate_hz;
+        separate_tick += size * topics[i].rate_hz / TICK_RATE_HZ;
+        printf("%-14s %6d %8.1f %8.0f\r\n", topics[i].name, size, topics[i].rate_hz, size * topics[i].rate_hz);
+    }
+    double packed_bps = (double)frame_size * TICK_RATE_HZ;
+    printf("%-14s %6d %8.1f %8.0f\r\n", "telemetry", frame_size, (double)TICK_RATE_HZ, packed_bps);
+
+    // time on the wire of the state of one tick, the last byte of the tick arrives this much later
+    double us_per_byte = 1e6 * BITS_PER_BYTE / BAUDRATE;
+    printf("separate: %.0f B/s (%.1f%% of the link), %.0f us per tick\r\n", separate_bps,
+           100.0 * separate_bps * BITS_PER_BYTE / BAUDRATE, separate_tick * us_per_byte);
+    printf("packed:   %.0f B/s (%.1f%% of the link), %.0f us per tick\r\n", packed_bps,
+           100.0 * packed_bps * BITS_PER_BYTE / BAUDRATE, frame_size * us_per_byte);
+    printf("saved:    %.0f B/s, %.0f us per tick\r\n", separate_bps - packed_bps, (separate_tick - frame_size) * us_per_byte);
+
+    rosbot_ekf::Telemetry decoded;
+    bool intact = decode(buffer, frame_size, decoded) == frame_size && decoded.stamp.sec == 1234 &&
+                  decoded.stamp.nsec == 567890000 && decoded.yaw == -0.25f && decoded.wheel_position[3] == 30.0f &&
+                  decoded.accel[2] == 9.81f && decoded.range_mm[3] == 400 && decoded.battery_mv == 11900 &&
+                  decoded.updated == msg.updated;
+    buffer[10] ^= 0x01;
+    bool rejected = decode(buffer, frame_size, decoded) < 0;
+    buffer[10] ^= 0x01;
+
+    // a stream of frames with different stamps, decoded frame by frame
+    std::vector<unsigned char> stream(STREAM_FRAMES * frame_size);
+    for (int i = 0; i < STREAM_FRAMES; i++)
+    {
+        msg.stamp.sec = i;
+        frame(msg, 125, &stream[i * frame_size]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (int i = 0; i < DECODE_FRAMES; i++)
+        if (decode(&stream[(i % STREAM_FRAMES) * frame_size], frame_size, decoded) > 0)
+            sum += decoded.stamp.sec;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    intact = intact && sum == (uint64_t)(DECODE_FRAMES / STREAM_FRAMES) * (STREAM_FRAMES * (STREAM_FRAMES - 1) / 2);
+    printf("decode: %.0f ns per frame\r\n", ns / DECODE_FRAMES);
+
+    printf("%s\r\n", intact && rejected ? "OK" : "FAILED");
+    return intact && rejected ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/** @file traction-monitor-test.cpp
+ * Test of the slip and stall detection on synthetic wheel speeds.
+ */
+#include <TractionMonitor.h>
+#include <math.h>
+#include <stdio.h>
+
+#define DT_US 10000
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+/** Run iterations with constant inputs, return the setpoints of the last one. */
+static void run(TractionMonitor & monitor, const float * target, const float * speed, const float * pidout, int iterations, float * setpoint)
+{
+    for (int n = 0; n < iterations; n++)
+    {
+        for (int i = 0; i < 4; i++) setpoint[i] = target[i];
+        monitor.update(setpoint, speed, pidout, DT_US);
+    }
+}
+
+int main()
+{
+    TractionMonitor monitor;
+    TractionStats stats;
+    float setpoint[4];
+    const float pidout[4] = {0.3f, 0.3f, 0.3f, 0.3f};
+
+    // turn in place, sides in opposite directions, all wheels grip
+    const float turn[4] = {0.3f, 0.3f, -0.3f, -0.3f};
+    run(monitor, turn, turn, pidout, 100, setpoint);
+    monitor.getStats(stats);
+    bool quiet = monitor.getFlags() == 0;
+    for (int i = 0; i < 4; i++) quiet = quiet && stats.wheel[i].slip == 0.0f && stats.wheel[i].slip_events == 0;
+    check(quiet, "wheels with grip do not slip");
+
+    // MOTOR3 spins 60% faster than its partner MOTOR4
+    const float spin[4] = {0.3f, 0.3f, -0.48f, -0.3f};
+    run(monitor, turn, spin, pidout, 9, setpoint);
+    check(monitor.getFlags() == 0, "short slip is not an event");
+    run(monitor, turn, spin, pidout, 1, setpoint);
+    monitor.getStats(stats);
+    check(fabsf(stats.wheel[2].slip - 0.375f) < 1e-4f && stats.wheel[3].slip < 0.0f, "slip ratio of the faster wheel");
+    check(monitor.getFlags() == 0x04 && stats.wheel[2].slip_events == 1, "slip lasting the detection time is an event");
+    check(setpoint[2] == turn[2], "monitor only does not touch the setpoint");
+    run(monitor, turn, spin, pidout, 50, setpoint);
+    monitor.getStats(stats);
+    check(stats.wheel[2].slip_events == 1 && stats.wheel[2].slip_time_ms == 510, "slip time is counted once per event");
+
+    // within the hysteresis the slip goes on
+    const float less[4] = {0.3f, 0.3f, -0.38f, -0.3f};
+    run(monitor, turn, less, pidout, 10, setpoint);
+    check(monitor.getFlags() == 0x04, "slip ends at half of the threshold");
+    run(monitor, turn, turn, pidout, 1, setpoint);
+    check(monitor.getFlags() == 0, "slip ends with the grip");
+
+    TractionParams params = TractionMonitor::DEFAULT_PARAMS;
+    params.actions = TRACTION_LIMIT_SLIP | TRACTION_CUT_STALL;
+    monitor.setParams(params);
+    run(monitor, turn, spin, pidout, 10, setpoint);
+    check(setpoint[2] == -0.3f && setpoint[3] == -0.3f && setpoint[0] == 0.3f, "slipping wheel is limited to its partner speed");
+
+    // slow wheels are not compared
+    const float slow_target[4] = {0.04f, 0.04f, 0.04f, 0.04f};
+    const float slow[4] = {0.04f, 0.0f, 0.04f, 0.04f};
+    monitor.reset();
+    run(monitor, slow_target, slow, pidout, 100, setpoint);
+    check(monitor.getFlags() == 0, "no slip below the minimal speed");
+
+    // MOTOR2 is blocked with the output saturated
+    const float forward[4] = {0.3f, 0.3f, 0.3f, 0.3f};
+    const float blocked[4] = {0.3f, 0.0f, 0.3f, 0.3f};
+    const float saturated[4] = {0.3f, 0.8f, 0.3f, 0.3f};
+    monitor.resetStats();
+    run(monitor, forward, blocked, saturated, 49, setpoint);
+    monitor.getStats(stats);
+    check(!stats.wheel[1].stalled && setpoint[1] == 0.3f, "short saturation is not a stall");
+    run(monitor, forward, blocked, saturated, 1, setpoint);
+    monitor.getStats(stats);
+    check(stats.wheel[1].stalled && stats.wheel[1].stall_events == 1 && setpoint[1] == 0.0f, "stalled wheel is switched off");
+    check(stats.wheel[0].slip_events == 0, "partner of a blocked wheel does not slip");
+    run(monitor, forward, blocked, pidout, 100, setpoint);
+    monitor.getStats(stats);
+    check(stats.wheel[1].stalled && setpoint[1] == 0.0f && stats.wheel[1].stall_events == 1, "switched off wheel waits for the stop command");
+    check(stats.wheel[0].slip_events == 0, "partner of a switched off wheel does not slip");
+    const float stop[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    run(monitor, stop, stop, stop, 1, setpoint);
+    run(monitor, forward, forward, pidout, 1, setpoint);
+    monitor.getStats(stats);
+    check(!stats.wheel[1].stalled && setpoint[1] == 0.3f, "stop command releases the wheel");
+
+    params.actions = TRACTION_MONITOR;
+    monitor.setParams(params);
+    run(monitor, forward, blocked, saturated, 60, setpoint);
+    run(monitor, forward, forward, pidout, 1, setpoint);
+    monitor.getStats(stats);
+    check(!stats.wheel[1].stalled && stats.wheel[1].stall_events == 2, "without the action the stall ends with the saturation");
+
+    monitor.resetStats();
+    monitor.getStats(stats);
+    check(stats.wheel[0].slip_events == 0 && stats.wheel[1].stall_events == 0 && monitor.getFlags() == 0, "counters are reset");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+/** @file velocity-profiler-test.cpp
+ * Test of the jerk-limited body velocity profile.
+ */
+#include <VelocityProfiler.h>
+#include <math.h>
+#include <stdio.h>
+
+#define DT_US 1000
+#define DT (DT_US * 1e-6f)
+
+static int failures = 0;
+
+static void check(bool condition, const char * what)
+{
+    printf("%s: %s\r\n", condition ? "PASS" : "FAIL", what);
+    if (!condition)
+        failures++;
+}
+
+struct Trace
+{
+    float acc_max[2];
+    float jerk_max[2];
+    float ratio_error; // largest deviation of angular / linear from the target ratio
+    float time;        // time until the targets were reached
+};
+
+/** Run the profile for a duration and record the largest acceleration, jerk and curvature error. */
+static void run(VelocityProfiler & profiler, float duration, float ratio, Trace & trace)
+{
+    trace = {{0.0f, 0.0f}, {0.0f, 0.0f}, 0.0f, -1.0f};
+    float a[2] = {profiler.getLinearAcc(), profiler.getAngularAcc()};
+    for (float t = 0.0f; t < duration; t += DT)
+    {
+        profiler.update(DT_US);
+        const float na[2] = {profiler.getLinearAcc(), profiler.getAngularAcc()};
+        for (int i = 0; i < 2; i++)
+        {
+            trace.acc_max[i] = fmaxf(trace.acc_max[i], fabsf(na[i]));
+            trace.jerk_max[i] = fmaxf(trace.jerk_max[i], fabsf(na[i] - a[i]) / DT);
+            a[i] = na[i];
+        }
+        trace.ratio_error = fmaxf(trace.ratio_error, fabsf(profiler.getAngular() - ratio * profiler.getLinear()));
+        if (trace.time < 0.0f && profiler.getRemainingTime() == 0.0f)
+            trace.time = t + DT;
+    }
+}
+
+int main()
+{
+    VelocityProfiler profiler;
+    const VelocityLimits & limits = VelocityProfiler::DEFAULT_LIMITS;
+    Trace trace;
+
+    // arc from standstill, the angular velocity stays twice the linear one
+    profiler.setTarget(0.5f, 1.0f);
+    float planned = profiler.getRemainingTime();
+    run(profiler, 2.0f, 2.0f, trace);
+    printf("0 -> 0.5 m/s, 1.0 rad/s: %.3f s, acc %.3f %.3f, jerk %.2f %.2f, curvature error %.6f\r\n", trace.time,
+           trace.acc_max[0], trace.acc_max[1], trace.jerk_max[0], trace.jerk_max[1], trace.ratio_error);
+    check(profiler.getLinear() == 0.5f && profiler.getAngular() == 1.0f && profiler.getLinearAcc() == 0.0f, "targets are reached");
+    check(fabsf(trace.time - planned) <= DT, "profile ends at the planned time");
+    check(trace.acc_max[0] <= limits.linear_acc * 1.001f && trace.acc_max[1] <= limits.angular_acc * 1.001f, "acceleration is limited");
+    check(trace.jerk_max[0] <= limits.linear_jerk * 1.001f && trace.jerk_max[1] <= limits.angular_jerk * 1.001f, "jerk is limited");
+    check(trace.ratio_error < 1e-4f, "wheel speeds change in proportion");
+    check(fabsf(trace.time - (0.1f + 0.42f / 0.8f + 0.1f)) < 2 * DT, "linear axis is time-optimal");
+
+    // new target during the ramp, the acceleration does not step
+    profiler.reset(0.0f, 0.0f);
+    profiler.setTarget(0.8f, 0.0f);
+    run(profiler, 0.3f, 0.0f, trace);
+    check(profiler.getLinearAcc() > 0.5f && trace.ratio_error == 0.0f, "straight line does not turn");
+    profiler.setTarget(-0.2f, -1.0f);
+    run(profiler, 2.0f, 5.0f, trace);
+    check(profiler.getLinear() == -0.2f && profiler.getAngular() == -1.0f, "reversed target is reached");
+    check(trace.jerk_max[0] <= limits.linear_jerk * 1.001f && trace.jerk_max[1] <= limits.angular_jerk * 1.001f, "jerk is limited after a new target");
+    check(trace.acc_max[0] <= limits.linear_acc * 1.001f, "acceleration is limited after a new target");
+
+    // stop
+    profiler.setTarget(0.0f, 0.0f);
+    run(profiler, 2.0f, 5.0f, trace);
+    check(profiler.getLinear() == 0.0f && profiler.getAngular() == 0.0f && trace.ratio_error < 1e-4f, "stop keeps the curvature");
+
+    // small change: no constant acceleration segment
+    profiler.setTarget(0.01f, 0.0f);
+    planned = profiler.getRemainingTime();
+    check(fabsf(planned - 2.0f * sqrtf(0.01f / limits.linear_jerk)) < 1e-4f, "short ramp without the acceleration limit");
+
+    // limits are changed during a ramp
+    profiler.reset(0.0f, 0.0f);
+    profiler.setTarget(1.0f, 0.0f);
+    run(profiler, 0.3f, 0.0f, trace);
+    VelocityLimits slow = limits;
+    slow.linear_acc = 0.3f;
+    profiler.setLimits(slow);
+    run(profiler, 4.0f, 0.0f, trace);
+    check(profiler.getLinear() == 1.0f && trace.acc_max[0] <= limits.linear_acc * 1.001f && profiler.getLinearAcc() == 0.0f, "new limits keep the target");
+
+    VelocityLimits none = {0.0f, 0.0f, 0.0f, 0.0f};
+    profiler.setLimits(none);
+    profiler.setTarget(0.3f, 0.5f);
+    profiler.update(DT_US);
+    check(profiler.getLinear() == 0.3f && profiler.getAngular() == 0.5f, "zero limits step to the target");
+    profiler.reset(0.1f, 0.2f);
+    profiler.update(DT_US);
+    check(profiler.getLinear() == 0.1f && profiler.getAngular() == 0.2f && profiler.getRemainingTime() == 0.0f, "reset holds the velocities");
+
+    printf("%s\r\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}